@@ -0,0 +1,101 @@
+#pragma once
+// Timing and JSON output shared by the benchmark suites (suite_bench, sdl/render_bench)
+// Results are one flat list keyed by group/name, so two runs can be diffed by a script
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchResult {
+    std::string group;          // e.g "opcode", "dxyn", "rom"
+    std::string name;
+    std::string unit;           // "ns/op" or "MIPS"
+    double best = 0.0;          // Fastest of the repeats (lowest ns, highest MIPS)
+    double median = 0.0;
+    uint64_t iterations = 0;    // Ops per repeat
+    std::string note;           // Anything a run should be checked against, e.g a framebuffer hash
+};
+
+// Time `repeat` runs of run(iterations) after one untimed warmup run, in ns per op
+template <typename Run>
+BenchResult time_ns_per_op(std::string group, std::string name, uint64_t iterations, int repeat, Run run) {
+    run(iterations);
+
+    std::vector<double> samples;
+    for (int r = 0; r < repeat; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        run(iterations);
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        samples.push_back(ns / static_cast<double>(iterations));
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.group = std::move(group);
+    result.name = std::move(name);
+    result.unit = "ns/op";
+    result.best = samples.front();
+    result.median = samples[samples.size() / 2];
+    result.iterations = iterations;
+    return result;
+}
+
+inline std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            static const char* hex = "0123456789abcdef";
+            out += "\\u00";
+            out += hex[(c >> 4) & 0xF];
+            out += hex[c & 0xF];
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// {"suite": ..., "timestamp": ..., "meta": {...}, "results": [{...}, ...]}
+inline void write_json(std::ostream& out, const std::string& suite,
+                       const std::vector<std::pair<std::string, std::string>>& meta,
+                       const std::vector<BenchResult>& results) {
+    out << "{\n  \"suite\": " << json_string(suite) << ",\n"
+        << "  \"timestamp\": " << static_cast<long long>(std::time(nullptr)) << ",\n"
+        << "  \"meta\": {";
+    for (size_t i = 0; i < meta.size(); i++) {
+        out << (i ? ", " : "") << json_string(meta[i].first) << ": " << json_string(meta[i].second);
+    }
+    out << "},\n  \"results\": [\n";
+
+    out << std::setprecision(6);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "    {\"group\": " << json_string(r.group) << ", \"name\": " << json_string(r.name)
+            << ", \"unit\": " << json_string(r.unit) << ", \"best\": " << r.best << ", \"median\": " << r.median
+            << ", \"iterations\": " << r.iterations << ", \"note\": " << json_string(r.note) << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+// Human readable version of the same results
+inline void print_table(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << std::left << std::setw(10) << "group" << std::setw(36) << "name" << std::right
+        << std::setw(12) << "best" << std::setw(12) << "median" << "  unit\n";
+    out << std::fixed << std::setprecision(2);
+    for (const BenchResult& r : results) {
+        out << std::left << std::setw(10) << r.group << std::setw(36) << r.name << std::right
+            << std::setw(12) << r.best << std::setw(12) << r.median << "  " << r.unit;
+        if (!r.note.empty()) out << "  " << r.note;
+        out << "\n";
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,85 @@
+// Interpreter dispatch benchmark
+// Runs each ROM with every dispatch strategy and reports emulated instructions per second
+// Usage: dispatch_bench [--cycles N] [--repeat R] <rom> [rom...]
+#include "Chip8/Core.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// Best-of-`repeat` MIPS for one ROM with one strategy
+template <Chip8::Dispatch D>
+static double measure(const char* rom, const Config& config, uint64_t cycles, int repeat) {
+    double best = 0.0;
+
+    for (int r = 0; r < repeat; r++) {
+        Chip8::Machine machine;
+        Chip8::load_rom(machine, rom);
+        // A new Machine always starts from DEFAULT_RNG_SEED, so every strategy gets the same CXNN sequence
+
+        const auto start = steady_clock::now();
+
+        // Frame sized batches with a timer tick in between, like the real main loop
+        uint64_t done = 0;
+        while (done < cycles) {
+            const uint64_t batch = std::min<uint64_t>(Chip8::frame_cycles(machine, config), cycles - done);
+            done += Chip8::execute<D>(machine, config, batch);
+            Chip8::tick_timers(machine);
+        }
+
+        const double elapsed = duration<double>(steady_clock::now() - start).count();
+        best = std::max(best, cycles / elapsed / 1e6);
+    }
+
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t cycles = 20'000'000;
+    int repeat = 3;
+    std::vector<const char*> roms;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--cycles" && i + 1 < argc) cycles = std::stoull(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::stoi(argv[++i]);
+        else roms.push_back(argv[i]);
+    }
+
+    if (roms.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--cycles N] [--repeat R] <rom> [rom...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Uncapped, the timers still tick once per ints_per_second / 60 instructions
+    Config config;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(32) << "ROM" << std::right
+              << std::setw(12) << "switch" << std::setw(12) << "table" << std::setw(12) << "threaded"
+              << std::setw(14) << "table/sw" << std::setw(14) << "threaded/sw" << "   (MIPS)\n";
+
+    try {
+        for (const char* rom : roms) {
+            const double sw = measure<Chip8::Dispatch::SWITCH>(rom, config, cycles, repeat);
+            const double table = measure<Chip8::Dispatch::TABLE>(rom, config, cycles, repeat);
+            const double threaded = measure<Chip8::Dispatch::THREADED>(rom, config, cycles, repeat);
+
+            std::string name = rom;
+            if (name.size() > 31) name = "..." + name.substr(name.size() - 28);
+
+            std::cout << std::left << std::setw(32) << name << std::right
+                      << std::setw(12) << sw << std::setw(12) << table << std::setw(12) << threaded
+                      << std::setw(13) << table / sw << "x" << std::setw(13) << threaded / sw << "x\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+// Render path copy benchmark
+// Replays the main loop's schedule (a render call every millisecond, ints_per_second / 1000 instructions
+// in between) and compares how many bytes reach the renderer per emulated second:
+//   by value:  update_window(const Config, const Machine), a full Machine and Config copy per call
+//   handoff:   FrameHandoff::publish() + latest(), only the framebuffer rows that changed
+// Usage: frame_copy_bench [--seconds S] <rom> [rom...]
+#include "Chip8/Core.hpp"
+#include "Chip8/Frame.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// main.cpp renders once per loop iteration and sleeps ~1ms per iteration
+constexpr uint64_t RENDER_CALLS_PER_SECOND = 1000;
+
+// Stand-in for the old renderer signature. noinline so the by-value copies really happen
+__attribute__((noinline)) static uint64_t render_by_value(const Config config, const Chip8::Machine machine) {
+    return machine.display[0][0][0] ^ config.fg_color;
+}
+
+__attribute__((noinline)) static uint64_t render_frame(const Chip8::Frame& frame) {
+    return frame.planes[0][0][0] ^ frame.sequence;
+}
+
+struct Result {
+    uint64_t bytes = 0;
+    double seconds = 0.0;   // Wall time spent in the render path only
+};
+
+// Run `seconds` emulated seconds of the ROM and render after every millisecond worth of instructions
+template <typename Render>
+static Result replay(const char* rom, const Config& config, uint64_t seconds, Render render) {
+    Chip8::Machine machine;
+    Chip8::load_rom(machine, rom);
+
+    Result result;
+    uint64_t sink = 0;
+    const uint64_t calls = seconds * RENDER_CALLS_PER_SECOND;
+
+    for (uint64_t call = 0; call < calls; call++) {
+        // Same instruction spread as frame_cycles(), but per millisecond
+        const uint64_t hz = config.ints_per_second;
+        Chip8::run_cycles(machine, config, ((call + 1) * hz) / 1000 - (call * hz) / 1000);
+        if ((call + 1) % (RENDER_CALLS_PER_SECOND / 60) == 0) Chip8::tick_timers(machine);
+
+        const auto start = steady_clock::now();
+        sink += render(machine, result.bytes);
+        result.seconds += duration<double>(steady_clock::now() - start).count();
+    }
+
+    // Keep the render calls from being optimized out
+    if (sink == 42) std::cerr << "";
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t seconds = 60;
+    std::vector<const char*> roms;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc) seconds = std::stoull(argv[++i]);
+        else roms.push_back(argv[i]);
+    }
+
+    if (roms.empty() || seconds == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--seconds S] <rom> [rom...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Config config;
+
+    std::cout << "sizeof(Machine) = " << sizeof(Chip8::Machine) << ", sizeof(Config) = " << sizeof(Config)
+              << ", sizeof(Frame) = " << sizeof(Chip8::Frame) << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(32) << "ROM" << std::right
+              << std::setw(16) << "by value B/s" << std::setw(16) << "handoff B/s" << std::setw(12) << "ratio"
+              << std::setw(16) << "by value ns" << std::setw(14) << "handoff ns" << "   (per render call)\n";
+
+    try {
+        for (const char* rom : roms) {
+            const Result by_value = replay(rom, config, seconds, [&](const Chip8::Machine& machine, uint64_t& bytes) {
+                bytes += sizeof(Chip8::Machine) + sizeof(Config);
+                return render_by_value(config, machine);
+            });
+
+            Chip8::FrameHandoff frames;
+            Result handoff = replay(rom, config, seconds, [&](Chip8::Machine& machine, uint64_t&) {
+                frames.publish(machine);
+                return render_frame(frames.latest());
+            });
+            handoff.bytes = frames.bytes_copied();
+
+            const double calls = static_cast<double>(seconds * RENDER_CALLS_PER_SECOND);
+
+            std::string name = rom;
+            if (name.size() > 31) name = "..." + name.substr(name.size() - 28);
+
+            std::cout << std::left << std::setw(32) << name << std::right
+                      << std::setw(16) << static_cast<double>(by_value.bytes) / seconds
+                      << std::setw(16) << static_cast<double>(handoff.bytes) / seconds
+                      << std::setw(11) << (handoff.bytes ? static_cast<double>(by_value.bytes) / handoff.bytes : 0.0) << "x"
+                      << std::setw(16) << by_value.seconds / calls * 1e9
+                      << std::setw(14) << handoff.seconds / calls * 1e9 << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+// Lockstep engine benchmark
+// Runs 32 copies of each ROM (different seeds, and each copy holds a different key from frame 30 on)
+// three ways and reports aggregate emulated instructions per second over all copies:
+//   loop:      32 Machines, each stepped by its own emulate_instruction() loop
+//   execute:   32 Machines, each run with run_frame() (the default interpreter dispatch)
+//   lockstep:  one LockstepMachines with 32 lanes
+// and checks that every lane ended in the same state (registers, stack, RAM, display) as its scalar
+// copy. Exits with EXIT_FAILURE if any lane doesn't
+// Usage: lockstep_bench [--frames F] <rom> [rom...]
+#include "Chip8/Core.hpp"
+#include "Chip8/Cpu.hpp"
+#include "Chip8/Lockstep.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+constexpr size_t COPIES = Chip8::LockstepMachines::LANES;
+constexpr uint64_t KEY_FRAME = 30;
+
+// What makes copy `lane` different from the others
+static void setup_copy(Chip8::Machine& machine, size_t lane) {
+    Chip8::seed_random(machine, static_cast<uint32_t>(lane + 1));
+}
+
+static void press_key(Chip8::Machine& machine, size_t lane) {
+    machine.keypad[lane % 16] = true;
+}
+
+// Everything a lane holds, compared with the scalar machine it has to match
+static bool same_state(const Chip8::Machine& a, const Chip8::Machine& b) {
+    return a.V == b.V && a.I == b.I && a.PC == b.PC && a.stack_ptr == b.stack_ptr && a.stack == b.stack &&
+           a.flags == b.flags && a.delay_timer == b.delay_timer && a.sound_timer == b.sound_timer &&
+           a.ram == b.ram && a.hires == b.hires && a.display == b.display;
+}
+
+// 32 scalar machines, stepped one after the other. Returns wall seconds, the machines are left in `machines`
+template <typename RunFrame>
+static double run_scalar(const char* rom, uint64_t frames, std::vector<Chip8::Machine>& machines, RunFrame run_frame) {
+    machines.clear();
+    machines.resize(COPIES);
+    for (size_t l = 0; l < COPIES; l++) {
+        Chip8::load_rom(machines[l], rom);
+        setup_copy(machines[l], l);
+    }
+
+    const auto start = steady_clock::now();
+    for (size_t l = 0; l < COPIES; l++) {
+        for (uint64_t f = 0; f < frames; f++) {
+            if (f == KEY_FRAME) press_key(machines[l], l);
+            run_frame(machines[l]);
+        }
+    }
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t frames = 6000;     // 100 emulated seconds
+    std::vector<const char*> roms;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) frames = std::stoull(argv[++i]);
+        else roms.push_back(argv[i]);
+    }
+
+    if (roms.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--frames F] <rom> [rom...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Uncapped: as fast as the host goes, ints_per_second only sets the instructions per frame
+    Config config;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(32) << "ROM" << std::right
+              << std::setw(10) << "loop" << std::setw(10) << "execute" << std::setw(10) << "lockstep"
+              << std::setw(12) << "vs loop" << std::setw(12) << "vs execute" << std::setw(12) << "lanes/step"
+              << "   (aggregate MIPS over " << COPIES << " copies)\n";
+
+    size_t failed = 0;  // ROMs with a lane that differs
+
+    try {
+        for (const char* rom : roms) {
+            std::vector<Chip8::Machine> loop_machines, execute_machines;
+
+            const double loop = run_scalar(rom, frames, loop_machines, [&](Chip8::Machine& machine) {
+                const uint64_t n = Chip8::frame_cycles(machine, config);
+                for (uint64_t i = 0; i < n; i++) Chip8::emulate_instruction(machine, config);
+                machine.cycles += n;
+                Chip8::tick_timers(machine);
+            });
+
+            const double execute = run_scalar(rom, frames, execute_machines, [&](Chip8::Machine& machine) {
+                Chip8::run_frame(machine, config);
+            });
+
+            Chip8::Machine prototype;
+            Chip8::load_rom(prototype, rom);
+            auto lanes = Chip8::make_lockstep();
+            Chip8::load_lockstep(*lanes, prototype, COPIES);
+            for (size_t l = 0; l < COPIES; l++) Chip8::seed_lane(*lanes, l, static_cast<uint32_t>(l + 1));
+
+            const auto start = steady_clock::now();
+            for (uint64_t f = 0; f < frames; f++) {
+                if (f == KEY_FRAME) {
+                    for (size_t l = 0; l < COPIES; l++) Chip8::set_lane_key(*lanes, l, l % 16, true);
+                }
+                Chip8::run_frame_lockstep(*lanes, config);
+            }
+            const double lockstep = duration<double>(steady_clock::now() - start).count();
+
+            // Every lane has to match its scalar copy, or the speed means nothing
+            size_t mismatches = 0;
+            for (size_t l = 0; l < COPIES; l++) {
+                Chip8::Machine lane;
+                Chip8::store_lane(*lanes, l, lane);
+                if (!same_state(lane, execute_machines[l]) || !same_state(loop_machines[l], execute_machines[l])) {
+                    mismatches++;
+                }
+            }
+            if (mismatches) failed++;
+
+            const double instructions = static_cast<double>(lanes->cycles) * COPIES;
+
+            std::string name = rom;
+            if (name.size() > 31) name = "..." + name.substr(name.size() - 28);
+
+            std::cout << std::left << std::setw(32) << name << std::right
+                      << std::setw(10) << instructions / loop / 1e6
+                      << std::setw(10) << instructions / execute / 1e6
+                      << std::setw(10) << instructions / lockstep / 1e6
+                      << std::setw(11) << loop / lockstep << "x"
+                      << std::setw(11) << execute / lockstep << "x"
+                      << std::setw(12) << static_cast<double>(lanes->lane_instructions) / lanes->steps;
+            if (mismatches) std::cout << "   " << mismatches << " LANES DIFFER";
+            std::cout << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+// Rewind buffer benchmark
+// Plays each ROM for a while, storing every frame in a RewindBuffer like the frontend does, then
+// rewinds all the way back and checks every restored frame against what the machine looked like then.
+// Reports memory per second of history (against full Snapshots) and the per frame cost of push/rewind
+// Usage: rewind_bench [--seconds S] <rom> [rom...]
+#include "Chip8/Core.hpp"
+#include "Chip8/Rewind.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// What a restored frame has to match
+struct Check {
+    uint64_t framebuffer_hash;
+    uint64_t cycles;
+    uint32_t rng;
+    uint16_t PC;
+};
+
+static Check check(const Chip8::Machine& machine) {
+    return Check{Chip8::framebuffer_hash(machine), machine.cycles, machine.rng, machine.PC};
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t seconds = 60;
+    std::vector<const char*> roms;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc) seconds = std::stoull(argv[++i]);
+        else roms.push_back(argv[i]);
+    }
+
+    if (roms.empty() || seconds == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--seconds S] <rom> [rom...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Config config;
+    const uint64_t frames = seconds * 60;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(32) << "ROM" << std::right
+              << std::setw(12) << "KB/s" << std::setw(14) << "full KB/s" << std::setw(10) << "ratio"
+              << std::setw(12) << "push ns" << std::setw(12) << "rewind ns" << std::setw(12) << "frame ns"
+              << "   (per second/frame of history)\n";
+
+    try {
+        for (const char* rom : roms) {
+            Chip8::Machine machine;
+            Chip8::load_rom(machine, rom);
+            Chip8::RewindBuffer rewind(frames);
+
+            std::vector<Check> history;
+            history.reserve(frames);
+
+            double emulate = 0.0;
+            double push = 0.0;
+            for (uint64_t f = 0; f < frames; f++) {
+                const auto start = steady_clock::now();
+                Chip8::run_frame(machine, config);
+                const auto ran = steady_clock::now();
+                rewind.push(machine);
+                push += duration<double, std::nano>(steady_clock::now() - ran).count();
+                emulate += duration<double, std::nano>(ran - start).count();
+                history.push_back(check(machine));
+            }
+
+            const double bytes_per_second = static_cast<double>(rewind.bytes_used()) / seconds;
+
+            // A full snapshot holds as much RAM as the machine has, 4KB here unless it's XO-CHIP
+            const double full = static_cast<double>(offsetof(Chip8::Snapshot, ram) + machine.ram_mask + 1u);
+
+            // Back to the first frame, every step has to land exactly on the frame stored then
+            size_t wrong = 0;
+            const auto start = steady_clock::now();
+            for (uint64_t f = frames; f-- > 0;) {
+                if (!rewind.rewind(machine)) {
+                    wrong++;
+                    break;
+                }
+                const Check now = check(machine);
+                const Check& then = history[f];
+                if (now.framebuffer_hash != then.framebuffer_hash || now.cycles != then.cycles ||
+                    now.rng != then.rng || now.PC != then.PC) {
+                    wrong++;
+                }
+            }
+            const double back = duration<double, std::nano>(steady_clock::now() - start).count();
+
+            std::string name = rom;
+            if (name.size() > 31) name = "..." + name.substr(name.size() - 28);
+
+            std::cout << std::left << std::setw(32) << name << std::right
+                      << std::setw(12) << bytes_per_second / 1024
+                      << std::setw(14) << full * 60.0 / 1024
+                      << std::setw(9) << full * 60.0 / bytes_per_second << "x"
+                      << std::setw(12) << push / frames
+                      << std::setw(12) << back / frames
+                      << std::setw(12) << emulate / frames;
+            if (wrong) std::cout << "   " << wrong << " FRAMES RESTORED WRONG";
+            std::cout << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+// Save state latency benchmark
+// Runs each ROM for a while so the state is realistic, then times, per call:
+//   snapshot:        snapshot() into a Snapshot
+//   restore:         restore() of a snapshot taken a frame earlier (same code, decode cache kept)
+//   restore + run:   restore() and one frame of emulation, what a rewind/replay loop pays per frame
+//   serialize:       serialize_state() to the binary format
+//   deserialize:     deserialize_state() of that data, checksum and validation included
+// and checks that a restored machine runs on exactly like the original
+// Usage: savestate_bench [--iterations N] <rom> [rom...]
+#include "Chip8/Core.hpp"
+#include "Chip8/SaveState.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// Frames run before measuring, so RAM, display and decode cache are those of a ROM in play
+constexpr uint64_t WARMUP_FRAMES = 600;
+
+// Average nanoseconds per call of f over n calls
+template <typename F>
+static double time_ns(uint64_t n, F f) {
+    const auto start = steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) f(i);
+    return duration<double, std::nano>(steady_clock::now() - start).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = 100000;
+    std::vector<const char*> roms;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) iterations = std::stoull(argv[++i]);
+        else roms.push_back(argv[i]);
+    }
+
+    if (roms.empty() || iterations == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--iterations N] <rom> [rom...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Config config;
+
+    std::cout << "sizeof(Snapshot) = " << sizeof(Chip8::Snapshot) << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(32) << "ROM" << std::right
+              << std::setw(12) << "snapshot" << std::setw(12) << "restore" << std::setw(16) << "restore+run"
+              << std::setw(12) << "serialize" << std::setw(14) << "deserialize" << std::setw(12) << "file size"
+              << "   (ns per call, bytes)\n";
+
+    try {
+        for (const char* rom : roms) {
+            Chip8::Machine machine;
+            Chip8::load_rom(machine, rom);
+            for (uint64_t f = 0; f < WARMUP_FRAMES; f++) Chip8::run_frame(machine, config);
+
+            // Two states a frame apart, so restore really has to change something
+            Chip8::Snapshot before, after;
+            Chip8::snapshot(machine, before);
+            Chip8::run_frame(machine, config);
+            Chip8::snapshot(machine, after);
+
+            Chip8::Snapshot target;
+            const double snapshot = time_ns(iterations, [&](uint64_t) { Chip8::snapshot(machine, target); });
+
+            const double restore = time_ns(iterations, [&](uint64_t i) {
+                Chip8::restore(machine, (i & 1) ? after : before);
+            });
+
+            const double restore_run = time_ns(iterations, [&](uint64_t) {
+                Chip8::restore(machine, before);
+                Chip8::run_frame(machine, config);
+            });
+
+            // Restoring and running again has to land on the same state as the first time
+            Chip8::Snapshot replayed;
+            Chip8::snapshot(machine, replayed);
+            const bool same = replayed.ram == after.ram && replayed.display == after.display &&
+                              replayed.V == after.V && replayed.PC == after.PC && replayed.I == after.I &&
+                              replayed.rng == after.rng && replayed.cycles == after.cycles;
+
+            std::vector<uint8_t> data;
+            const double serialize = time_ns(iterations, [&](uint64_t) { data = Chip8::serialize_state(machine); });
+            const double deserialize = time_ns(iterations, [&](uint64_t) { Chip8::deserialize_state(machine, data); });
+
+            std::string name = rom;
+            if (name.size() > 31) name = "..." + name.substr(name.size() - 28);
+
+            std::cout << std::left << std::setw(32) << name << std::right
+                      << std::setw(12) << snapshot << std::setw(12) << restore << std::setw(16) << restore_run
+                      << std::setw(12) << serialize << std::setw(14) << deserialize << std::setw(12) << data.size();
+            if (!same) std::cout << "   RESTORED RUN DIFFERS";
+            std::cout << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+// Core benchmark suite, results as JSON for comparing builds and releases
+//   opcode:  ns per emulate_instruction() for each opcode class, on a program made of just that opcode
+//   dxyn:    ns per DXYN for several sprite heights, aligned/unaligned and clipped at the right/bottom edge,
+//            and on 2 and 4 XO-CHIP planes
+//   quirks:  ns per emulate_instruction() for the opcodes the quirk profiles disagree on, on each profile
+//   rom:     MIPS running real ROMs for a fixed number of cycles, interpreter and JIT
+//   reset:   ns per reset of each ROM from its cached image, and per load_rom() of it from the file
+// Everything runs from a fixed RNG seed and a fixed program, so runs on the same host are comparable
+// Usage: suite_bench [--json results.json] [--cycles N] [--repeat R] [rom...]
+#include "bench_json.hpp"
+#include "Chip8/Core.hpp"
+#include "Chip8/Cpu.hpp"
+#include "Chip8/Jit.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+
+// Code starts at 0x200, subroutines at 0x800, data (sprites, FX33/FX55 targets) at 0xE00
+constexpr uint16_t CODE = 0x200;
+constexpr uint16_t SUBROUTINE = 0x800;
+constexpr uint16_t DATA = 0xE00;
+
+// Copies of the opcode in a row before the jump back, so the jump is under 1% of the instructions
+constexpr size_t COPIES = 256;
+
+struct OpcodeCase {
+    const char* name;
+    uint16_t opcode;
+    std::function<void(Chip8::Machine&)> setup;
+};
+
+static void write_word(Chip8::Machine& machine, uint16_t addr, uint16_t word) {
+    machine.ram[addr] = static_cast<uint8_t>(word >> 8);
+    machine.ram[addr + 1] = static_cast<uint8_t>(word);
+}
+
+// A machine running COPIES x opcode, 1200 forever
+static void build(Chip8::Machine& machine, uint16_t opcode) {
+    machine.reset();
+    for (size_t i = 0; i < COPIES; i++) write_word(machine, static_cast<uint16_t>(CODE + 2 * i), opcode);
+    write_word(machine, static_cast<uint16_t>(CODE + 2 * COPIES), 0x1000 | CODE);
+    write_word(machine, SUBROUTINE, 0x00EE);
+    for (uint16_t i = 0; i < 16; i++) machine.ram[DATA + i] = static_cast<uint8_t>(0xFF ^ (i * 0x11));
+}
+
+// emulate_instruction() n times. I is put back on the data area first, FX1E/FX55/FX65 move it,
+// and the VIP profile's display wait is ended, no timer ticks here to end it
+static void step(Chip8::Machine& machine, const Config& config, uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        machine.I = DATA;
+        machine.vblank_wait = false;
+        Chip8::emulate_instruction(machine, config);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string json_path;
+    uint64_t cycles = 20'000'000;
+    uint64_t micro_iterations = 2'000'000;
+    int repeat = 5;
+    std::vector<std::string> roms;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) json_path = argv[++i];
+        else if (arg == "--cycles" && i + 1 < argc) cycles = std::stoull(argv[++i]);
+        else if (arg == "--iterations" && i + 1 < argc) micro_iterations = std::stoull(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--help") {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--json results.json] [--cycles N] [--iterations N] [--repeat R] [rom...]" << std::endl;
+            return EXIT_SUCCESS;
+        }
+        else roms.push_back(arg);
+    }
+
+    // The ROM runs measure executing instructions, not skipping a wait loop's
+    Config config;
+    config.skip_idle = false;
+    std::vector<BenchResult> results;
+
+    try {
+        // Opcode classes. Skips are measured not taken and taken, they take different paths
+        const auto v = [](uint8_t x, uint8_t value) {
+            return [=](Chip8::Machine& m) { m.V[x] = value; };
+        };
+        const std::vector<OpcodeCase> opcodes = {
+            {"00E0 clear",              0x00E0, nullptr},
+            {"1NNN jump",               0x1000 | CODE, nullptr},
+            {"2NNN+00EE call/return",   0x2000 | SUBROUTINE, nullptr},
+            {"3XNN skip not taken",     0x3A01, v(0xA, 0)},
+            {"3XNN skip taken",         0x3A00, v(0xA, 0)},
+            {"5XY0 skip not taken",     0x5AB0, v(0xB, 1)},
+            {"6XNN load",               0x6A55, nullptr},
+            {"7XNN add",                0x7A01, nullptr},
+            {"8XY0 move",               0x8AB0, nullptr},
+            {"8XY1 or",                 0x8AB1, nullptr},
+            {"8XY4 add carry",          0x8AB4, v(0xB, 0x81)},
+            {"8XY5 sub borrow",         0x8AB5, v(0xB, 0x03)},
+            {"8XY6 shift right",        0x8AB6, v(0xA, 0xAA)},
+            {"8XYE shift left",         0x8ABE, v(0xA, 0xAA)},
+            {"ANNN set I",              0xA000 | DATA, nullptr},
+            {"CXNN random",             0xCAFF, nullptr},
+            {"EX9E key not pressed",    0xEA9E, nullptr},
+            {"FX07 read delay",         0xFA07, nullptr},
+            {"FX15 set delay",          0xFA15, nullptr},
+            {"FX1E add I",              0xFA1E, v(0xA, 3)},
+            {"FX29 font",               0xFA29, v(0xA, 7)},
+            {"FX33 BCD",                0xFA33, v(0xA, 239)},
+            {"FX55 store V0-VF",        0xFF55, nullptr},
+            {"FX65 load V0-VF",         0xFF65, nullptr},
+        };
+
+        for (const OpcodeCase& op : opcodes) {
+            Chip8::Machine machine;
+            build(machine, op.opcode);
+            if (op.setup) op.setup(machine);
+
+            results.push_back(time_ns_per_op("opcode", op.name, micro_iterations, repeat, [&](uint64_t n) {
+                step(machine, config, n);
+            }));
+        }
+
+        // DXYN: sprite heights, byte aligned or not, clipped by the right or bottom edge
+        struct DrawCase {
+            const char* where;
+            uint8_t x;
+            uint8_t y;
+        };
+        const DrawCase positions[] = {
+            {"aligned",         8,  4},
+            {"unaligned",       13, 4},
+            {"clip right",      60, 4},
+            {"clip bottom",     13, 28},
+            {"clip corner",     60, 28},
+        };
+
+        for (const uint8_t height : {1, 5, 8, 15}) {
+            for (const DrawCase& at : positions) {
+                Chip8::Machine machine;
+                build(machine, static_cast<uint16_t>(0xDAB0 | height));
+                machine.V[0xA] = at.x;
+                machine.V[0xB] = at.y;
+
+                const std::string name = "D" + std::to_string(height) + " " + at.where;
+                results.push_back(time_ns_per_op("dxyn", name, micro_iterations, repeat, [&](uint64_t n) {
+                    step(machine, config, n);
+                }));
+            }
+        }
+
+        // XO-CHIP: the same sprite on 2 and 4 planes, each plane another sprite's worth of bytes from I
+        for (const uint8_t planes : {0x3, 0xF}) {
+            for (const uint8_t height : {5, 15}) {
+                Chip8::Machine machine;
+                machine.quirks = Chip8::Quirks::XOCHIP;
+                machine.xochip = true;
+                build(machine, static_cast<uint16_t>(0xDAB0 | height));
+                machine.planes = planes;
+                machine.V[0xA] = 13;
+                machine.V[0xB] = 4;
+
+                const std::string name = "D" + std::to_string(height) + " unaligned, " +
+                                         (planes == 0x3 ? "2" : "4") + " planes";
+                results.push_back(time_ns_per_op("dxyn", name, micro_iterations, repeat, [&](uint64_t n) {
+                    step(machine, config, n);
+                }));
+            }
+        }
+
+        // The opcodes quirk profiles disagree on. Every profile is an interpreter of its own with the
+        // quirks compiled in, so each should cost what it does on MODERN, give or take what it does differently
+        const std::vector<OpcodeCase> quirk_opcodes = {
+            {"8XY1 or",                 0x8AB1, nullptr},
+            {"8XY6 shift right",        0x8AB6, v(0xA, 0xAA)},
+            {"BNNN jump",               0xB000 | CODE, v(0x0, 0)},
+            {"FX55 store V0-VF",        0xFF55, nullptr},
+            {"FX65 load V0-VF",         0xFF65, nullptr},
+            {"D5 clip/wrap corner",     0xDAB5, [](Chip8::Machine& m) { m.V[0xA] = 60; m.V[0xB] = 28; }},
+        };
+
+        for (uint32_t q = 0; q < Chip8::QUIRKS_COUNT; q++) {
+            const Chip8::Quirks quirks = static_cast<Chip8::Quirks>(q);
+            for (const OpcodeCase& op : quirk_opcodes) {
+                Chip8::Machine machine;
+                machine.quirks = quirks;
+                machine.xochip = quirks == Chip8::Quirks::XOCHIP;
+                build(machine, op.opcode);
+                if (op.setup) op.setup(machine);
+
+                const std::string name = std::string(op.name) + ", " + std::string(Chip8::quirks_name(quirks));
+                results.push_back(time_ns_per_op("quirks", name, micro_iterations, repeat, [&](uint64_t n) {
+                    step(machine, config, n);
+                }));
+            }
+        }
+
+        // Real ROMs, frame sized batches with a timer tick in between like run_frame()
+        auto run_rom = [&](const std::string& rom, const char* engine, Chip8::Jit* jit) {
+            std::vector<double> mips;
+            uint64_t hash = 0;
+            for (int r = 0; r < repeat; r++) {
+                Chip8::Machine machine;
+                machine.quirks = Chip8::rom_quirks(rom);
+                Chip8::load_rom(machine, rom);
+
+                const auto start = std::chrono::steady_clock::now();
+                while (machine.cycles < cycles) {
+                    const uint64_t batch = std::min(Chip8::frame_cycles(machine, config), cycles - machine.cycles);
+                    Chip8::run_cycles(machine, config, batch, jit);
+                    Chip8::tick_timers(machine);
+                }
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                mips.push_back(cycles / seconds / 1e6);
+                hash = Chip8::framebuffer_hash(machine);
+            }
+            std::sort(mips.begin(), mips.end());
+
+            BenchResult result;
+            result.group = "rom";
+            result.name = rom + " " + engine;
+            result.unit = "MIPS";
+            result.best = mips.back();
+            result.median = mips[mips.size() / 2];
+            result.iterations = cycles;
+
+            // Same seed and cycles every run, so the final display is a regression check too
+            std::ostringstream note;
+            note << "framebuffer_hash=" << std::hex << std::setw(16) << std::setfill('0') << hash;
+            result.note = note.str();
+            results.push_back(result);
+        };
+
+        std::unique_ptr<Chip8::Jit> jit;
+        if (Chip8::Jit::supported()) jit = std::make_unique<Chip8::Jit>();
+
+        for (const std::string& rom : roms) {
+            run_rom(rom, "interpreter", nullptr);
+            if (jit) run_rom(rom, "jit", jit.get());
+        }
+
+        // Resets, what the L key and batch input scripts do, against loading the file again
+        for (const std::string& rom : roms) {
+            Chip8::Machine machine;
+            machine.quirks = Chip8::rom_quirks(rom);
+            Chip8::load_rom(machine, rom);
+
+            results.push_back(time_ns_per_op("reset", rom + " reset", micro_iterations / 10, repeat, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; i++) Chip8::reset_chip8(machine);
+            }));
+            results.push_back(time_ns_per_op("reset", rom + " load_rom", micro_iterations / 100, repeat, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; i++) Chip8::load_rom(machine, rom);
+            }));
+        }
+
+        print_table(std::cout, results);
+
+        if (!json_path.empty()) {
+            std::ofstream out(json_path);
+            if (!out) {
+                throw std::runtime_error("Failed to open " + json_path);
+            }
+
+            const std::vector<std::pair<std::string, std::string>> meta = {
+                {"compiler", __VERSION__},
+                {"dispatch", std::to_string(static_cast<int>(Chip8::DEFAULT_DISPATCH))},
+                {"jit", jit ? "yes" : "no"},
+                {"repeat", std::to_string(repeat)},
+            };
+            write_json(out, "core", meta, results);
+            std::cout << "Results: " << json_path << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
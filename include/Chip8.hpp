@@ -1,9 +1,43 @@
 #pragma once
 #include "Config.hpp"
+#include "Chip8/Decode.hpp"
+#include "Chip8/Quirks.hpp"
 #include <array>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
+
+// Guest profiler support in run_cycles() (see Chip8/Profiler.hpp), make PROFILER=0 compiles it out
+#ifndef CHIP8_PROFILER
+    #define CHIP8_PROFILER 1
+#endif
 
 namespace Chip8 {
+    class Profiler;
+    struct RomImage;
+    struct CodeMap;
+
+    // Display, bit-packed: two uint64_t per row, column 0 in the most significant bit of the first
+    // SUPER-CHIP's 128x64 hi-res mode uses all of it. The 64x32 lo-res mode uses the first word of
+    // the first 32 rows only, so a lo-res draw or hash touches exactly what it did before hi-res
+    static_assert(Config::hires_width == 128, "Framebuffer packs a 128 pixel row into two uint64_t");
+    using DisplayRow = std::array<uint64_t, 2>;
+    using Framebuffer = std::array<DisplayRow, Config::hires_height>;
+
+    // XO-CHIP draws on up to 4 bitplanes, each a Framebuffer of its own so a draw or a scroll on one
+    // is the same word ops as on a monochrome display. CHIP-8 and SUPER-CHIP only ever use plane 0
+    constexpr uint32_t MAX_PLANES = 4;
+    constexpr uint8_t ALL_PLANES = (1u << MAX_PLANES) - 1;
+    using Display = std::array<Framebuffer, MAX_PLANES>;
+
+    // Dirty row mask, one bit per display row
+    static_assert(Config::hires_height <= 64, "Dirty rows are tracked in a uint64_t");
+    constexpr uint64_t ALL_ROWS = ~0ull;
+
+    // CXNN random number generator state a new Machine starts with
+    constexpr uint32_t DEFAULT_RNG_SEED = 0x2545F491;
+
     // Emulator states
     enum class EmulatorState {
         // state that emulator is running in
@@ -12,14 +46,11 @@ namespace Chip8 {
         PAUSED,
     };
 
-    // Chip8 instruction format
-    struct Instruction {
-        uint16_t opcode; // 2 byte opcode
-        uint16_t NNN;    // 12-bit Address/constant
-        uint8_t NN;      // 8-bit constant
-        uint8_t N;       // 4-bit constant
-        uint8_t X;       // 4-bit register identifier
-        uint8_t Y;       // 4-bit register identifier
+    // What a machine stuck in a wait loop is waiting for, as the last run_cycles() call found it
+    enum class IdleWait : uint8_t {
+        NONE,       // Running, or not known to be waiting
+        TIMER,      // Polling the delay timer (FX07), nothing changes before the next tick
+        INPUT,      // Waiting on the keypad (FX0A, EX9E/EXA1 polls), or spinning where only input or a reset helps
     };
 
     // Chip8 Machine object
@@ -27,13 +58,29 @@ namespace Chip8 {
         // Core components
         EmulatorState state = EmulatorState::RUNNING;   // Default machine state
 
-        // Use std::array instead of C-style arrays for type safety and bounds checking.
-        std::array<uint8_t, 4096> ram{};  // the ram was 4k. 4096 8bytes
+        // Quirk profile the ROM runs with (see Chip8/Quirks.hpp). Set before loading the ROM, not touched by reset()
+        Quirks quirks = Quirks::MODERN;
+
+        // XO-CHIP machine: 64KB of RAM, 4 bitplanes and the XO-CHIP opcodes. Otherwise those opcodes
+        // do what they always did (nothing) and RAM wraps at 4KB. Loading the ROM sets it, for the
+        // XO-CHIP profile
+        bool xochip = false;
+        uint16_t ram_mask = 0x0FFF;     // Every RAM address is masked with this: 0xFFF, or 0xFFFF in XO-CHIP
 
-        // 64*32 resolution, cause that is how many pixel we will be emulating. Its easier this way
-        // the display was 256 bytes. from 0xF00 to 0xFFF
-        std::array<bool, 64 * 32> display{};    // 256 * 8(bytes) = 2048 = 64*32
-        // or make display a pointer. DXYN display = &ram[0xF00]; offset after display[10]
+        // the ram was 4k. XO-CHIP has 64k, so it is sized for the mode: ram_mask + 1 bytes, see resize_memory()
+        // On the heap rather than inline, a 64KB array made every Machine (CHIP8 ones too) too big
+        // for a worker thread's stack. The allocation is 16 byte aligned, which is what snapshots
+        // need to copy it every frame at full speed
+        std::vector<uint8_t> ram = std::vector<uint8_t>(0x1000);
+
+        // 64*32 resolution, cause that is how many pixel we will be emulating
+        // the display was 256 bytes. from 0xF00 to 0xFFF, and packed like this it is 256 bytes again
+        // SUPER-CHIP's 128*64 is 1KB, lo-res uses the top left quarter of it
+        // One such framebuffer per XO-CHIP bitplane, the others stay blank outside XO-CHIP
+        Display display{};              // 4 planes * 64 rows * 16 bytes = 4KB
+        uint64_t dirty_rows = ALL_ROWS; // Rows 00E0/DXYN/scrolls changed (on any plane) since the frontend last took them
+        bool hires = false;             // 128x64 after 00FF, 64x32 after 00FE (and at reset)
+        uint8_t planes = 1;             // Planes XO-CHIP's FN01 selected for drawing, clearing and scrolling, bit 0 is plane 0
 
 
         // Registers
@@ -56,6 +103,20 @@ namespace Chip8 {
         // Timers
         uint8_t delay_timer = 0;    // Decrements at 60hz when > 0. More for games to move enemy
         uint8_t sound_timer = 0;    // Decrements at 60hz and plays tone when > 0
+        bool vblank_wait = false;   // VIP profile: a DXYN waits for the next tick, nothing runs until it clears this
+
+
+        // SUPER-CHIP "RPL user flags", FX75 saves V0 - VX here and FX85 loads them back
+        // On the HP48 they survived turning the calculator off, here they last until reset
+        std::array<uint8_t, 16> flags{};
+
+
+        // XO-CHIP audio: while the sound timer runs, a 128 bit pattern (F002 loads it from RAM) is
+        // played 1 bit per sample at 4000 * 2^((pitch - 64) / 48) samples per second (FX3A sets the pitch)
+        // Until a ROM loads a pattern it gets the normal tone
+        std::array<uint8_t, 16> pattern{};
+        uint8_t pitch = 64;             // 4000hz
+        bool audio_pattern = false;     // F002 has run since reset
 
 
         // Input
@@ -63,32 +124,91 @@ namespace Chip8 {
 
 
         // System
-        // Instead of const char*, use std::string_view for safer string handling.
-        std::string_view rom_name;      // To store the name of the rom that is currently loaded
+        // Owned, so it outlives whatever string the path was loaded from
+        std::string rom_name;           // To store the name of the rom that is currently loaded
+        std::shared_ptr<const RomImage> rom;    // Its pristine RAM, what reset_chip8() copies back (Chip8/RomCache.hpp)
+        Quirks rom_quirks = Quirks::MODERN;     // `quirks` when it was loaded, reset_chip8() goes back to it
+        // Where its code is (Chip8/Analyzer.hpp), if a code map was loaded for it. reset_chip8() decodes
+        // it into the emptied decode cache again, init_chip8() drops it with the old ROM
+        std::shared_ptr<const CodeMap> code_map;
 
         Instruction current_inst{};     // Currently executing instruction
 
+        // Predecoded instructions per RAM address, invalidated when FX33/FX55 write over them
+        DecodeCache decode_cache{};
+
+        // CXNN random numbers, xorshift32 state. Per machine instead of rand() so machines running on
+        // different threads don't share (and race on) one generator, and each run is reproducible from its seed
+        // Not touched by reset(), like srand() wasn't
+        uint32_t rng = DEFAULT_RNG_SEED;
+
+        // Counts every instruction while set, the ROM runs on the interpreter meanwhile. Not touched by reset()
+        Profiler* profiler = nullptr;
+
+        // Bookkeeping for the headless core (run_cycles/run_frame)
+        uint64_t cycles = 0;    // Instructions executed since the ROM was loaded
+        uint64_t frames = 0;    // 60hz frames (timer ticks) since the ROM was loaded
+
+        // Idle loop skipping (run_cycles with config.skip_idle)
+        IdleWait idle = IdleWait::NONE;
+        uint64_t idle_cycles = 0;       // Of `cycles`, how many were skipped in wait loops instead of executed
+        uint32_t idle_backoff = 0;      // run_cycles() calls to go before looking for a wait loop again
+        uint32_t idle_misses = 0;       // Looks in a row that found none
+
         // RESET
         void reset() {
-            ram.fill(0);
-            display.fill(false);
+            reset_state();
+            std::fill(ram.begin(), ram.end(), 0);
+        }
+
+        // Everything reset() resets but RAM, for resets that copy RAM in whole from a RomImage
+        void reset_state() {
+            resize_memory();
+            for (Framebuffer& plane : display) plane.fill(DisplayRow{});
+            dirty_rows = ALL_ROWS;
+            hires = false;
+            planes = 1;
             V.fill(0);
+            flags.fill(0);
+            pattern.fill(0);
+            pitch = 64;
+            audio_pattern = false;
             stack.fill(0);
             stack_ptr = 0;
             I = 0;
             PC = 0x200;
             delay_timer = 0;
             sound_timer = 0;
+            vblank_wait = false;
             keypad.fill(false);
+            decode_cache.clear();
+            cycles = 0;
+            frames = 0;
+            idle = IdleWait::NONE;
+            idle_cycles = 0;
+            idle_backoff = 0;
+            idle_misses = 0;
             state = EmulatorState::RUNNING;
         }
+
+        // RAM and the decode cache as big as `xochip` says, 4KB or 64KB. Bytes below the new size
+        // keep their value and new ones are zero. Nothing is allocated when the size is unchanged
+        void resize_memory() {
+            ram_mask = xochip ? 0xFFFF : 0x0FFF;
+            ram.resize(ram_mask + 1u);
+            decode_cache.resize(ram.size());
+        }
     };
 
     // Initialization and core functions
+    // Load the ROM at rom_name through the ROM cache (the file is read, but only a ROM never seen
+    // before is built into an image) and reset the machine into it
     void init_chip8(Machine& machine, std::string_view rom_name);
 
-    // Handle the input
-    void handle_input(Machine& machine, Config& config);
+    // Back to the state init_chip8() left the machine in, without touching the filesystem: one copy
+    // of the ROM's pristine RAM and the registers cleared. Also goes back to the quirk profile the
+    // ROM was loaded with (rom_quirks), a state load may have changed it. The code map, if any, is prewarmed again
+    void reset_chip8(Machine& machine);
 }
 
 #include "Chip8/Cpu.hpp"
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+#include "Chip8.hpp"
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Static ROM analysis: what a ROM is before any of it runs
+// A disassembler, a control-flow graph followed from the entry point along jumps, calls and skips,
+// a map of which ROM bytes are code, sprites or other data, and the deepest chain of calls the code
+// can make. The chip8-analyze tool (src/analyze.cpp) writes all of it out, plus a code map: the
+// instructions and basic blocks found, which the emulator loads to decode (and with --jit, compile)
+// them before the first instruction runs rather than as the PC first reaches each one
+// Static means best effort. Code only reached through a BNNN the jump table scan can't follow, or
+// through RAM the ROM writes itself, isn't found, and is left to the usual lazy decode at runtime
+namespace Chip8 {
+    // Which op an opcode runs as on a profile. Opcodes a profile doesn't have fall back the way the
+    // interpreter's handlers do: SUPER-CHIP and XO-CHIP display ops to 0NNN, the rest to INVALID
+    Op profile_op(uint16_t opcode, Quirks quirks);
+
+    // Assembly for one instruction, Cowgod's mnemonics with SUPER-CHIP's and XO-CHIP's additions,
+    // e.g "LD I, 0x22A" or "DRW V0, V1, 5". `next` is the word after it, only F000's address
+    // An opcode the profile doesn't have reads "DW 0x...."
+    std::string disassemble(uint16_t opcode, Quirks quirks = Quirks::MODERN, uint16_t next = 0);
+
+    // What each ROM byte was found to be. Ordered by precedence: a byte something draws and that
+    // also runs is CODE, one that is drawn and also saved or loaded is a SPRITE
+    enum class ByteKind : uint8_t {
+        UNKNOWN,    // Nothing reachable reads or runs it
+        DATA,       // Read or written through I: FX33, FX55, FX65, 5XY2, 5XY3, F002
+        SPRITE,     // Drawn by a DXYN
+        CODE,       // Part of an instruction
+    };
+
+    // A straight run of instructions, entered only at `start` and left only after the last one
+    struct BasicBlock {
+        uint16_t start = 0;
+        uint16_t end = 0;                   // One past the last instruction's bytes
+        std::vector<uint16_t> successors;   // Where it goes next inside the ROM, taken branch last
+        uint16_t call = 0;                  // 2NNN target if it ends in a call, else 0. Returns to `end`
+        bool returns = false;               // Ends in 00EE
+        bool indirect = false;              // Ends in BNNN. successors are the jump table found at NNN
+    };
+
+    struct RomAnalysis {
+        Quirks quirks = Quirks::MODERN;
+        uint64_t rom_hash = 0;              // RomImage::hash of the ROM analyzed
+        size_t size = 0;                    // ROM bytes, from 0x200
+
+        std::vector<ByteKind> kinds;        // Per ROM byte, kinds[0] is 0x200
+        std::vector<uint16_t> instructions; // Address of every instruction found, ascending
+        std::vector<BasicBlock> blocks;     // By start address
+        std::vector<uint16_t> routines;     // 0x200 and every 2NNN target, ascending
+        std::vector<uint16_t> jump_targets; // 1NNN and jump table targets, ascending, for labels
+
+        uint32_t max_stack_depth = 0;       // Most return addresses the calls found can stack up
+        bool recursive = false;             // A routine can call itself, so the stack has no static bound
+        uint32_t indirect_jumps = 0;        // BNNNs reached
+        uint32_t unresolved_jumps = 0;      // Those without a jump table at NNN, their targets are unknown
+        bool self_modifying = false;        // FX33/FX55/5XY2 can write over code
+        uint32_t leaves_rom = 0;            // Jumps, calls and fall-throughs to addresses outside the ROM
+        uint32_t invalid = 0;               // Opcodes the profile doesn't have, on a path that was followed
+    };
+
+    // Analyze a ROM as loaded for `quirks`: its bytes are image.ram from 0x200, image.size of them
+    RomAnalysis analyze_rom(const RomImage& image, Quirks quirks);
+
+    // Bytes of each kind
+    size_t count_kind(const RomAnalysis& analysis, ByteKind kind);
+
+    // The ROM as assembly: labels for the entry point, subroutines and jump targets, code one
+    // instruction per line, sprites one row per line with their pixels, other data 8 bytes per line
+    void write_listing(std::ostream& out, const RomAnalysis& analysis, const RomImage& image);
+
+    // Byte counts, blocks, routines, stack depth and whatever would make the analysis incomplete
+    void write_summary(std::ostream& out, const RomAnalysis& analysis);
+
+    // What the emulator needs from an analysis to get ahead of the PC
+    struct CodeMap {
+        uint64_t rom_hash = 0;
+        Quirks quirks = Quirks::MODERN;     // Decoding and blocks depend on the profile
+        std::vector<uint16_t> instructions; // Addresses to decode
+        std::vector<uint16_t> blocks;       // Basic block starts to compile
+    };
+
+    CodeMap code_map(const RomAnalysis& analysis);
+
+    // Where the emulator looks for a ROM's code map unless told otherwise: the ROM path plus ".c8map"
+    std::string code_map_path(std::string_view rom_path);
+
+    // Binary format, integers little endian:
+    //   "C8CM"  u16 version  u64 ROM hash  u8 quirk profile  u32 instruction count  u32 block count
+    //   u64 FNV-1a of the address bytes, then every instruction address and every block start, u16 each
+    // load_code_map() throws std::runtime_error on anything that isn't a complete, intact code map
+    void save_code_map(const CodeMap& map, const std::string& path);
+    CodeMap load_code_map(const std::string& path);
+
+    // Decode every instruction in the map into the machine's decode cache, as if the PC had already
+    // been everywhere the analysis found. Call it right after load_rom(), changes nothing the ROM sees
+    // Keep the map in machine.code_map and reset_chip8() does it again after every reset
+    // Throws std::runtime_error if the map is for a different ROM or profile than the machine's
+    // Returns the instructions decoded (odd addresses have no cache slot, see DecodeCache)
+    size_t prewarm_decode_cache(Machine& machine, const CodeMap& map);
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "Chip8.hpp"
+#include "Chip8/Concurrent.hpp"
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Chip8 {
+    // The sound timer turning the tone on or off, at the instruction count it happened at
+    // An XO-CHIP machine that loaded a pattern (F002) plays that instead of the tone, a new pattern or
+    // pitch while it plays is an event too
+    struct SoundEvent {
+        uint64_t cycle = 0;
+        bool on = false;
+        bool pattern = false;
+        uint8_t pitch = 64;
+        std::array<uint8_t, 16> bits{};
+
+        // Same sound, whenever it happened
+        bool sounds_like(const SoundEvent& other) const {
+            return on == other.on && pattern == other.pattern && pitch == other.pitch && bits == other.bits;
+        }
+    };
+
+    // CHIP8 tone generator
+    // The emulation thread reports the sound timer going on and off with track(), stamped with
+    // machine.cycles, and the events go to the audio side through a lock-free SPSC queue. render()
+    // turns the stamps into sample positions (cycle * sample_rate / ints_per_second), so the tone
+    // starts and stops at the exact sample on the emulated timeline. The tone is one period of a
+    // band-limited square wave (odd harmonics below Nyquist), precomputed as a wavetable and read with
+    // a 32 bit phase accumulator, so a sample costs a table lookup and a multiply
+    // XO-CHIP patterns are 128 1-bit samples played at 4000 * 2^((pitch - 64) / 48) bits a second
+    // (FX3A), on a second accumulator whose top 7 bits pick the bit
+    //
+    // Realtime: render() is the audio device's callback and plays the timeline a fixed latency behind
+    // the emulation. Events that arrive late, or too far ahead (fast-forward, rewind, a reset), move
+    // the timeline back to now + latency, so timing recovers on the next event
+    // Offline: render() follows the emulated timeline exactly from sample 0, for writing a WAV
+    //
+    // track() is for the emulation thread, render() for one audio thread (or the emulation thread
+    // when offline), set_volume() for any thread
+    class AudioEngine {
+    public:
+        // `latency` is in samples, one audio callback's worth is enough
+        AudioEngine(uint32_t sample_rate, uint32_t tone_hz, uint32_t ints_per_second, bool realtime,
+                    uint32_t latency = 512);
+
+        // Report the tone if it changed: on while the sound timer runs and the machine isn't paused,
+        // with the machine's pattern and pitch when it has one
+        void track(const Machine& machine);
+
+        void set_volume(int16_t volume) { level.store(volume, std::memory_order_relaxed); }
+
+        // Fill `samples` samples of mono int16 audio
+        void render(int16_t* out, size_t samples);
+
+        // Offline: render everything up to `cycle` onto the end of `out`
+        void render_until(uint64_t cycle, std::vector<int16_t>& out);
+
+        // Position of an instruction count on the emulated timeline
+        uint64_t sample_at(uint64_t cycle) const { return cycle * sample_rate / ints_per_second; }
+
+        // Samples rendered so far
+        uint64_t rendered() const { return played; }
+
+    private:
+        static constexpr uint32_t TABLE_BITS = 11;
+        static constexpr size_t TABLE_SIZE = size_t{1} << TABLE_BITS;
+
+        // Where the pending event goes on the output, moving the timeline to it if it has to
+        uint64_t place(uint64_t now);
+
+        const uint64_t sample_rate;
+        const uint64_t ints_per_second;
+        const bool realtime;
+        const uint32_t latency;
+
+        std::vector<float> table;       // One period of the tone, peak 1.0
+        uint32_t phase = 0;
+        uint32_t step = 0;              // Phase increment per sample, tone_hz / sample_rate * 2^32
+
+        std::atomic<int16_t> level{0};
+
+        // Emulation thread
+        SpscQueue<SoundEvent, 64> events;
+        SoundEvent reported;            // Sound as last pushed
+
+        // Render side
+        SoundEvent pending;
+        bool has_pending = false;
+        bool sounding = false;
+        SoundEvent playing;             // The event sounding started or last changed with
+        uint32_t pattern_phase = 0;
+        uint32_t pattern_step = 0;      // bits a second / sample_rate * 2^25, 2^32 is the whole pattern
+        bool synced = false;
+        int64_t offset = 0;             // Output sample = timeline sample + offset
+        uint64_t played = 0;
+    };
+
+    // Write mono 16 bit PCM samples as a WAV file. Throws std::runtime_error if it can't be written
+    void write_wav(const std::string& path, const std::vector<int16_t>& samples, uint32_t sample_rate);
+}
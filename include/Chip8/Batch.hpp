@@ -0,0 +1,50 @@
+#pragma once
+#include "Chip8/Core.hpp"
+#include <string>
+#include <vector>
+
+// Batch runs: many headless machines (ROM x config x frames x input) spread over all cores
+namespace Chip8 {
+    // An input event applied at the start of a given frame
+    struct ScriptedInput {
+        uint64_t frame = 0;
+        InputEvent event;
+    };
+
+    struct BatchJob {
+        std::string rom_path;
+        Config config;
+        uint64_t frames = 0;                    // 60hz frames to run
+        uint32_t seed = DEFAULT_RNG_SEED;       // CXNN random number seed
+        Quirks quirks = Quirks::MODERN;         // Profile to run with, XOCHIP for .xo8 ROMs
+        std::vector<ScriptedInput> input;       // Sorted by frame
+        std::string input_path;                 // Where input came from, for the results file
+    };
+
+    struct BatchResult {
+        uint64_t framebuffer_hash = 0;
+        uint64_t cycles = 0;
+        uint64_t frames = 0;
+        double wall_seconds = 0.0;
+        std::string error;                      // Empty if the job ran to the end
+    };
+
+    // Job list, one job per line, '#' starts a comment:
+    //   <rom> <frames> [ips=<ints_per_second>] [seed=<n>] [input=<script>]
+    //                  [quirks=<modern|xochip|vip|schip>] [xochip=<0|1>]
+    // xochip=1 is quirks=xochip and xochip=0 quirks=modern
+    // Relative ROM and script paths are taken relative to the job list's directory
+    // Throws std::runtime_error with the line number on a malformed line
+    std::vector<BatchJob> load_job_list(const std::string& path);
+
+    // Input script, one event per line, '#' starts a comment:
+    //   <frame> <key 0-F> <down|up>
+    std::vector<ScriptedInput> load_input_script(const std::string& path);
+
+    // Run one job on the calling thread. Errors (missing ROM, stack overflow...) end up in BatchResult::error
+    BatchResult run_job(const BatchJob& job);
+
+    // Run every job on `threads` worker threads (0 = one per core) with work stealing
+    // Results are in job order
+    std::vector<BatchResult> run_batch(const std::vector<BatchJob>& jobs, unsigned threads = 0);
+}
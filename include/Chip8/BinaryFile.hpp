@@ -0,0 +1,89 @@
+#pragma once
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The file formats' common parts, shared by save states (SaveState.cpp), movies (Movie.cpp) and
+// code maps (Analyzer.cpp): little endian integers no matter the host, so a file moves between
+// machines, and a 4 byte magic followed by a u16 version at the start of every file
+// Each format names itself ("save state", "movie", "code map") and every error below says which
+// one it was about
+namespace Chip8 {
+    struct Writer {
+        std::vector<uint8_t>& out;
+
+        void put(uint64_t value, size_t bytes) {
+            for (size_t i = 0; i < bytes; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+        void u8(uint8_t value) { put(value, 1); }
+        void u16(uint16_t value) { put(value, 2); }
+        void u32(uint32_t value) { put(value, 4); }
+        void u64(uint64_t value) { put(value, 8); }
+
+        void magic(const char (&magic)[4], uint16_t version) {
+            out.insert(out.end(), std::begin(magic), std::end(magic));
+            u16(version);
+        }
+    };
+
+    // Throws std::runtime_error("<What> is truncated") on a read past the end
+    struct Reader {
+        const uint8_t* data;
+        size_t size;
+        const char* what;
+        size_t pos = 0;
+
+        uint64_t get(size_t bytes) {
+            if (size - pos < bytes) {
+                std::string message = what;
+                message[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(message[0])));
+                throw std::runtime_error(message + " is truncated");
+            }
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes; i++) value |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+            return value;
+        }
+        uint8_t u8() { return static_cast<uint8_t>(get(1)); }
+        uint16_t u16() { return static_cast<uint16_t>(get(2)); }
+        uint32_t u32() { return static_cast<uint32_t>(get(4)); }
+        uint64_t u64() { return get(8); }
+
+        // Checks the file is at least header_size bytes and starts with `magic`, returns the version
+        uint16_t magic(const char (&magic)[4], size_t header_size) {
+            if (size < header_size || std::memcmp(data, magic, sizeof(magic)) != 0) {
+                throw std::runtime_error(std::string("Not a CHIP8 ") + what);
+            }
+            pos = sizeof(magic);
+            return u16();
+        }
+    };
+
+    inline void write_file(const std::string& path, const std::vector<uint8_t>& data, const char* what) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            throw std::runtime_error(std::string("Failed to write ") + what + " " + path);
+        }
+    }
+
+    // Read the file at `path` whole and parse it with `parse(data)`, returning what that does
+    // Errors from parsing get the path in front, so the message says which file was bad
+    template <typename Parse>
+    auto load_file(const std::string& path, const char* what, Parse parse) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error(std::string("Failed to open ") + what + " " + path);
+        }
+        const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        try {
+            return parse(data);
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free building blocks for handing data between the emulation thread and the frontend thread
+// Both are for exactly one producer thread and one consumer thread
+namespace Chip8 {
+    // Keeps the producer and consumer indices on separate cache lines
+    constexpr size_t CACHE_LINE = 64;
+
+    // Bounded single-producer single-consumer ring buffer
+    // Indices only ever grow, the slot is index % Capacity, so full vs empty needs no spare slot
+    template <typename T, size_t Capacity>
+    class SpscQueue {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        // Producer only. False if the queue is full
+        bool push(const T& item) {
+            const size_t write = write_index.load(std::memory_order_relaxed);
+            if (write - read_index.load(std::memory_order_acquire) == Capacity) return false;
+
+            slots[write & (Capacity - 1)] = item;
+            write_index.store(write + 1, std::memory_order_release);   // Publishes the slot
+            return true;
+        }
+
+        // Consumer only. False if the queue is empty
+        bool pop(T& item) {
+            const size_t read = read_index.load(std::memory_order_relaxed);
+            if (read == write_index.load(std::memory_order_acquire)) return false;
+
+            item = slots[read & (Capacity - 1)];
+            read_index.store(read + 1, std::memory_order_release);     // Hands the slot back
+            return true;
+        }
+
+    private:
+        std::array<T, Capacity> slots{};
+        alignas(CACHE_LINE) std::atomic<size_t> read_index{0};
+        alignas(CACHE_LINE) std::atomic<size_t> write_index{0};
+    };
+
+    // Triple buffer: the producer always has a slot to write (back), the consumer always has a
+    // slot to read (front), and the third (middle) holds the newest finished value between them.
+    // Neither side ever waits; a consumer that falls behind just skips to the newest value
+    template <typename T>
+    class TripleBuffer {
+    public:
+        // Producer only. The slot to fill before publish()
+        T& back() { return slots[back_index]; }
+
+        // Producer only. Make back() the newest value and take the middle slot to write next
+        void publish() {
+            back_index = middle.exchange(back_index | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        // Consumer only. Swap in the newest value if one was published since the last acquire()
+        bool acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+            front_index = middle.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+        // Consumer only. Unchanged until the next acquire()
+        const T& front() const { return slots[front_index]; }
+
+    private:
+        static constexpr uint8_t INDEX = 0x3;
+        static constexpr uint8_t FRESH = 0x4;      // Middle holds a value the consumer hasn't seen
+
+        std::array<T, 3> slots{};
+        alignas(CACHE_LINE) std::atomic<uint8_t> middle{1};
+        alignas(CACHE_LINE) uint8_t back_index = 0;     // Producer's
+        alignas(CACHE_LINE) uint8_t front_index = 2;    // Consumer's
+    };
+}
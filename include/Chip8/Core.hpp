@@ -0,0 +1,103 @@
+#pragma once
+#include "Chip8.hpp"
+#include "Chip8/Concurrent.hpp"
+
+// Headless emulator core API
+// Everything declared here is built into libchip8.a and has no SDL dependency,
+// so it can be driven without a window, audio device or event pump
+namespace Chip8 {
+    class Jit;
+
+    // Register/timer view of the machine, returned by value so callers can't poke the core
+    struct CpuState {
+        std::array<uint8_t, 16> V;
+        uint16_t I;
+        uint16_t PC;
+        uint8_t stack_ptr;
+        uint8_t delay_timer;
+        uint8_t sound_timer;
+        uint64_t cycles;
+        uint64_t frames;
+    };
+
+    // Input for a machine running on another thread. The frontend pushes these into an InputQueue
+    // and the emulation thread applies them between batches of instructions
+    struct InputEvent {
+        enum class Type : uint8_t {
+            KEY_DOWN,       // key is a CHIP8 key, 0x0 - 0xF
+            KEY_UP,
+            TOGGLE_PAUSE,
+            RESET,          // Restart the current ROM from its image in the ROM cache
+            SAVE_STATE,     // Save the machine to state_path(rom_name)
+            LOAD_STATE,     // and load it back
+            REWIND_START,   // Rewind held down, for the frontend's RewindBuffer. The machine ignores these
+            REWIND_STOP,
+            FAST_FORWARD_START, // Speed is up to the frontend's loop too, ignored by the machine
+            FAST_FORWARD_STOP,
+            TOGGLE_UNCAPPED,
+            QUIT,
+        };
+
+        Type type = Type::KEY_DOWN;
+        uint8_t key = 0;
+    };
+
+    using InputQueue = SpscQueue<InputEvent, 256>;
+
+    // Apply one input event to the machine (keypad, pause, reset, save/load state, quit)
+    // A failed save or load is reported on stderr and leaves the machine running as it was
+    void apply_input(Machine& machine, const InputEvent& event);
+
+    // Load a ROM into a freshly reset machine. Set machine.quirks first for a ROM that needs another
+    // profile than MODERN, XOCHIP for an XO-CHIP ROM (see rom_quirks())
+    void load_rom(Machine& machine, std::string_view rom_path);
+
+    // True for a .xo8 file, the extension XO-CHIP ROMs conventionally have
+    bool xochip_rom_name(std::string_view rom_path);
+
+    // The profile a ROM runs with unless told otherwise: XOCHIP for a .xo8 file, MODERN for anything else
+    // CHIP-8 and SUPER-CHIP ROMs share the .ch8 extension, the others have to be asked for
+    Quirks rom_quirks(std::string_view rom_path);
+
+    // Seed the machine's CXNN random number generator. Same seed, same ROM and same input give the same run
+    void seed_random(Machine& machine, uint32_t seed);
+
+    // Execute up to n instructions, without touching the timers
+    // Returns how many were actually executed (less than n only if the machine QUITs)
+    // With a Jit the instructions run as recompiled native blocks instead of through the interpreter,
+    // unless machine.profiler is set
+    // With config.skip_idle a wait loop's passes are skipped rather than run (see Chip8/Idle.hpp), and
+    // still counted in the return value and machine.cycles. machine.idle says what it was waiting for
+    uint64_t run_cycles(Machine& machine, const Config& config, uint64_t n, Jit* jit = nullptr);
+
+    // Instructions that make up the next 60hz frame at config.ints_per_second
+    // Spreads the remainder over frames so 700hz really is 700 instructions per second
+    uint64_t frame_cycles(const Machine& machine, const Config& config);
+
+    // Run one 60hz frame: frame_cycles() instructions, then one timer tick
+    void run_frame(Machine& machine, const Config& config, Jit* jit = nullptr);
+
+    // Decrement delay and sound timers once (60hz)
+    void tick_timers(Machine& machine);
+
+    // Read-only accessors
+    // The display planes, plane 0 is the whole display outside XO-CHIP. pixel() is lit on any plane
+    const Display& framebuffer(const Machine& machine);
+    bool pixel(const Machine& machine, uint32_t x, uint32_t y);
+    CpuState cpu_state(const Machine& machine);
+
+    // Resolution the machine is in right now: 64x32, or 128x64 in SUPER-CHIP hi-res
+    uint32_t screen_width(const Machine& machine);
+    uint32_t screen_height(const Machine& machine);
+
+    // Rows changed since the last call, and reset them. 0 means the last presented frame is still current
+    uint64_t take_dirty_rows(Machine& machine);
+
+    // Hash of the framebuffer as the current resolution shows it (every plane of it in XO-CHIP),
+    // to compare runs without dumping the display. FNV over the display words, each one mixed first
+    // so that any one pixel changes the whole hash
+    uint64_t framebuffer_hash(const Machine& machine);
+
+    // FNV-1a hash of any bytes (RAM, file contents), for checksums and "same ROM?" checks
+    uint64_t hash_bytes(const uint8_t* data, size_t size);
+}
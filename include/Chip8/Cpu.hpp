@@ -1,6 +1,42 @@
 #pragma once
 #include "Chip8.hpp"
 
+// Interpreter dispatch strategy, picked at build time with -DCHIP8_DISPATCH=...
+// (make release DISPATCH=SWITCH|TABLE|THREADED)
+#define CHIP8_DISPATCH_SWITCH 0     // One switch over the decoded op per instruction
+#define CHIP8_DISPATCH_TABLE 1      // Call through a handler table indexed by op
+#define CHIP8_DISPATCH_THREADED 2   // Computed goto, falls back to TABLE without GCC/Clang
+
+#ifndef CHIP8_DISPATCH
+    #if defined(__GNUC__)
+        #define CHIP8_DISPATCH CHIP8_DISPATCH_THREADED
+    #else
+        #define CHIP8_DISPATCH CHIP8_DISPATCH_TABLE
+    #endif
+#endif
+
 namespace Chip8 {
+    enum class Dispatch {
+        SWITCH = CHIP8_DISPATCH_SWITCH,
+        TABLE = CHIP8_DISPATCH_TABLE,
+        THREADED = CHIP8_DISPATCH_THREADED,
+    };
+
+    // What run_cycles() uses. All of them are always compiled in so they can be benchmarked side by side
+    constexpr Dispatch DEFAULT_DISPATCH = static_cast<Dispatch>(CHIP8_DISPATCH);
+
+    // Every function below runs the interpreter instantiated for machine.quirks (see Chip8/Quirks.hpp)
+    // There is one per quirk profile and dispatch strategy, with the quirks compiled into the handlers
+
+    // Emulate 1 machine instruction. Nothing, while a VIP profile machine waits for the display
     void emulate_instruction(Machine& machine, const Config& config);
-}
\ No newline at end of file
+
+    // Emulate n machine instructions with the given dispatch strategy, returns n
+    // On the VIP profile a DXYN ends the run: the rest of the n go by waiting for the display
+    template <Dispatch D>
+    uint64_t execute(Machine& machine, const Config& config, uint64_t n);
+
+    template <> uint64_t execute<Dispatch::SWITCH>(Machine& machine, const Config& config, uint64_t n);
+    template <> uint64_t execute<Dispatch::TABLE>(Machine& machine, const Config& config, uint64_t n);
+    template <> uint64_t execute<Dispatch::THREADED>(Machine& machine, const Config& config, uint64_t n);
+}
@@ -0,0 +1,196 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Chip8 {
+    // Chip8 instruction format
+    struct Instruction {
+        uint16_t opcode; // 2 byte opcode
+        uint16_t NNN;    // 12-bit Address/constant
+        uint8_t NN;      // 8-bit constant
+        uint8_t N;       // 4-bit constant
+        uint8_t X;       // 4-bit register identifier
+        uint8_t Y;       // 4-bit register identifier
+    };
+
+    // Every instruction the interpreter knows, one entry per handler
+    // Named after the opcode pattern they decode from
+    enum class Op : uint8_t {
+        NONE,       // Decode cache slot that hasn't been decoded yet
+        OP_00E0, OP_00EE, OP_0NNN,
+        OP_1NNN, OP_2NNN, OP_3XNN, OP_4XNN, OP_5XY0, OP_6XNN, OP_7XNN,
+        OP_8XY0, OP_8XY1, OP_8XY2, OP_8XY3, OP_8XY4, OP_8XY5, OP_8XY6, OP_8XY7, OP_8XYE,
+        OP_9XY0, OP_ANNN, OP_BNNN, OP_CXNN, OP_DXYN,
+        OP_EX9E, OP_EXA1,
+        OP_FX07, OP_FX0A, OP_FX15, OP_FX18, OP_FX1E, OP_FX29, OP_FX33, OP_FX55, OP_FX65,
+        // SUPER-CHIP: scrolls, exit, resolution switch, big font and the RPL flags
+        OP_00CN, OP_00FB, OP_00FC, OP_00FD, OP_00FE, OP_00FF,
+        OP_FX30, OP_FX75, OP_FX85,
+        // XO-CHIP: scroll up, register range save/load, long I, plane select, audio pattern and pitch
+        OP_00DN, OP_5XY2, OP_5XY3, OP_F000, OP_FN01, OP_F002, OP_FX3A,
+        INVALID,    // Wrong/unimplemented opcode
+    };
+
+    constexpr size_t OP_COUNT = static_cast<size_t>(Op::INVALID) + 1;
+
+    // Which op a 2 byte opcode is
+    // constexpr so the interpreter can bake it into a 64K entry table at compile time
+    constexpr Op decode_op(uint16_t opcode) {
+        const uint8_t NN = opcode & 0x00FF;
+        const uint8_t N = opcode & 0x000F;
+
+        switch (opcode >> 12) {
+            case 0x0:
+                // if else because there are only 2 cases where they start with 0
+                if (NN == 0xE0) return Op::OP_00E0;
+                if (NN == 0xEE) return Op::OP_00EE;
+                // SUPER-CHIP and XO-CHIP add their display ops here, the rest of 0NNN stays machine code calls
+                if ((opcode >> 8) == 0x00) {
+                    if ((NN & 0xF0) == 0xC0 && N != 0) return Op::OP_00CN;  // 00C0 would scroll by 0
+                    if ((NN & 0xF0) == 0xD0 && N != 0) return Op::OP_00DN;
+                    if (NN == 0xFB) return Op::OP_00FB;
+                    if (NN == 0xFC) return Op::OP_00FC;
+                    if (NN == 0xFD) return Op::OP_00FD;
+                    if (NN == 0xFE) return Op::OP_00FE;
+                    if (NN == 0xFF) return Op::OP_00FF;
+                }
+                return Op::OP_0NNN;
+            case 0x1: return Op::OP_1NNN;
+            case 0x2: return Op::OP_2NNN;
+            case 0x3: return Op::OP_3XNN;
+            case 0x4: return Op::OP_4XNN;
+            case 0x5:
+                if (N == 0) return Op::OP_5XY0;
+                if (N == 2) return Op::OP_5XY2;
+                if (N == 3) return Op::OP_5XY3;
+                return Op::INVALID; // Any other N is the wrong opcode
+            case 0x6: return Op::OP_6XNN;
+            case 0x7: return Op::OP_7XNN;
+            case 0x8:
+                switch (N) {
+                    case 0x0: return Op::OP_8XY0;
+                    case 0x1: return Op::OP_8XY1;
+                    case 0x2: return Op::OP_8XY2;
+                    case 0x3: return Op::OP_8XY3;
+                    case 0x4: return Op::OP_8XY4;
+                    case 0x5: return Op::OP_8XY5;
+                    case 0x6: return Op::OP_8XY6;
+                    case 0x7: return Op::OP_8XY7;
+                    case 0xE: return Op::OP_8XYE;
+                    default: return Op::INVALID;
+                }
+            case 0x9: return (N == 0) ? Op::OP_9XY0 : Op::INVALID;
+            case 0xA: return Op::OP_ANNN;
+            case 0xB: return Op::OP_BNNN;
+            case 0xC: return Op::OP_CXNN;
+            case 0xD: return Op::OP_DXYN;
+            case 0xE:
+                if (NN == 0x9E) return Op::OP_EX9E;
+                if (NN == 0xA1) return Op::OP_EXA1;
+                return Op::INVALID;
+            default:
+                switch (NN) {
+                    case 0x07: return Op::OP_FX07;
+                    case 0x0A: return Op::OP_FX0A;
+                    case 0x15: return Op::OP_FX15;
+                    case 0x18: return Op::OP_FX18;
+                    case 0x1E: return Op::OP_FX1E;
+                    case 0x29: return Op::OP_FX29;
+                    case 0x33: return Op::OP_FX33;
+                    case 0x55: return Op::OP_FX55;
+                    case 0x65: return Op::OP_FX65;
+                    case 0x30: return Op::OP_FX30;
+                    case 0x75: return Op::OP_FX75;
+                    case 0x85: return Op::OP_FX85;
+                    case 0x3A: return Op::OP_FX3A;
+                    case 0x01: return Op::OP_FN01;
+                    case 0x00: return (opcode == 0xF000) ? Op::OP_F000 : Op::INVALID;
+                    case 0x02: return (opcode == 0xF002) ? Op::OP_F002 : Op::INVALID;
+                    default: return Op::INVALID;
+                }
+        }
+    }
+
+    // An instruction with its op worked out and its operands already extracted
+    struct DecodedInst {
+        Instruction inst;
+        Op op = Op::NONE;
+    };
+
+    // Decode a 2 byte opcode, op and operands
+    DecodedInst decode(uint16_t opcode);
+
+    // Generation numbers for DecodeCache, unique across every cache in the process
+    inline uint64_t next_decode_generation() {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // Per-address cache of decoded instructions, built lazily as the PC reaches each address
+    // Instructions are 2 bytes and (almost always) aligned, so only even addresses get a slot.
+    // Odd PCs (e.g. BNNN with an odd V0) are decoded every time instead
+    // Sized like the RAM it caches (see resize()), only the part between lo and hi is ever touched
+    struct DecodeCache {
+        std::vector<DecodedInst> entries = std::vector<DecodedInst>(0x1000 / 2);
+
+        // Lowest/highest address decoded so far, so writes to data never have to touch the cache
+        uint16_t lo = 0xFFFF;
+        uint16_t hi = 0;
+
+        // Changed whenever decoded code is dropped, so anything built on top of the cache (the JIT)
+        // knows to throw its own translations away. Taken from a process wide counter rather than
+        // counted per cache: every freshly loaded Machine would otherwise be at the same generation,
+        // and one created where an old one used to live would look like the same machine
+        uint64_t generation = next_decode_generation();
+
+        // Slot for an address below the RAM size, or nullptr if the address can't be cached
+        DecodedInst* lookup(uint16_t addr) {
+            if (addr & 1) return nullptr;
+            return &entries[addr >> 1];
+        }
+
+        DecodedInst& store(uint16_t addr, const DecodedInst& decoded) {
+            if (addr < lo) lo = addr;
+            if (addr > hi) hi = addr;
+            return entries[addr >> 1] = decoded;
+        }
+
+        // RAM from addr to addr+len-1 was written, drop every instruction that overlaps it
+        // An instruction at addr-1 has its low byte at addr, so start one byte early
+        void invalidate(uint16_t addr, uint16_t len) {
+            const uint32_t first = (addr > 0) ? addr - 1u : 0u;
+            const uint32_t last = static_cast<uint32_t>(addr) + len - 1;
+            if (last < lo || first > hi) return; // Nothing decoded in that range
+
+            bool dropped = false;
+            for (uint32_t a = first & ~1u; a <= last && (a >> 1) < entries.size(); a += 2) {
+                if (entries[a >> 1].op != Op::NONE) {
+                    entries[a >> 1].op = Op::NONE;
+                    dropped = true;
+                }
+            }
+            if (dropped) generation = next_decode_generation();
+        }
+
+        // Slots for ram_size bytes of RAM. A new size drops everything decoded so far
+        void resize(size_t ram_size) {
+            if (entries.size() == ram_size / 2) return;
+            entries.assign(ram_size / 2, DecodedInst{});
+            lo = 0xFFFF;
+            hi = 0;
+            generation = next_decode_generation();
+        }
+
+        void clear() {
+            // Nothing outside lo..hi was ever stored, so a small ROM's cache clears in a few hundred bytes
+            if (lo <= hi) std::fill(entries.begin() + lo / 2, entries.begin() + hi / 2 + 1, DecodedInst{});
+            lo = 0xFFFF;
+            hi = 0;
+            generation = next_decode_generation();
+        }
+    };
+}
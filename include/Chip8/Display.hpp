@@ -0,0 +1,150 @@
+#pragma once
+#include "Chip8.hpp"
+#include <algorithm>
+
+// Display ops, shared by the interpreter (Cpu.cpp) and the lockstep engine (Lockstep.cpp) so both
+// draw and scroll exactly alike
+// A row is 128 bits in two words, column 0 in the top bit of the first. A sprite row goes in with a
+// shift and an XOR per word, a horizontal scroll is a shift across the two words and a vertical one
+// moves whole rows, so nothing below loops over pixels. Lo-res only ever sets bits in the first word
+// XO-CHIP's bitplanes are a Framebuffer each, the ops below work on one plane and the Display
+// versions at the bottom run them over the planes FN01 selected
+namespace Chip8 {
+    constexpr uint32_t display_width(bool hires) { return hires ? Config::hires_width : Config::window_width; }
+    constexpr uint32_t display_height(bool hires) { return hires ? Config::hires_height : Config::window_height; }
+
+    // Planes a machine shows: all of them in XO-CHIP, only plane 0 otherwise
+    constexpr uint32_t display_planes(bool xochip) { return xochip ? MAX_PLANES : 1; }
+
+    // The rows the current mode shows, as a dirty row mask
+    constexpr uint64_t active_rows(bool hires) {
+        return hires ? ALL_ROWS : (uint64_t{1} << Config::window_height) - 1;
+    }
+
+    // 00E0
+    inline void clear_display(Framebuffer& display, uint64_t& dirty_rows) {
+        display.fill(DisplayRow{});
+        dirty_rows = ALL_ROWS;
+    }
+
+    // DXYN for one resolution, so the sizes are constants and lo-res has no hi-res branches at all
+    // Wrap (XO-CHIP) also fixes at compile time whether the edges clip or wrap, and Superchip
+    // whether DXY0 is a 16x16 sprite or, like on the VIP, draws nothing
+    template <bool Hires, bool Wrap, bool Superchip, typename Byte>
+    inline bool draw_sprite_rows(Framebuffer& display, uint64_t& dirty_rows, uint8_t vx, uint8_t vy, uint8_t n, Byte byte) {
+        constexpr uint32_t height = display_height(Hires);
+        const uint32_t x = vx % display_width(Hires);
+        const uint32_t y = vy % height;
+
+        const bool wide = Superchip && n == 0;
+        const uint32_t rows = wide ? 16 : n;
+        uint64_t collision = 0;
+
+        for (uint32_t i = 0; i < rows && (Wrap || y + i < height); i++) {
+            // The sprite row in the top bits, column 0 first like the display
+            const uint64_t bits = wide ? (static_cast<uint64_t>(byte(2 * i)) << 56 | static_cast<uint64_t>(byte(2 * i + 1)) << 48)
+                                       : static_cast<uint64_t>(byte(i)) << 56;
+            const uint32_t r = Wrap ? (y + i) % height : y + i;
+            DisplayRow& row = display[r];
+
+            if constexpr (Hires) {
+                // Moved right to column x. What passes column 63 goes on into the second word,
+                // what passes column 127 is clipped, or wrapped back into the first word
+                const uint64_t left = x < 64 ? bits >> x : (Wrap && x > 64) ? bits << (128 - x) : 0;
+                const uint64_t right = x >= 64 ? bits >> (x - 64) : x > 0 ? bits << (64 - x) : 0;
+                collision |= (row[0] & left) | (row[1] & right);
+                row[0] ^= left;
+                row[1] ^= right;
+                dirty_rows |= static_cast<uint64_t>((left | right) != 0) << r;
+            } else {
+                // Moved right to column x, what passes column 63 is clipped, or rotated back in at column 0
+                const uint64_t left = (Wrap && x > 0) ? (bits >> x | bits << (64 - x)) : bits >> x;
+                collision |= row[0] & left;
+                row[0] ^= left;
+                dirty_rows |= static_cast<uint64_t>(left != 0) << r;
+            }
+        }
+
+        return collision != 0;
+    }
+
+    // DXYN: XOR an N row sprite, 8 pixels wide, in at (vx, vy). DXY0 is SUPER-CHIP's 16x16 sprite,
+    // two bytes a row, without Superchip it is 0 rows. byte(i) is the sprite's i-th byte, RAM at I + i
+    // The start position wraps around the screen, the sprite itself is clipped at the right and
+    // bottom edges, or with Wrap carries on at the left and top ones
+    // Returns true if any lit pixel was turned off, for VF
+    template <bool Wrap = false, bool Superchip = true, typename Byte>
+    inline bool draw_sprite(Framebuffer& display, uint64_t& dirty_rows, bool hires,
+                            uint8_t vx, uint8_t vy, uint8_t n, Byte byte) {
+        return hires ? draw_sprite_rows<true, Wrap, Superchip>(display, dirty_rows, vx, vy, n, byte)
+                     : draw_sprite_rows<false, Wrap, Superchip>(display, dirty_rows, vx, vy, n, byte);
+    }
+
+    // 00CN: everything moves down n rows, blank rows come in at the top
+    inline void scroll_down(Framebuffer& display, uint64_t& dirty_rows, bool hires, uint32_t n) {
+        const uint32_t height = display_height(hires);
+        n = std::min(n, height);
+        std::copy_backward(display.begin(), display.begin() + (height - n), display.begin() + height);
+        std::fill(display.begin(), display.begin() + n, DisplayRow{});
+        dirty_rows |= active_rows(hires);
+    }
+
+    // 00DN: everything moves up n rows, blank rows come in at the bottom
+    inline void scroll_up(Framebuffer& display, uint64_t& dirty_rows, bool hires, uint32_t n) {
+        const uint32_t height = display_height(hires);
+        n = std::min(n, height);
+        std::copy(display.begin() + n, display.begin() + height, display.begin());
+        std::fill(display.begin() + (height - n), display.begin() + height, DisplayRow{});
+        dirty_rows |= active_rows(hires);
+    }
+
+    // 00FB: everything moves 4 pixels right, what passes the right edge is gone
+    inline void scroll_right(Framebuffer& display, uint64_t& dirty_rows, bool hires) {
+        const uint32_t height = display_height(hires);
+        for (uint32_t y = 0; y < height; y++) {
+            DisplayRow& row = display[y];
+            row[1] = hires ? (row[1] >> 4 | row[0] << 60) : 0;
+            row[0] >>= 4;
+        }
+        dirty_rows |= active_rows(hires);
+    }
+
+    // 00FC: everything moves 4 pixels left. The second word is always 0 in lo-res, so one case does both
+    inline void scroll_left(Framebuffer& display, uint64_t& dirty_rows, bool hires) {
+        const uint32_t height = display_height(hires);
+        for (uint32_t y = 0; y < height; y++) {
+            DisplayRow& row = display[y];
+            row[0] = row[0] << 4 | row[1] >> 60;
+            row[1] <<= 4;
+        }
+        dirty_rows |= active_rows(hires);
+    }
+
+    // Run f on each plane in the `planes` mask, plane 0 first
+    template <typename F>
+    inline void for_each_plane(Display& display, uint8_t planes, F f) {
+        for (uint32_t p = 0; p < MAX_PLANES; p++) {
+            if ((planes >> p) & 1) f(display[p]);
+        }
+    }
+
+    // DXYN on the selected planes. Each plane takes the next sprite's worth of bytes from I, plane 0
+    // first, and is drawn exactly like a monochrome display, so every plane costs what a CHIP-8 draw does
+    // Returns true if a lit pixel was turned off on any of them
+    template <bool Wrap = false, bool Superchip = true, typename Byte>
+    inline bool draw_sprite_planes(Display& display, uint8_t planes, uint64_t& dirty_rows, bool hires,
+                                   uint8_t vx, uint8_t vy, uint8_t n, Byte byte) {
+        // Plane 0 alone is all CHIP-8 and SUPER-CHIP ever draw on
+        if (planes == 1) return draw_sprite<Wrap, Superchip>(display[0], dirty_rows, hires, vx, vy, n, byte);
+
+        const uint32_t size = (Superchip && n == 0) ? 32 : n;
+        uint32_t offset = 0;
+        bool collision = false;
+        for_each_plane(display, planes, [&](Framebuffer& plane) {
+            collision |= draw_sprite<Wrap, Superchip>(plane, dirty_rows, hires, vx, vy, n,
+                                     [&](uint32_t i) { return byte(offset + i); });
+            offset += size;
+        });
+        return collision;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Chip8.hpp"
+#include "Chip8/Concurrent.hpp"
+
+namespace Chip8 {
+    // Immutable copy of the display handed from the core to the renderer
+    // Only the packed framebuffer and its resolution, never the rest of the Machine
+    struct Frame {
+        Display planes{};
+        uint64_t dirty_rows = 0;    // Rows that differ (on any plane) from the frame published before this one
+        bool hires = false;         // 128x64, otherwise only the lo-res 64x32 part of each plane is current
+        uint32_t plane_count = 1;   // Planes that are current: 1, or all of them for an XO-CHIP machine
+        uint64_t sequence = 0;      // 1 for the first published frame, 0 while nothing was published yet
+    };
+
+    // Frame handoff from the emulation thread to the render thread, through a triple buffer
+    // publish() fills the back slot and makes it the newest frame, latest() swaps the newest frame in
+    // and returns it by reference. The frame it returns is untouched until the next latest() call,
+    // so the renderer reads it without copying emulator state and without locks.
+    // Also works from a single thread, publish() then latest()
+    class FrameHandoff {
+    public:
+        // Emulation thread. Snapshot the display if anything was drawn since the last publish,
+        // and take its dirty rows. Returns false (and copies nothing) if the display didn't change
+        bool publish(Machine& machine);
+
+        // Render thread. The newest published frame
+        const Frame& latest();
+
+        // Emulation thread. Framebuffer bytes publish() has copied so far
+        uint64_t bytes_copied() const { return copied; }
+
+    private:
+        // Dirty rows of the last HISTORY published frames, to bring an old back slot up to date
+        static constexpr uint64_t HISTORY = 16;
+
+        TripleBuffer<Frame> buffers;
+        std::array<uint64_t, HISTORY> history{};
+        uint64_t published = 0;
+        uint64_t copied = 0;
+    };
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "Chip8.hpp"
+
+namespace Chip8 {
+    // Idle loop skipping
+    // Most ROMs spend their spare time in a wait loop: FX0A, an EX9E/EXA1 poll jumping back to
+    // itself, or FX07 polled until the delay timer runs out. Between two timer ticks nothing such a
+    // loop reads can change, so every pass through it leaves the machine exactly as it found it
+    //
+    // skip_idle() runs a few instructions on the interpreter looking for that: PC coming back to
+    // where it started with V and I unchanged, and nothing on the way that writes RAM, the display,
+    // the timers, the stack or the RNG. Once found, whole passes of the loop are counted as executed
+    // without running them. The state after them is the state before them, so cycles, frames,
+    // movies and hashes come out the same as running every instruction
+    //
+    // run_cycles() calls it when config.skip_idle is set and no profiler is attached
+
+    // Look for a wait loop at PC and skip over it, within a budget of n instructions
+    // Returns how many of the n it took care of, run or skipped. The caller runs the rest as usual
+    // Sets machine.idle to what the loop waits for (NONE if it found none) and adds the skipped
+    // instructions to machine.idle_cycles. After a look that finds nothing the next ones back off,
+    // up to every 32nd call, so busy code pays next to nothing for it
+    uint64_t skip_idle(Machine& machine, const Config& config, uint64_t n);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "Chip8.hpp"
+#include <vector>
+
+// The recompiler emits x86-64 machine code and needs mmap/mprotect to make it executable
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+    #define CHIP8_JIT_X64 1
+#else
+    #define CHIP8_JIT_X64 0
+#endif
+
+namespace Chip8 {
+    // Basic-block dynamic recompiler
+    // Translates straight-line runs of instructions (ending at 1NNN/00EE/BNNN/skip ops) into native
+    // x86-64 code that works directly on Machine::V, I, PC and ram. DXYN, FX0A and 2NNN are left to
+    // the interpreter. Blocks are thrown away when FX33/FX55 write over decoded code.
+    // CHIP-8 and SUPER-CHIP on the MODERN quirk profile only, other profiles run on the interpreter
+    // Owns an executable code buffer, so like SDLManager it manages it via object lifetime and can't be copied
+    class Jit {
+    public:
+        Jit();
+        ~Jit();
+
+        // Delete copy semantics
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+
+        // False on hosts the recompiler doesn't support, run() then just interprets. run() also
+        // interprets if the code buffer can't be made writable or executable at runtime
+        static bool supported();
+
+        // Emulate n machine instructions, returns n. Same results as execute<>() on the interpreter
+        uint64_t run(Machine& machine, const Config& config, uint64_t n);
+
+        // Compile the blocks starting at `starts` now rather than when the PC first gets to them, e.g
+        // the basic blocks of a code map (Chip8/Analyzer.hpp). Call it after the ROM is loaded, the
+        // blocks are dropped like any others if the machine or its code changes before they run
+        // Returns the blocks compiled, 0 if the machine's profile runs on the interpreter
+        uint64_t precompile(Machine& machine, const std::vector<uint16_t>& starts);
+
+        uint64_t blocks_compiled() const { return compiled; }
+        uint64_t flushes() const { return flush_count; }
+
+    private:
+        // Native block: void block(Machine*, const Config*), runs `length` instructions
+        struct Block {
+            void (*code)(Machine*, const Config*);
+            uint16_t length;
+        };
+
+        static constexpr int32_t NOT_COMPILED = -1;
+        static constexpr int32_t INTERPRET = -2;    // Starts with an op the JIT leaves to the interpreter
+
+        // Flush if the blocks are for another machine, or code that has since changed
+        void sync(const Machine& machine);
+        // Translate the block at `start`, or INTERPRET. Adds where the guest can go after it to `next`
+        int32_t compile(Machine& machine, uint16_t start, std::vector<uint16_t>* next = nullptr);
+
+        // compile() the block at `start` and a few of the blocks after it in one go, see make_writable()
+        int32_t compile_ahead(Machine& machine, uint16_t start);
+
+        // W^X flips of the code buffer, only when it isn't that way already. False if mprotect
+        // failed (e.g an SELinux policy that denies execmem): the JIT is then broken for good and
+        // everything runs on the interpreter
+        bool make_writable();
+        bool make_executable();
+        void flush();
+
+        uint8_t* code_buffer = nullptr;
+        size_t code_used = 0;
+        bool writable = false;      // Mapped read/write rather than read/execute
+        bool broken = false;
+
+        std::array<int32_t, 4096> block_at{};   // Block index per start address
+        std::vector<Block> blocks;
+
+        // Blocks belong to one machine's RAM. Any change of machine or of its code (decode cache generation)
+        // and they're all flushed
+        const Machine* owner = nullptr;
+        uint64_t generation = 0;
+        const uint8_t* ram = nullptr;   // owner->ram.data(), FX65 reads it directly
+
+        uint64_t compiled = 0;
+        uint64_t flush_count = 0;
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "Chip8.hpp"
+#include <memory>
+
+// Lockstep engine: many copies of one ROM (different input/seeds) stepped together, one decoded
+// instruction applied to every lane at once
+namespace Chip8 {
+    // Structure-of-arrays Machine, one lane per copy
+    // Each register is an array over lanes, so an instruction on all 32 lanes is one vector op
+    // (V[x] for all lanes is 32 contiguous bytes, an AVX2 register or two SSE registers)
+    struct LockstepMachines {
+        static constexpr size_t LANES = 32;
+        template <typename T> using Lanes = std::array<T, LANES>;
+
+        alignas(32) std::array<Lanes<uint8_t>, 16> V{};
+        alignas(32) Lanes<uint16_t> I{};
+        alignas(32) Lanes<uint16_t> PC{};
+        alignas(32) Lanes<uint8_t> delay_timer{};
+        alignas(32) Lanes<uint8_t> sound_timer{};
+        alignas(32) Lanes<uint8_t> stack_ptr{};
+        alignas(32) Lanes<uint16_t> keypad{};       // Bit k set while key k is down
+        alignas(32) Lanes<uint32_t> rng{};
+        alignas(32) Lanes<uint8_t> faulted{};       // 0xFF once a lane overflowed its stack, it stops there
+        alignas(32) Lanes<uint8_t> hires{};         // 1 in SUPER-CHIP 128x64 mode
+        alignas(32) std::array<Lanes<uint8_t>, 16> flags{};     // SUPER-CHIP FX75/FX85
+        std::array<Lanes<uint16_t>, 16> stack{};
+        Lanes<Framebuffer> display{};
+        Lanes<uint64_t> dirty_rows{};
+        // RAM is interleaved too: ram[addr] holds that byte for every lane, so when the lanes
+        // agree on I, FX55/FX65 move a register for all lanes with one vector load/store
+        alignas(32) std::array<Lanes<uint8_t>, 4096> ram{};
+
+        size_t lanes = LANES;   // Lanes in use, the others never run
+
+        // Code is fetched and decoded once for all lanes. That's only valid where every lane's RAM
+        // holds the same bytes, so addresses written with different values are flagged here
+        // and instructions there are fetched per lane
+        std::array<uint8_t, 4096> ram_differs{};
+        DecodeCache decode_cache{};
+
+        uint64_t cycles = 0;    // Instructions executed per lane
+        uint64_t frames = 0;
+
+        // How well the lanes stay together: lane_instructions / steps is the average lanes per step
+        uint64_t steps = 0;
+        uint64_t lane_instructions = 0;
+    };
+
+    // ~170KB (the decode cache is on the heap, the rest is inline), so create it on the heap
+    std::unique_ptr<LockstepMachines> make_lockstep();
+
+    // Copy a loaded machine into the first `lanes` lanes (1 - LANES)
+    // Lanes have 4KB of RAM and one plane and run the MODERN quirk profile, a machine on any other
+    // profile (XO-CHIP among them) throws std::runtime_error
+    void load_lockstep(LockstepMachines& machines, const Machine& prototype, size_t lanes);
+
+    // Copy one lane back out into a Machine, e.g to hash or render it
+    void store_lane(const LockstepMachines& machines, size_t lane, Machine& machine);
+
+    // Per lane input and random seed, which is what makes the copies different
+    void set_lane_key(LockstepMachines& machines, size_t lane, uint8_t key, bool down);
+    void seed_lane(LockstepMachines& machines, size_t lane, uint32_t seed);
+
+    // Execute n instructions on every lane. Lanes whose PCs (and code) agree run as one vector step;
+    // diverged lanes run in groups per PC, lowest PC first so they meet up again at the join point.
+    // Each lane ends up with exactly the results execute<>() gives for the same Machine
+    // Returns n
+    uint64_t run_lockstep(LockstepMachines& machines, const Config& config, uint64_t n);
+
+    // run_frame() for every lane: a 60hz frame of instructions, then one timer tick
+    void run_frame_lockstep(LockstepMachines& machines, const Config& config);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Chip8.hpp"
+#include <string>
+#include <vector>
+
+// Input movies: everything from outside the machine that a run depended on, stamped with the
+// instruction count it happened at, so the run can be replayed bit for bit without a window
+namespace Chip8 {
+    class Jit;
+
+    struct MovieEvent {
+        enum class Type : uint8_t {
+            TICK,       // tick_timers(), 60hz on the wall clock in the frontend
+            KEY_DOWN,
+            KEY_UP,
+        };
+
+        uint64_t cycle = 0;     // machine.cycles when it was applied, i.e before that instruction ran
+        Type type = Type::TICK;
+        uint8_t key = 0;
+    };
+
+    struct Movie {
+        uint32_t seed = DEFAULT_RNG_SEED;   // RNG state when recording started
+        Quirks quirks = Quirks::MODERN;     // Profile the ROM ran with
+        uint64_t ram_hash = 0;              // hash_bytes() of RAM when recording started: font and ROM
+        uint64_t cycles = 0;                // Instructions the recording ran
+        uint64_t framebuffer_hash = 0;      // Display at the end, what a replay has to arrive at
+        std::vector<MovieEvent> events;     // In the order they were applied
+    };
+
+    // Recording. Start right after the ROM is loaded and seeded, before any instruction runs
+    void start_movie(Movie& movie, const Machine& machine);
+    void record_tick(Movie& movie, const Machine& machine);
+    void record_key(Movie& movie, const Machine& machine, uint8_t key, bool down);
+    void end_movie(Movie& movie, const Machine& machine);
+
+    // Replay on a machine with the movie's ROM freshly loaded, as fast as the host goes
+    // Throws std::runtime_error if the ROM or the quirk profile isn't the one the movie was recorded with
+    // Returns true if the run ended on the same display as the recording
+    bool replay_movie(Machine& machine, const Config& config, const Movie& movie, Jit* jit = nullptr);
+
+    // Binary format, integers little endian:
+    //   "C8MV"  u16 version  u8 quirks (Quirks value)  u32 seed  u64 RAM hash  u64 cycles  u64 framebuffer hash
+    //   u32 event count  u64 FNV-1a of the event bytes
+    //   events: LEB128 varint of (cycles since the previous event << 6 | tick << 5 | down << 4 | key)
+    // About two bytes per event, so an hour of play is ~0.5MB, almost all of it timer ticks
+    // load_movie() throws std::runtime_error on anything that isn't a complete, intact movie
+    void save_movie(const Movie& movie, const std::string& path);
+    Movie load_movie(const std::string& path);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Chip8.hpp"
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+    // Guest profiler: where a ROM spends its instructions, in CHIP8 terms
+    // Counts executions per PC and per op, follows 2NNN/00EE to attribute every instruction to the
+    // call stack it ran under, and counts backward jumps to find the hot loops
+    //
+    // Attached with machine.profiler = &profiler. run_cycles() then runs every instruction through
+    // run() below instead of the interpreter's dispatch loop (or the JIT), so emulate_instruction()
+    // itself has no hooks at all and a machine without a profiler costs one pointer check per
+    // run_cycles() call. make PROFILER=0 compiles even that out
+    class Profiler {
+    public:
+        Profiler();
+
+        // Emulate n machine instructions on the interpreter, counting each one. Returns n
+        uint64_t run(Machine& machine, const Config& config, uint64_t n);
+
+        void clear();
+
+        uint64_t instructions() const { return total; }
+
+        // Flat profile: op classes, hottest addresses, routines (self and with callees),
+        // call graph edges and hot loops
+        void write_report(std::ostream& out, size_t top = 20) const;
+
+        // One line per call stack, "main;sub_2A4;sub_310 <instructions>", the input flamegraph.pl
+        // and speedscope take
+        void write_folded(std::ostream& out) const;
+
+        // write_report() to path and write_folded() to path + ".folded"
+        // Throws std::runtime_error if either can't be written
+        void save(const std::string& path) const;
+
+    private:
+        // A distinct call stack, as a node in a tree of them. Node 0 is the ROM's entry point
+        struct Node {
+            uint32_t parent;
+            uint16_t routine;       // Address the stack's innermost routine was called at
+        };
+
+        // Past this many distinct call stacks new calls are counted in the caller's stack,
+        // only a ROM recursing through many different paths gets anywhere near it
+        static constexpr size_t MAX_NODES = 1 << 16;
+
+        uint32_t call(uint16_t target);
+        std::string stack_name(uint32_t node) const;
+
+        std::array<uint64_t, 0x10000> pc_counts{};   // XO-CHIP's 64KB, CHIP8 only uses the first 4KB
+        std::array<uint16_t, 0x10000> opcodes{};               // Last opcode run at each address, for the report
+        std::array<uint64_t, OP_COUNT> op_counts{};
+        uint64_t total = 0;
+
+        std::vector<Node> nodes;
+        std::vector<uint64_t> node_counts;                      // Instructions run with exactly this stack
+        std::unordered_map<uint64_t, uint32_t> children;        // parent << 16 | routine -> node
+        std::vector<uint32_t> path;                             // Shadow of the guest's return stack
+        uint32_t node = 0;
+
+        std::unordered_map<uint32_t, uint64_t> calls;           // caller routine << 16 | callee -> calls
+        std::unordered_map<uint32_t, uint64_t> back_edges;      // jump source << 16 | target -> taken
+    };
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// Quirk profiles: the interpreters CHIP-8 ROMs were written for disagree on a handful of opcodes,
+// and a ROM only runs right with the behaviour it was written against
+// Each profile is a set of compile time constants the interpreter (Cpu.cpp) is instantiated with,
+// so every profile gets its own handlers and dispatch loops with its quirks folded in, and a
+// ROM pays nothing per instruction for running on one profile rather than another. The machine's
+// profile picks which of those interpreters run_cycles() uses, once per call
+namespace Chip8 {
+    // The values are what save states store. MODERN and XOCHIP are 0 and 1, the CHIP8 and XO-CHIP
+    // machine modes of version 3 states
+    enum class Quirks : uint8_t {
+        MODERN,     // What this emulator always did: CHIP-8's quirks without the display wait, plus SUPER-CHIP's opcodes
+        XOCHIP,     // Octo's XO-CHIP: 64KB, 4 bitplanes, sprites wrap, shifts and logic ops the SUPER-CHIP way
+        VIP,        // The original COSMAC VIP interpreter: CHIP-8 opcodes only, DXYN waits for the next frame
+        SCHIP,      // SUPER-CHIP 1.1 on the HP48: hi-res and scrolling, FX55/FX65 leave I alone, BXNN jumps to XNN + VX
+    };
+
+    constexpr uint32_t QUIRKS_COUNT = 4;
+
+    // The constants a profile is made of, one specialization per Quirks value
+    //   shift_vy          8XY6/8XYE shift VY into VX. Otherwise VX is shifted in place
+    //   logic_resets_vf   8XY1/8XY2/8XY3 clear VF
+    //   memory_increments FX55/FX65 leave I one past the last register. Otherwise I is unchanged
+    //   wrap_sprites      DXYN wraps what passes the right and bottom edges around to the other side
+    //                     Otherwise it is clipped. The start position always wraps
+    //   display_wait      DXYN waits for the vertical blank: nothing else runs until the next timer tick
+    //   jump_vx           BNNN is BXNN, a jump to XNN + VX. Otherwise NNN + V0
+    //   superchip         SUPER-CHIP's opcodes (00CN, 00FB-00FF, FX30, FX75, FX85) and DXY0's 16x16
+    //                     sprite. Otherwise they are 0NNN calls or invalid, and DXY0 draws nothing,
+    //                     like on a VIP
+    //   xochip            XO-CHIP's opcodes and a 64KB machine
+    template <Quirks Q>
+    struct QuirkProfile;
+
+    template <>
+    struct QuirkProfile<Quirks::MODERN> {
+        static constexpr bool shift_vy = true;
+        static constexpr bool logic_resets_vf = true;
+        static constexpr bool memory_increments = true;
+        static constexpr bool wrap_sprites = false;
+        static constexpr bool display_wait = false;
+        static constexpr bool jump_vx = false;
+        static constexpr bool superchip = true;
+        static constexpr bool xochip = false;
+    };
+
+    template <>
+    struct QuirkProfile<Quirks::XOCHIP> {
+        static constexpr bool shift_vy = false;
+        static constexpr bool logic_resets_vf = false;
+        static constexpr bool memory_increments = true;
+        static constexpr bool wrap_sprites = true;
+        static constexpr bool display_wait = false;
+        static constexpr bool jump_vx = false;
+        static constexpr bool superchip = true;
+        static constexpr bool xochip = true;
+    };
+
+    template <>
+    struct QuirkProfile<Quirks::VIP> {
+        static constexpr bool shift_vy = true;
+        static constexpr bool logic_resets_vf = true;
+        static constexpr bool memory_increments = true;
+        static constexpr bool wrap_sprites = false;
+        static constexpr bool display_wait = true;
+        static constexpr bool jump_vx = false;
+        static constexpr bool superchip = false;
+        static constexpr bool xochip = false;
+    };
+
+    template <>
+    struct QuirkProfile<Quirks::SCHIP> {
+        static constexpr bool shift_vy = false;
+        static constexpr bool logic_resets_vf = false;
+        static constexpr bool memory_increments = false;
+        static constexpr bool wrap_sprites = false;
+        static constexpr bool display_wait = false;
+        static constexpr bool jump_vx = true;
+        static constexpr bool superchip = true;
+        static constexpr bool xochip = false;
+    };
+
+    // A profile's constants as a value, for code that has to look at them outside the interpreter
+    // (the ROM analyzer, Chip8/Analyzer.hpp) and is fine with a branch on them
+    struct QuirkFlags {
+        bool shift_vy;
+        bool logic_resets_vf;
+        bool memory_increments;
+        bool wrap_sprites;
+        bool display_wait;
+        bool jump_vx;
+        bool superchip;
+        bool xochip;
+    };
+
+    template <typename P>
+    constexpr QuirkFlags quirk_flags_of() {
+        return QuirkFlags{P::shift_vy, P::logic_resets_vf, P::memory_increments, P::wrap_sprites,
+                          P::display_wait, P::jump_vx, P::superchip, P::xochip};
+    }
+
+    constexpr QuirkFlags quirk_flags(Quirks quirks) {
+        switch (quirks) {
+            case Quirks::MODERN: break;
+            case Quirks::XOCHIP: return quirk_flags_of<QuirkProfile<Quirks::XOCHIP>>();
+            case Quirks::VIP: return quirk_flags_of<QuirkProfile<Quirks::VIP>>();
+            case Quirks::SCHIP: return quirk_flags_of<QuirkProfile<Quirks::SCHIP>>();
+        }
+        return quirk_flags_of<QuirkProfile<Quirks::MODERN>>();
+    }
+
+    // Names for the command line and batch job files: modern, xochip, vip, schip
+    constexpr std::string_view quirks_name(Quirks quirks) {
+        switch (quirks) {
+            case Quirks::MODERN: return "modern";
+            case Quirks::XOCHIP: return "xochip";
+            case Quirks::VIP: return "vip";
+            case Quirks::SCHIP: return "schip";
+        }
+        return "unknown";
+    }
+
+    // The profile called `name`. Returns false (and leaves `quirks` alone) for a name that isn't one
+    constexpr bool parse_quirks(std::string_view name, Quirks& quirks) {
+        for (uint32_t q = 0; q < QUIRKS_COUNT; q++) {
+            if (name == quirks_name(static_cast<Quirks>(q))) {
+                quirks = static_cast<Quirks>(q);
+                return true;
+            }
+        }
+        return false;
+    }
+}
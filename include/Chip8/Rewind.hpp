@@ -0,0 +1,52 @@
+#pragma once
+#include "Chip8/SaveState.hpp"
+#include <vector>
+
+namespace Chip8 {
+    // Rewind history: one state per frame in a ring, newest last
+    // Every keyframe_interval frames a keyframe is stored, the frames after it only as their XOR
+    // against that keyframe, run length encoded a word at a time. A frame touches a few RAM bytes,
+    // registers and display rows, so the XOR is almost all zero words and a delta is tens of bytes
+    // instead of an 8.4KB Snapshot (a 68KB one in XO-CHIP). When the ring is full the oldest keyframe goes together with its
+    // deltas, so at least `frames` frames are always kept
+    class RewindBuffer {
+    public:
+        explicit RewindBuffer(size_t frames = 60 * 60, size_t keyframe_interval = 60);
+
+        // Store the machine's current state as the newest frame, call once per frame
+        void push(const Machine& machine);
+
+        // Restore the newest stored frame and drop it, so repeated calls step back a frame at a time
+        // Returns false (and leaves the machine alone) once the history is used up
+        bool rewind(Machine& machine);
+
+        void clear();
+
+        size_t frames() const { return count; }
+
+        // Encoded history held right now, keyframes included
+        size_t bytes_used() const { return used * sizeof(uint64_t); }
+
+    private:
+        struct Entry {
+            std::vector<uint64_t> runs;     // <zero words << 32 | literal words> <literals...>, repeated
+            bool keyframe = false;
+        };
+
+        size_t index(size_t age) const { return (oldest + count - 1 - age) % ring.size(); }
+        const Snapshot& newest_key();
+        void drop_oldest();
+
+        std::vector<Entry> ring;
+        size_t interval;
+        size_t oldest = 0;
+        size_t count = 0;
+        size_t since_key = 0;       // Entries from the newest keyframe on, itself included
+        size_t used = 0;            // Words in all entries
+
+        Snapshot current;           // Scratch for the frame being stored or restored
+        Snapshot key;               // Newest keyframe, decoded
+        Snapshot zero;              // What keyframes are encoded against
+        bool key_valid = false;
+    };
+}
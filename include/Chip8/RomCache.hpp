@@ -0,0 +1,46 @@
+#pragma once
+#include "Chip8.hpp"
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Chip8 {
+    // A ROM as the RAM of a machine that just loaded it: the fonts at 0x50, the ROM at 0x200 and zeros
+    // everywhere else, for as much RAM as the machine has (4KB, or 64KB in XO-CHIP). Built once per
+    // ROM and never changed, so resetting a machine is one copy of `ram` and machines on any number
+    // of threads share it
+    struct RomImage {
+        uint64_t hash = 0;          // hash_bytes() of the ROM file
+        size_t size = 0;            // ROM file bytes, at 0x200 in `ram`
+        bool xochip = false;
+        std::vector<uint8_t> ram;
+    };
+
+    // RomImages by ROM contents, so the same ROM under any path (or loaded by many batch jobs) is
+    // built once. Images stay until clear(), there are only ever as many as distinct ROMs
+    // Thread safe: batch workers load through the one rom_cache()
+    class RomCache {
+    public:
+        // The image of the ROM file at `path`. The file is read every time, memory-mapped when it's big
+        // (only XO-CHIP ROMs get past 4KB), and hashed to find it in the cache
+        // Throws std::runtime_error if it can't be read or doesn't fit in the machine's RAM
+        std::shared_ptr<const RomImage> load(std::string_view path, bool xochip);
+
+        // Same for a ROM already in memory
+        std::shared_ptr<const RomImage> load(const uint8_t* rom, size_t size, bool xochip);
+
+        size_t size() const;
+        uint64_t hits() const;      // Loads that found their image already built
+        void clear();
+
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, std::shared_ptr<const RomImage>> images;  // By hash, and mode
+        uint64_t hit_count = 0;
+    };
+
+    // The process wide cache init_chip8() loads through
+    RomCache& rom_cache();
+}
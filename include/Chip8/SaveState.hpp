@@ -0,0 +1,74 @@
+#pragma once
+#include "Chip8.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Save states: the full machine state, in memory (snapshot/restore) or as a file
+namespace Chip8 {
+    // Everything that decides what a machine does next, and nothing derived from it
+    // (the decode cache is rebuilt from RAM, the ROM name stays with the machine)
+    // Plain data. RAM goes last and only the machine's own RAM is copied (4KB, or 64KB in XO-CHIP),
+    // so taking one of a CHIP8 machine is a ~8.4KB copy and cheap enough to do every frame
+    struct Snapshot {
+        Display display{};
+        std::array<uint16_t, 16> stack{};
+        std::array<uint8_t, 16> V{};
+        std::array<uint8_t, 16> flags{};    // SUPER-CHIP FX75/FX85
+        std::array<uint8_t, 16> pattern{};  // XO-CHIP audio
+        uint64_t cycles = 0;
+        uint64_t frames = 0;
+        uint32_t rng = DEFAULT_RNG_SEED;
+        uint16_t I = 0;
+        uint16_t PC = 0x200;
+        uint16_t keypad = 0;        // Bit k set while key k is down
+        uint8_t stack_ptr = 0;
+        uint8_t delay_timer = 0;
+        uint8_t sound_timer = 0;
+        bool hires = false;
+        bool xochip = false;
+        Quirks quirks = Quirks::MODERN;
+        bool vblank_wait = false;
+        uint8_t planes = 1;
+        uint8_t pitch = 64;
+        bool audio_pattern = false;
+        uint16_t ram_mask = 0x0FFF;
+        EmulatorState state = EmulatorState::RUNNING;
+        alignas(8) std::array<uint8_t, 0x10000> ram{};    // Past ram_mask always 0
+    };
+
+    // Bytes of a snapshot in use, everything up to the end of its RAM
+    inline size_t snapshot_size(const Snapshot& s) {
+        return offsetof(Snapshot, ram) + s.ram_mask + 1u;
+    }
+
+    // In memory. restore() keeps the decode cache (and so JIT blocks) when the snapshot's code
+    // matches what is already in RAM, which it almost always does for the same ROM
+    void snapshot(const Machine& machine, Snapshot& out);
+    void restore(Machine& machine, const Snapshot& in);
+
+    // Binary format, all integers little endian:
+    //   "C8ST"  u16 version  u16 header size  u32 payload size  u64 FNV-1a of the payload
+    //   payload: registers, timers, keypad, RNG and counters, then (version 2) the resolution and
+    //            the RPL flags, then (version 3) the XO-CHIP mode, planes, pitch and audio pattern,
+    //            then (version 4) whether a display wait is pending, then the display as the current
+    //            resolution shows it (32 rows of one u64 in lo-res, 64 rows of two in hi-res) for each
+    //            plane the machine shows, then RAM (4KB, or 64KB in XO-CHIP) as runs of
+    //            <u16 zeros><u16 literal bytes><bytes...>
+    // Version 1 states, from before hi-res, load as lo-res, versions 1 and 2 as CHIP8 machines
+    // The mode byte is the quirk profile since version 4. Version 3's 0 and 1, CHIP8 and XO-CHIP,
+    // are the MODERN and XOCHIP profiles, so it reads the same
+    // Most of RAM is zero for a small ROM, so a state is usually well under 1KB more than the ROM
+    std::vector<uint8_t> serialize_state(const Machine& machine);
+
+    // Throws std::runtime_error if the data isn't a save state, is from a newer version or is corrupt.
+    // The machine is only changed once the whole state has been read and checked
+    void deserialize_state(Machine& machine, const std::vector<uint8_t>& data);
+
+    // serialize_state()/deserialize_state() to and from a file
+    void save_state(const Machine& machine, const std::string& path);
+    void load_state(Machine& machine, const std::string& path);
+
+    // Where the frontend keeps the save state for a ROM: next to it, with ".state" appended
+    std::string state_path(std::string_view rom_path);
+}
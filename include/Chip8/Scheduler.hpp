@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace Chip8 {
+    // Paces whole frames against the wall clock
+    // Frame n is due at start + n / rate, computed from the frame count rather than by adding up
+    // periods, so the rate holds exactly over any length of run. The caller runs due() frames as
+    // one batch each (frame_cycles() instructions and a timer tick) and then sleeps until
+    // next_deadline(). After a stall (a slow host, a debugger, a suspended laptop) at most
+    // max_catch_up frames are run to catch up and the rest are dropped, so a hiccup never turns
+    // into seconds of the game running at full speed
+    class FrameScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit FrameScheduler(double frames_per_second = 60.0, uint32_t max_catch_up = 4);
+
+        // Frame 0 due at `now`. After a pause, or anything else whose time isn't owed to the machine
+        void restart(Clock::time_point now);
+
+        // Change the pace, e.g for fast-forward. Restarts from now if it differs
+        void set_rate(double frames_per_second, Clock::time_point now);
+
+        // Frames due by `now` that haven't been handed out yet, at most max_catch_up
+        uint32_t due(Clock::time_point now);
+
+        // When the next frame is due, what to sleep until
+        Clock::time_point next_deadline() const { return deadline(next); }
+
+        double rate() const { return fps; }
+        uint64_t dropped() const { return dropped_frames; }
+
+    private:
+        Clock::time_point deadline(uint64_t frame) const;
+
+        double fps;
+        uint32_t max_catch_up;
+        Clock::time_point start;
+        uint64_t next = 0;              // Frames handed out (or dropped) since start
+        uint64_t dropped_frames = 0;
+    };
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <cstdint>
 
 // Configuration structure to change speed, window, colors, etc
@@ -8,12 +9,26 @@ struct Config
     // 32 bit numbers for with and height
     static constexpr uint32_t window_width = 64;     // Default Chip-8 resolution width
     static constexpr uint32_t window_height = 32;    // Default Chip-8 resolution height
+    // SUPER-CHIP hi-res mode (00FF) doubles both, the window stays the same size with smaller pixels
+    static constexpr uint32_t hires_width = 128;
+    static constexpr uint32_t hires_height = 64;
     uint32_t fg_color = 0xFFFFFFFF; // Foreground color WHITE in RGBA8888 format
     uint32_t bg_color = 0x000000FF; // Background color BLACK in RGBA8888 format
+    // XO-CHIP draws on up to 4 bitplanes and a pixel's color is picked by which of them are lit in it,
+    // plane 0 as bit 0: bg_color for none, fg_color for plane 0 alone, then these for 2 (plane 1 alone),
+    // 3 (planes 0 and 1) and so on up to 15. Programs using 2 planes only ever get to the first two
+    std::array<uint32_t, 14> plane_colors = {
+        0xFF6600FF, 0x662200FF,                         // Octo's two-plane colors
+        0x0055FFFF, 0x00AAFFFF, 0x00FF55FF, 0x55FFAAFF,
+        0xAA00FFFF, 0xFF55AAFF, 0xFFAA00FF, 0xAAAAAAFF,
+        0x555555FF, 0xAA5500FF, 0x55AA00FF, 0xFFFF55FF,
+    };
     // Amount to scale a CHIP8 pixel by e.g. 20x will be a 20x larger window
     uint32_t scale_factor = 20;     // Default resolution will now be 1280*640
     bool pixel_outlines = true;     // Draw pixel outlines yes/no
     uint32_t ints_per_second = 700;// CHIP8 CPU "clock rates" or hertz
+    uint32_t fast_forward = 4;      // Speed multiplier while fast-forward (Tab) is held
+    bool skip_idle = true;          // Skip over wait loops (key waits, delay timer polls) instead of running them
     uint32_t square_wave_freq = 440;       // Frequency of square wave sound e.g. 440hz for middle A
     uint32_t audio_sample_rate = 44100;     // "CD" quality, 44100 hz
     // int16, cause its little indian or negative volume
@@ -0,0 +1,12 @@
+#pragma once
+#include "Config.hpp"
+#include "Chip8/Core.hpp"
+
+namespace Chip8 {
+    // Handle the input
+    // Polls SDL events, so this lives in the frontend and not in the headless core library
+    // Keypad, pause and reset go to the emulation thread through the queue, volume is changed in config directly
+    // Sets `redraw` when the window lost what was drawn on it (exposed again, render targets reset)
+    // Returns false when the user quits
+    bool handle_input(InputQueue& input, Config& config, bool& redraw);
+}
@@ -1,18 +1,17 @@
 #pragma once
 #include "Config.hpp"
 #include "Chip8.hpp"
+#include "Chip8/Audio.hpp"
+#include "Chip8/Frame.hpp"
 #include <SDL.h>
 #include <memory>
+#include <string>
 #include <stdexcept>
 
 namespace Chip8 {
-    // AudioState declaration inside Chip8 namespace
-    struct AudioState {
-        uint32_t sample_index = 0;
-        // Store pointer of the config to always get the current config instead of copy of old object
-        const Config* config = nullptr;
-        bool playing_sound = false; // Determine whether to output tone
-    };
+    // SDL audio callback, fills `stream` with `len` bytes of the tone (or silence)
+    // userdata is the AudioEngine. Not static so the benchmarks can call it directly
+    void audio_callback(void* userdata, uint8_t* stream, int len);
 
     // RAII class for managing SDL initialization and cleanup
     // Manage resources via object lifetime (constructor acquires, destructor releases)
@@ -22,8 +21,25 @@ namespace Chip8 {
         ~SDLManager();
         
         void clear_window();
-        void update_window(const Config config, const Machine machine);
+        // Draw a published frame. Only re-uploads its dirty rows, and doesn't present at all
+        // if it is the frame already on screen
+        void update_window(const Frame& frame);
+        // The window has to be drawn again: the next update_window() uploads every row and
+        // presents, even if its frame is the one already shown
+        void redraw() { stale = true; }
+        // Called from the emulation thread, everything else from the main thread
+        // Hands the sound timer going on or off to the audio thread, timestamped with machine.cycles
         void handle_audio(const Machine& machine);
+        // The audio thread reads the volume through an atomic, config.volume is the main thread's
+        void set_volume(int16_t volume);
+
+        // Refresh rate of the display the window is on, 60 if SDL can't tell
+        int refresh_rate() const;
+        void set_title(const std::string& title);
+
+        // How many update_window calls presented a frame vs skipped it because nothing changed
+        uint64_t frames_presented() const { return presented; }
+        uint64_t frames_skipped() const { return skipped; }
 
         // Delete copy semantics
         SDLManager(const SDLManager&) = delete;
@@ -48,13 +64,39 @@ namespace Chip8 {
 
         using SDLRendererPtr = std::unique_ptr<SDL_Renderer, SDLRendererDeleter>;
 
+        // And for textures
+        struct SDLTextureDeleter {
+            void operator()(SDL_Texture* texture) const;
+        };
+
+        using SDLTexturePtr = std::unique_ptr<SDL_Texture, SDLTextureDeleter>;
+
+        void build_grid(uint32_t color, bool hires);
+        void build_texel_table(uint32_t fg, uint32_t bg);
+        void draw_planes_row(const Frame& frame, uint32_t y, uint32_t width,
+                             const std::array<uint32_t, 16>& palette, uint32_t* dst);
+
         SDLWindowPtr window;
         SDLRendererPtr renderer;
+        SDLTexturePtr texture;      // 128x64 streaming texture holding the display, lo-res uses 64x32 of it
+        SDLTexturePtr grid;         // Window sized pixel outline overlay
+        uint32_t grid_color = 0;    // Color the grid was built with
+        bool grid_hires = false;    // and the resolution
+
+        // RGBA8888 texels for each byte of a packed display row, for the colors they were built with
+        std::array<std::array<uint32_t, 8>, 256> texel_table{};
+        uint32_t texel_fg = 0;
+        uint32_t texel_bg = 0;
+
+        uint64_t presented = 0;
+        uint64_t skipped = 0;
+        uint64_t shown_sequence = 0;    // Sequence number of the frame on screen
+        bool stale = false;             // But the window no longer shows it, see redraw()
         Config& config;
 
         // SDL audio
-        // Pointer to heap-allocated audio state
-        AudioState* audio_state = nullptr; // Holds audio parameters and state
+        // The device plays all the time, the engine outputs silence while the tone is off
+        std::unique_ptr<AudioEngine> audio;
         SDL_AudioDeviceID audio_dev = 0; // no unique_ptr needed
     };
 }
\ No newline at end of file
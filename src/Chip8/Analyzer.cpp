@@ -0,0 +1,696 @@
+#include "Chip8/Analyzer.hpp"
+#include "Chip8/BinaryFile.hpp"
+#include "Chip8/Core.hpp"
+#include "Chip8/RomCache.hpp"
+#include <algorithm>
+#include <bitset>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+
+namespace Chip8 {
+    namespace {
+        constexpr uint32_t ENTRY_POINT = 0x200;
+
+        // BNNN adds a byte register to NNN, so 128 two byte JPs cover every target it can reach
+        constexpr uint32_t MAX_JUMP_TABLE = 128;
+
+        // Return addresses the machine has room for
+        constexpr uint32_t STACK_SIZE = std::tuple_size<decltype(Machine::stack)>::value;
+
+        constexpr char MAGIC[4] = {'C', '8', 'C', 'M'};
+        constexpr uint16_t VERSION = 1;
+        constexpr size_t HEADER_SIZE = 4 + 2 + 8 + 1 + 4 + 4 + 8;
+
+        std::string hex(uint32_t value, int digits) {
+            static constexpr char DIGITS[] = "0123456789ABCDEF";
+            std::string text(digits, '0');
+            for (int i = digits - 1; i >= 0; i--, value >>= 4) text[i] = DIGITS[value & 0xF];
+            return text;
+        }
+
+        // 3 digits for CHIP-8's 4KB, 4 for XO-CHIP's 64KB
+        std::string address(uint32_t addr) { return "0x" + hex(addr, addr > 0xFFF ? 4 : 3); }
+        std::string byte(uint32_t value) { return "0x" + hex(value, 2); }
+        std::string reg(uint32_t x) { return "V" + hex(x, 1); }
+
+        bool skips(Op op) {
+            return op == Op::OP_3XNN || op == Op::OP_4XNN || op == Op::OP_5XY0 || op == Op::OP_9XY0 ||
+                   op == Op::OP_EX9E || op == Op::OP_EXA1;
+        }
+
+        // What I, and the XO-CHIP plane mask, hold at some point of the code
+        // UNSET until some path gets there, then KNOWN while every path agrees on the value
+        struct Value {
+            enum State : uint8_t { UNSET, KNOWN, VARIES };
+            State state = UNSET;
+            uint16_t value = 0;
+
+            static Value known(uint16_t value) { return Value{KNOWN, value}; }
+            static Value varies() { return Value{VARIES, 0}; }
+
+            // Merge in another path's value, true if that changed this one
+            bool meet(Value other) {
+                if (other.state == UNSET || state == VARIES) return false;
+                if (state == UNSET) {
+                    *this = other;
+                    return true;
+                }
+                if (other.state == VARIES || other.value != value) {
+                    *this = varies();
+                    return true;
+                }
+                return false;
+            }
+        };
+
+        struct Registers {
+            Value I;
+            Value planes;
+
+            bool meet(const Registers& other) {
+                const bool i = I.meet(other.I);
+                const bool p = planes.meet(other.planes);
+                return i || p;
+            }
+        };
+
+        // Everything the passes share
+        class Analyzer {
+        public:
+            Analyzer(const RomImage& image, Quirks quirks)
+                : image(image), quirks(quirks), q(quirk_flags(quirks)), end(ENTRY_POINT + image.size),
+                  mask(static_cast<uint32_t>(image.ram.size() - 1)),
+                  is_inst(image.size), leader(image.size), block_of(image.size, -1) {
+                result.quirks = quirks;
+                result.rom_hash = image.hash;
+                result.size = image.size;
+                result.kinds.assign(image.size, ByteKind::UNKNOWN);
+            }
+
+            RomAnalysis run() {
+                if (image.size == 0) return result;
+                discover();
+                build_blocks();
+                track_memory();
+                measure_stack();
+                result.routines.assign(routines.begin(), routines.end());
+                result.jump_targets.assign(jumps.begin(), jumps.end());
+                return result;
+            }
+
+        private:
+            const RomImage& image;
+            const Quirks quirks;
+            const QuirkFlags q;
+            const uint32_t end;     // One past the ROM's last byte
+            const uint32_t mask;
+
+            RomAnalysis result;
+
+            // Per ROM byte, index addr - 0x200
+            std::vector<bool> is_inst;      // An instruction starts here
+            std::vector<bool> leader;       // A basic block starts here
+            std::vector<int32_t> block_of;  // Index in result.blocks of the block starting here
+
+            std::set<uint16_t> routines{ENTRY_POINT};
+            std::set<uint16_t> jumps;
+            std::set<uint16_t> invalid_at;
+
+            bool in_rom(uint32_t addr) const { return addr >= ENTRY_POINT && addr < end; }
+
+            uint16_t word(uint32_t addr) const {
+                return static_cast<uint16_t>(image.ram[addr & mask] << 8 | image.ram[(addr + 1) & mask]);
+            }
+
+            uint32_t inst_size(uint32_t addr) const {
+                return profile_op(word(addr), quirks) == Op::OP_F000 ? 4 : 2;
+            }
+
+            // The JPs BNNN at `base` can land on: the run of 1NNNs starting at NNN
+            std::vector<uint16_t> jump_table(uint32_t base) const {
+                std::vector<uint16_t> entries;
+                for (uint32_t addr = base; in_rom(addr) && entries.size() < MAX_JUMP_TABLE; addr += 2) {
+                    if (profile_op(word(addr), quirks) != Op::OP_1NNN) break;
+                    entries.push_back(static_cast<uint16_t>(addr));
+                }
+                return entries;
+            }
+
+            void mark_leader(uint32_t addr) {
+                if (in_rom(addr)) leader[addr - ENTRY_POINT] = true;
+            }
+
+            // Pass 1: follow every path from the entry point, marking instructions and block leaders
+            void discover() {
+                std::vector<uint32_t> work{ENTRY_POINT};
+                leader[0] = true;
+
+                // An edge to `target`: leaves the ROM, or is one more place to start from
+                auto follow = [&](uint32_t target) {
+                    if (!in_rom(target)) {
+                        result.leaves_rom++;
+                        return false;
+                    }
+                    mark_leader(target);
+                    work.push_back(target);
+                    return true;
+                };
+
+                while (!work.empty()) {
+                    uint32_t pc = work.back();
+                    work.pop_back();
+
+                    while (true) {
+                        if (!in_rom(pc)) {
+                            result.leaves_rom++;    // Ran off the end of the ROM
+                            break;
+                        }
+                        if (is_inst[pc - ENTRY_POINT]) break;
+
+                        const uint16_t opcode = word(pc);
+                        const Op op = profile_op(opcode, quirks);
+
+                        // The interpreter runs straight past an invalid opcode, but a path that gets to
+                        // one has almost certainly wandered into data
+                        if (op == Op::INVALID) {
+                            invalid_at.insert(static_cast<uint16_t>(pc));
+                            break;
+                        }
+
+                        const uint32_t size = (op == Op::OP_F000) ? 4 : 2;
+                        is_inst[pc - ENTRY_POINT] = true;
+                        for (uint32_t b = pc; b < pc + size && b < end; b++) {
+                            result.kinds[b - ENTRY_POINT] = ByteKind::CODE;
+                        }
+
+                        const uint32_t next = pc + size;
+                        const uint16_t nnn = opcode & 0x0FFF;
+                        bool falls_through = true;
+
+                        if (op == Op::OP_1NNN) {
+                            if (follow(nnn)) jumps.insert(nnn);
+                            falls_through = false;
+                        } else if (op == Op::OP_2NNN) {
+                            if (follow(nnn)) routines.insert(nnn);
+                            mark_leader(next);
+                        } else if (op == Op::OP_00EE || op == Op::OP_00FD) {
+                            falls_through = false;
+                        } else if (op == Op::OP_BNNN) {
+                            result.indirect_jumps++;
+                            const std::vector<uint16_t> table = jump_table(nnn);
+                            if (table.empty()) result.unresolved_jumps++;
+                            for (const uint16_t entry : table) {
+                                follow(entry);
+                                jumps.insert(entry);
+                            }
+                            falls_through = false;
+                        } else if (skips(op)) {
+                            mark_leader(next);
+                            follow(next + inst_size(next));
+                        }
+
+                        if (!falls_through) break;
+                        pc = next;
+                    }
+                }
+
+                result.invalid = static_cast<uint32_t>(invalid_at.size());
+                for (uint32_t addr = ENTRY_POINT; addr < end; addr++) {
+                    if (is_inst[addr - ENTRY_POINT]) result.instructions.push_back(static_cast<uint16_t>(addr));
+                }
+            }
+
+            // Pass 2: cut the instructions into basic blocks at the leaders
+            void build_blocks() {
+                for (uint32_t start = ENTRY_POINT; start < end; start++) {
+                    if (!is_inst[start - ENTRY_POINT] || !leader[start - ENTRY_POINT]) continue;
+
+                    BasicBlock block;
+                    block.start = static_cast<uint16_t>(start);
+                    uint32_t pc = start;
+
+                    while (true) {
+                        const uint16_t opcode = word(pc);
+                        const Op op = profile_op(opcode, quirks);
+                        const uint32_t next = pc + ((op == Op::OP_F000) ? 4 : 2);
+                        const uint16_t nnn = opcode & 0x0FFF;
+                        block.end = static_cast<uint16_t>(std::min(next, end));
+
+                        auto successor = [&](uint32_t target) {
+                            if (in_rom(target) && is_inst[target - ENTRY_POINT]) {
+                                block.successors.push_back(static_cast<uint16_t>(target));
+                            }
+                        };
+
+                        bool ended = true;
+                        if (op == Op::OP_1NNN) {
+                            successor(nnn);
+                        } else if (op == Op::OP_2NNN) {
+                            if (in_rom(nnn)) block.call = nnn;
+                            successor(next);
+                        } else if (op == Op::OP_00EE) {
+                            block.returns = true;
+                        } else if (op == Op::OP_00FD) {
+                            // Exit, the PC stays on it
+                        } else if (op == Op::OP_BNNN) {
+                            block.indirect = true;
+                            for (const uint16_t entry : jump_table(nnn)) successor(entry);
+                        } else if (skips(op)) {
+                            successor(next);
+                            successor(next + inst_size(next));
+                        } else if (!in_rom(next) || !is_inst[next - ENTRY_POINT]) {
+                            // Runs off the ROM or into an invalid opcode, nowhere to go that's known
+                        } else if (leader[next - ENTRY_POINT]) {
+                            successor(next);
+                        } else {
+                            ended = false;
+                        }
+
+                        if (ended) break;
+                        pc = next;
+                    }
+
+                    block_of[start - ENTRY_POINT] = static_cast<int32_t>(result.blocks.size());
+                    result.blocks.push_back(std::move(block));
+                }
+            }
+
+            const BasicBlock* block_at(uint32_t addr) const {
+                if (!in_rom(addr) || block_of[addr - ENTRY_POINT] < 0) return nullptr;
+                return &result.blocks[block_of[addr - ENTRY_POINT]];
+            }
+
+            // `length` bytes from I are read or written as `kind`. Does nothing if I isn't known here
+            void touch(Value I, uint32_t length, ByteKind kind, bool write) {
+                if (I.state != Value::KNOWN) return;
+                for (uint32_t i = 0; i < length; i++) {
+                    const uint32_t addr = (I.value + i) & mask;
+                    if (!in_rom(addr)) continue;
+
+                    ByteKind& current = result.kinds[addr - ENTRY_POINT];
+                    if (write && current == ByteKind::CODE) result.self_modifying = true;
+                    current = std::max(current, kind);
+                }
+            }
+
+            // Run a block on what's known of I and the planes at its start, and return what's known
+            // at its end. With `mark`, also record the bytes it draws, reads and writes
+            Registers run_block(const BasicBlock& block, Registers regs, bool mark) {
+                for (uint32_t pc = block.start; pc < block.end;) {
+                    const uint16_t opcode = word(pc);
+                    const Op op = profile_op(opcode, quirks);
+                    const uint32_t x = (opcode >> 8) & 0xF;
+                    const uint32_t y = (opcode >> 4) & 0xF;
+                    const uint32_t n = opcode & 0xF;
+                    const uint32_t count = (x < y ? y - x : x - y) + 1;   // 5XY2/5XY3 registers
+
+                    switch (op) {
+                        case Op::OP_ANNN:
+                            regs.I = Value::known(opcode & 0x0FFF);
+                            break;
+                        case Op::OP_F000:
+                            regs.I = Value::known(word(pc + 2));
+                            break;
+                        case Op::OP_FX1E: case Op::OP_FX29: case Op::OP_FX30:
+                            regs.I = Value::varies();
+                            break;
+                        case Op::OP_FN01:
+                            regs.planes = Value::known(static_cast<uint16_t>(x));
+                            break;
+                        case Op::OP_DXYN: {
+                            // Each selected plane takes the next sprite's worth of bytes. An unknown
+                            // plane mask is taken as the one plane everything but XO-CHIP has
+                            uint32_t planes = 1;
+                            if (q.xochip && regs.planes.state == Value::KNOWN) {
+                                planes = static_cast<uint32_t>(std::bitset<MAX_PLANES>(regs.planes.value).count());
+                            }
+                            // DXY0 is SUPER-CHIP's 16x16 sprite, without SUPER-CHIP it reads nothing
+                            const uint32_t size = (q.superchip && n == 0) ? 32 : n;
+                            if (mark && size > 0) touch(regs.I, size * planes, ByteKind::SPRITE, false);
+                            break;
+                        }
+                        case Op::OP_FX33:
+                            if (mark) touch(regs.I, 3, ByteKind::DATA, true);
+                            break;
+                        case Op::OP_FX55: case Op::OP_FX65:
+                            if (mark) touch(regs.I, x + 1, ByteKind::DATA, op == Op::OP_FX55);
+                            if (q.memory_increments && regs.I.state == Value::KNOWN) regs.I.value += x + 1;
+                            break;
+                        case Op::OP_5XY2: case Op::OP_5XY3:
+                            if (mark) touch(regs.I, count, ByteKind::DATA, op == Op::OP_5XY2);
+                            break;
+                        case Op::OP_F002:
+                            if (mark) touch(regs.I, 16, ByteKind::DATA, false);
+                            break;
+                        default:
+                            break;
+                    }
+                    pc += (op == Op::OP_F000) ? 4 : 2;
+                }
+                return regs;
+            }
+
+            // Pass 3: work out I at every block, forward along the CFG until nothing changes, then
+            // mark what every DXYN, FX33, FX55, FX65 and XO-CHIP memory op touches
+            // A call hands the caller's I to the routine, and after it returns I could be anything
+            void track_memory() {
+                std::vector<Registers> in(result.blocks.size());
+                std::vector<bool> queued(result.blocks.size());
+                std::vector<size_t> work;
+
+                auto reach = [&](uint32_t addr, const Registers& regs) {
+                    const BasicBlock* block = block_at(addr);
+                    if (block == nullptr) return;
+                    const size_t index = block - result.blocks.data();
+                    if (in[index].meet(regs) && !queued[index]) {
+                        queued[index] = true;
+                        work.push_back(index);
+                    }
+                };
+
+                // Registers as load_rom() leaves them
+                reach(ENTRY_POINT, Registers{Value::known(0), Value::known(1)});
+
+                while (!work.empty()) {
+                    const size_t index = work.back();
+                    work.pop_back();
+                    queued[index] = false;
+
+                    const BasicBlock& block = result.blocks[index];
+                    const Registers out = run_block(block, in[index], false);
+                    if (block.call != 0) {
+                        reach(block.call, out);
+                        for (const uint16_t target : block.successors) reach(target, Registers{Value::varies(), Value::varies()});
+                    } else {
+                        for (const uint16_t target : block.successors) reach(target, out);
+                    }
+                }
+
+                for (size_t i = 0; i < result.blocks.size(); i++) run_block(result.blocks[i], in[i], true);
+            }
+
+            // Pass 4: the call graph, and the longest chain of calls from the entry point through it
+            void measure_stack() {
+                // Routines each routine calls: every call in the blocks reachable from its entry
+                // without going through a call or a return
+                std::map<uint16_t, std::set<uint16_t>> callees;
+                for (const uint16_t routine : routines) {
+                    std::set<uint16_t>& calls = callees[routine];
+                    std::vector<bool> seen(result.blocks.size());
+                    std::vector<const BasicBlock*> work;
+                    if (const BasicBlock* entry = block_at(routine)) work.push_back(entry);
+
+                    while (!work.empty()) {
+                        const BasicBlock* block = work.back();
+                        work.pop_back();
+                        const size_t index = block - result.blocks.data();
+                        if (seen[index]) continue;
+                        seen[index] = true;
+
+                        if (block->call != 0) calls.insert(block->call);
+                        for (const uint16_t target : block->successors) {
+                            if (const BasicBlock* next = block_at(target)) work.push_back(next);
+                        }
+                    }
+                }
+
+                // Return addresses on the stack while `routine` runs at its deepest. A call to a routine
+                // that is still being measured is recursion, which is flagged and otherwise not counted
+                std::map<uint16_t, uint32_t> depth;
+                std::set<uint16_t> active;
+                std::function<uint32_t(uint16_t)> deepest = [&](uint16_t routine) -> uint32_t {
+                    if (const auto known = depth.find(routine); known != depth.end()) return known->second;
+                    active.insert(routine);
+                    uint32_t most = 0;
+                    for (const uint16_t callee : callees[routine]) {
+                        if (active.count(callee)) {
+                            result.recursive = true;
+                            continue;
+                        }
+                        most = std::max(most, deepest(callee) + 1);
+                    }
+                    active.erase(routine);
+                    return depth[routine] = most;
+                };
+                result.max_stack_depth = deepest(ENTRY_POINT);
+            }
+        };
+
+    }
+
+    Op profile_op(uint16_t opcode, Quirks quirks) {
+        const QuirkFlags q = quirk_flags(quirks);
+        const Op op = decode_op(opcode);
+
+        switch (op) {
+            case Op::OP_00CN: case Op::OP_00FB: case Op::OP_00FC: case Op::OP_00FD: case Op::OP_00FE: case Op::OP_00FF:
+                return q.superchip ? op : Op::OP_0NNN;
+            case Op::OP_FX30: case Op::OP_FX75: case Op::OP_FX85:
+                return q.superchip ? op : Op::INVALID;
+            case Op::OP_00DN:
+                return q.xochip ? op : Op::OP_0NNN;
+            case Op::OP_5XY2: case Op::OP_5XY3: case Op::OP_F000: case Op::OP_FN01: case Op::OP_F002: case Op::OP_FX3A:
+                return q.xochip ? op : Op::INVALID;
+            default:
+                return op;
+        }
+    }
+
+    std::string disassemble(uint16_t opcode, Quirks quirks, uint16_t next) {
+        const uint32_t nnn = opcode & 0x0FFF;
+        const uint32_t nn = opcode & 0x00FF;
+        const uint32_t n = opcode & 0x000F;
+        const std::string x = reg((opcode >> 8) & 0xF);
+        const std::string y = reg((opcode >> 4) & 0xF);
+
+        switch (profile_op(opcode, quirks)) {
+            case Op::OP_00E0: return "CLS";
+            case Op::OP_00EE: return "RET";
+            case Op::OP_0NNN: return "SYS " + address(nnn);
+            case Op::OP_1NNN: return "JP " + address(nnn);
+            case Op::OP_2NNN: return "CALL " + address(nnn);
+            case Op::OP_3XNN: return "SE " + x + ", " + byte(nn);
+            case Op::OP_4XNN: return "SNE " + x + ", " + byte(nn);
+            case Op::OP_5XY0: return "SE " + x + ", " + y;
+            case Op::OP_6XNN: return "LD " + x + ", " + byte(nn);
+            case Op::OP_7XNN: return "ADD " + x + ", " + byte(nn);
+            case Op::OP_8XY0: return "LD " + x + ", " + y;
+            case Op::OP_8XY1: return "OR " + x + ", " + y;
+            case Op::OP_8XY2: return "AND " + x + ", " + y;
+            case Op::OP_8XY3: return "XOR " + x + ", " + y;
+            case Op::OP_8XY4: return "ADD " + x + ", " + y;
+            case Op::OP_8XY5: return "SUB " + x + ", " + y;
+            case Op::OP_8XY6: return "SHR " + x + ", " + y;
+            case Op::OP_8XY7: return "SUBN " + x + ", " + y;
+            case Op::OP_8XYE: return "SHL " + x + ", " + y;
+            case Op::OP_9XY0: return "SNE " + x + ", " + y;
+            case Op::OP_ANNN: return "LD I, " + address(nnn);
+            case Op::OP_BNNN: return "JP " + (quirk_flags(quirks).jump_vx ? x : std::string("V0")) + ", " + address(nnn);
+            case Op::OP_CXNN: return "RND " + x + ", " + byte(nn);
+            case Op::OP_DXYN: return "DRW " + x + ", " + y + ", " + std::to_string(n);
+            case Op::OP_EX9E: return "SKP " + x;
+            case Op::OP_EXA1: return "SKNP " + x;
+            case Op::OP_FX07: return "LD " + x + ", DT";
+            case Op::OP_FX0A: return "LD " + x + ", K";
+            case Op::OP_FX15: return "LD DT, " + x;
+            case Op::OP_FX18: return "LD ST, " + x;
+            case Op::OP_FX1E: return "ADD I, " + x;
+            case Op::OP_FX29: return "LD F, " + x;
+            case Op::OP_FX33: return "LD B, " + x;
+            case Op::OP_FX55: return "LD [I], " + x;
+            case Op::OP_FX65: return "LD " + x + ", [I]";
+            case Op::OP_00CN: return "SCD " + std::to_string(n);
+            case Op::OP_00FB: return "SCR";
+            case Op::OP_00FC: return "SCL";
+            case Op::OP_00FD: return "EXIT";
+            case Op::OP_00FE: return "LOW";
+            case Op::OP_00FF: return "HIGH";
+            case Op::OP_FX30: return "LD HF, " + x;
+            case Op::OP_FX75: return "LD R, " + x;
+            case Op::OP_FX85: return "LD " + x + ", R";
+            case Op::OP_00DN: return "SCU " + std::to_string(n);
+            case Op::OP_5XY2: return "LD [I], " + x + "-" + y;
+            case Op::OP_5XY3: return "LD " + x + "-" + y + ", [I]";
+            case Op::OP_F000: return "LD I, 0x" + hex(next, 4);
+            case Op::OP_FN01: return "PLANE " + std::to_string((opcode >> 8) & 0xF);
+            case Op::OP_F002: return "AUDIO";
+            case Op::OP_FX3A: return "PITCH " + x;
+            case Op::NONE: case Op::INVALID: break;
+        }
+        return "DW 0x" + hex(opcode, 4);
+    }
+
+    RomAnalysis analyze_rom(const RomImage& image, Quirks quirks) {
+        return Analyzer(image, quirks).run();
+    }
+
+    size_t count_kind(const RomAnalysis& analysis, ByteKind kind) {
+        return static_cast<size_t>(std::count(analysis.kinds.begin(), analysis.kinds.end(), kind));
+    }
+
+    void write_listing(std::ostream& out, const RomAnalysis& analysis, const RomImage& image) {
+        const uint32_t end = ENTRY_POINT + static_cast<uint32_t>(analysis.size);
+        const uint32_t mask = static_cast<uint32_t>(image.ram.size() - 1);
+        auto word = [&](uint32_t addr) {
+            return static_cast<uint16_t>(image.ram[addr & mask] << 8 | image.ram[(addr + 1) & mask]);
+        };
+        auto contains = [](const std::vector<uint16_t>& sorted, uint32_t addr) {
+            return std::binary_search(sorted.begin(), sorted.end(), addr);
+        };
+        auto label = [&](uint32_t addr) -> std::string {
+            if (addr == ENTRY_POINT) return "main";
+            if (contains(analysis.routines, addr)) return "sub_" + hex(addr, 3);
+            if (contains(analysis.jump_targets, addr)) return "L_" + hex(addr, 3);
+            return "";
+        };
+
+        out << "; " << analysis.size << " byte ROM, " << quirks_name(analysis.quirks) << " profile\n";
+
+        for (uint32_t pc = ENTRY_POINT; pc < end;) {
+            if (const std::string name = label(pc); !name.empty()) out << '\n' << name << ":\n";
+
+            if (contains(analysis.instructions, pc)) {
+                const uint16_t opcode = word(pc);
+                const bool long_i = profile_op(opcode, analysis.quirks) == Op::OP_F000;
+                out << address(pc) << "  " << hex(opcode, 4) << (long_i ? " " + hex(word(pc + 2), 4) : std::string(5, ' '))
+                    << "  " << disassemble(opcode, analysis.quirks, word(pc + 2)) << '\n';
+                pc += long_i ? 4 : 2;
+                continue;
+            }
+
+            const ByteKind kind = analysis.kinds[pc - ENTRY_POINT];
+            if (kind == ByteKind::SPRITE) {
+                const uint8_t row = image.ram[pc];
+                std::string pixels;
+                for (int bit = 7; bit >= 0; bit--) pixels += (row >> bit) & 1 ? '#' : '.';
+                out << address(pc) << "  " << hex(row, 2) << std::string(7, ' ') << "  DB " << byte(row) << "  ; " << pixels << '\n';
+                pc++;
+                continue;
+            }
+
+            // Up to 8 bytes of the same kind, up to the next instruction or label
+            out << address(pc) << std::string(13, ' ') << "DB ";
+            uint32_t count = 0;
+            do {
+                out << (count > 0 ? ", " : "") << byte(image.ram[pc]);
+                pc++;
+                count++;
+            } while (count < 8 && pc < end && analysis.kinds[pc - ENTRY_POINT] == kind &&
+                     !contains(analysis.instructions, pc) && label(pc).empty());
+            out << "  ; " << (kind == ByteKind::DATA ? "data" : "unknown") << '\n';
+        }
+    }
+
+    void write_summary(std::ostream& out, const RomAnalysis& analysis) {
+        out << "Profile: " << quirks_name(analysis.quirks) << "\n"
+            << "ROM: " << analysis.size << " bytes, hash 0x" << std::hex << analysis.rom_hash << std::dec << "\n"
+            << "Code: " << count_kind(analysis, ByteKind::CODE) << " bytes, " << analysis.instructions.size()
+            << " instructions in " << analysis.blocks.size() << " basic blocks, "
+            << analysis.routines.size() - 1 << " subroutines\n"
+            << "Sprites: " << count_kind(analysis, ByteKind::SPRITE) << " bytes\n"
+            << "Data: " << count_kind(analysis, ByteKind::DATA) << " bytes\n"
+            << "Unknown: " << count_kind(analysis, ByteKind::UNKNOWN) << " bytes\n";
+
+        if (analysis.recursive) {
+            out << "Stack: no static bound, a routine calls itself (" << analysis.max_stack_depth << " of "
+                << STACK_SIZE << " return addresses before it does)\n";
+        } else {
+            out << "Stack: " << analysis.max_stack_depth << " of " << STACK_SIZE << " return addresses at most\n";
+        }
+        if (analysis.max_stack_depth > STACK_SIZE) out << "Warning: calls can nest deeper than the stack\n";
+
+        out << "Indirect jumps: " << analysis.indirect_jumps;
+        if (analysis.unresolved_jumps > 0) out << ", " << analysis.unresolved_jumps << " without a jump table (code behind them not found)";
+        out << "\n"
+            << "Self-modifying: " << (analysis.self_modifying ? "yes, FX33/FX55 write over code" : "no") << "\n";
+        if (analysis.leaves_rom > 0) out << "Leaves the ROM: " << analysis.leaves_rom << " jumps, calls or fall-throughs\n";
+        if (analysis.invalid > 0) out << "Invalid opcodes reached: " << analysis.invalid << "\n";
+    }
+
+    CodeMap code_map(const RomAnalysis& analysis) {
+        CodeMap map;
+        map.rom_hash = analysis.rom_hash;
+        map.quirks = analysis.quirks;
+        map.instructions = analysis.instructions;
+        for (const BasicBlock& block : analysis.blocks) map.blocks.push_back(block.start);
+        return map;
+    }
+
+    std::string code_map_path(std::string_view rom_path) {
+        return std::string(rom_path) + ".c8map";
+    }
+
+    void save_code_map(const CodeMap& map, const std::string& path) {
+        std::vector<uint8_t> addresses;
+        addresses.reserve(2 * (map.instructions.size() + map.blocks.size()));
+        Writer a{addresses};
+        for (const uint16_t addr : map.instructions) a.u16(addr);
+        for (const uint16_t addr : map.blocks) a.u16(addr);
+
+        std::vector<uint8_t> data;
+        Writer w{data};
+        w.magic(MAGIC, VERSION);
+        w.u64(map.rom_hash);
+        w.u8(static_cast<uint8_t>(map.quirks));
+        w.u32(static_cast<uint32_t>(map.instructions.size()));
+        w.u32(static_cast<uint32_t>(map.blocks.size()));
+        w.u64(hash_bytes(addresses.data(), addresses.size()));
+        data.insert(data.end(), addresses.begin(), addresses.end());
+
+        write_file(path, data, "code map");
+    }
+
+    CodeMap load_code_map(const std::string& path) {
+        return load_file(path, "code map", [](const std::vector<uint8_t>& data) {
+            Reader r{data.data(), data.size(), "code map"};
+            const uint16_t version = r.magic(MAGIC, HEADER_SIZE);
+            if (version != VERSION) {
+                throw std::runtime_error("Unsupported code map version " + std::to_string(version));
+            }
+
+            CodeMap map;
+            map.rom_hash = r.u64();
+            const uint8_t quirks = r.u8();
+            if (quirks >= QUIRKS_COUNT) throw std::runtime_error("Code map has an unknown quirk profile");
+            map.quirks = static_cast<Quirks>(quirks);
+            const uint64_t instructions = r.u32();
+            const uint64_t blocks = r.u32();
+            const uint64_t checksum = r.u64();
+
+            if (2 * (instructions + blocks) != data.size() - r.pos) throw std::runtime_error("Code map is truncated");
+            if (hash_bytes(data.data() + r.pos, data.size() - r.pos) != checksum) {
+                throw std::runtime_error("Code map checksum mismatch");
+            }
+
+            map.instructions.reserve(instructions);
+            for (uint64_t i = 0; i < instructions; i++) map.instructions.push_back(r.u16());
+            map.blocks.reserve(blocks);
+            for (uint64_t i = 0; i < blocks; i++) map.blocks.push_back(r.u16());
+            return map;
+        });
+    }
+
+    size_t prewarm_decode_cache(Machine& machine, const CodeMap& map) {
+        if (!machine.rom || machine.rom->hash != map.rom_hash) {
+            throw std::runtime_error("Code map is for a different ROM");
+        }
+        if (machine.quirks != map.quirks) {
+            throw std::runtime_error("Code map is for the " + std::string(quirks_name(map.quirks)) + " profile, not " +
+                                     std::string(quirks_name(machine.quirks)));
+        }
+
+        // Exactly what fetch() would store the first time the PC got to each of them
+        size_t decoded = 0;
+        for (const uint16_t addr : map.instructions) {
+            if ((addr & machine.ram_mask) != addr || machine.decode_cache.lookup(addr) == nullptr) continue;
+            const uint16_t opcode = (machine.ram[addr] << 8) | machine.ram[(addr + 1) & machine.ram_mask];
+            machine.decode_cache.store(addr, decode(opcode));
+            decoded++;
+        }
+        return decoded;
+    }
+}
@@ -0,0 +1,153 @@
+#include "Chip8/Audio.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace Chip8 {
+    AudioEngine::AudioEngine(uint32_t sample_rate, uint32_t tone_hz, uint32_t ints_per_second, bool realtime,
+                             uint32_t latency)
+        : sample_rate(std::max(1u, sample_rate)), ints_per_second(std::max(1u, ints_per_second)),
+          realtime(realtime), latency(latency), table(TABLE_SIZE) {
+        // Square wave as the sum of its odd harmonics, 4/pi * sin(k x) / k, stopping below Nyquist so
+        // nothing folds back down as aliasing. Normalized to a peak of 1, the sum overshoots (Gibbs)
+        const double pi = std::acos(-1.0);
+        double peak = 0.0;
+        for (size_t i = 0; i < TABLE_SIZE; i++) {
+            const double x = 2.0 * pi * static_cast<double>(i) / TABLE_SIZE;
+            double sum = 0.0;
+            for (uint64_t k = 1; k * tone_hz < this->sample_rate / 2; k += 2) {
+                sum += std::sin(static_cast<double>(k) * x) / static_cast<double>(k);
+            }
+            table[i] = static_cast<float>(sum);
+            peak = std::max(peak, std::abs(sum));
+        }
+        if (peak > 0.0) {
+            for (float& sample : table) sample = static_cast<float>(sample / peak);
+        }
+
+        step = static_cast<uint32_t>(static_cast<double>(tone_hz) * 4294967296.0 / static_cast<double>(this->sample_rate));
+        if (!realtime) synced = true;   // Offline the output is the timeline, offset 0
+    }
+
+    void AudioEngine::track(const Machine& machine) {
+        SoundEvent event;
+        event.cycle = machine.cycles;
+        event.on = machine.sound_timer > 0 && machine.state == EmulatorState::RUNNING;
+
+        // The pattern only matters while it plays, so loading one while quiet isn't an event
+        if (event.on && machine.audio_pattern) {
+            event.pattern = true;
+            event.pitch = machine.pitch;
+            event.bits = machine.pattern;
+        }
+
+        // A full queue just means trying again on the next call
+        if (!event.sounds_like(reported) && events.push(event)) reported = event;
+    }
+
+    uint64_t AudioEngine::place(uint64_t now) {
+        const uint64_t at = sample_at(pending.cycle);
+        if (!realtime) return std::max(at, now);
+
+        // Late, or further ahead than playing a normal speed ever gets: start the timeline over
+        // `latency` from now, the events after this one keep their spacing from it
+        const int64_t target = static_cast<int64_t>(at) + offset;
+        const int64_t ahead = target - static_cast<int64_t>(now);
+        if (!synced || ahead < 0 || ahead > static_cast<int64_t>(sample_rate / 4 + latency)) {
+            offset = static_cast<int64_t>(now + latency) - static_cast<int64_t>(at);
+            synced = true;
+            return now + latency;
+        }
+        return static_cast<uint64_t>(target);
+    }
+
+    void AudioEngine::render(int16_t* out, size_t samples) {
+        const float volume = static_cast<float>(level.load(std::memory_order_relaxed));
+
+        size_t pos = 0;
+        while (pos < samples) {
+            // Apply every event due by this sample, the first one after it ends the run of samples
+            size_t end = samples;
+            while (has_pending || (has_pending = events.pop(pending))) {
+                const uint64_t at = place(played + pos);
+                if (at > played + pos) {
+                    end = static_cast<size_t>(std::min<uint64_t>(samples, at - played));
+                    break;
+                }
+
+                // Every beep starts at phase 0, where the band-limited wave starts from silence
+                if (pending.on && !sounding) {
+                    phase = 0;
+                    pattern_phase = 0;
+                }
+                if (pending.pattern) {
+                    const double rate = 4000.0 * std::exp2((static_cast<double>(pending.pitch) - 64.0) / 48.0);
+                    pattern_step = static_cast<uint32_t>(rate * 33554432.0 / static_cast<double>(sample_rate));
+                }
+                sounding = pending.on;
+                playing = pending;
+                has_pending = false;
+            }
+
+            if (sounding && playing.pattern) {
+                for (size_t i = pos; i < end; i++) {
+                    const uint32_t bit = pattern_phase >> 25;
+                    const bool high = (playing.bits[bit >> 3] >> (7 - (bit & 7))) & 1;
+                    out[i] = static_cast<int16_t>(high ? volume : -volume);
+                    pattern_phase += pattern_step;
+                }
+            } else if (sounding) {
+                for (size_t i = pos; i < end; i++) {
+                    out[i] = static_cast<int16_t>(table[phase >> (32 - TABLE_BITS)] * volume);
+                    phase += step;
+                }
+            } else {
+                std::fill(out + pos, out + end, int16_t{0});
+            }
+            pos = end;
+        }
+
+        played += samples;
+    }
+
+    void AudioEngine::render_until(uint64_t cycle, std::vector<int16_t>& out) {
+        const uint64_t until = sample_at(cycle);
+        if (until <= played) return;
+
+        const size_t start = out.size();
+        out.resize(start + static_cast<size_t>(until - played));
+        render(out.data() + start, out.size() - start);
+    }
+
+    void write_wav(const std::string& path, const std::vector<int16_t>& samples, uint32_t sample_rate) {
+        std::vector<uint8_t> data;
+        auto put = [&](uint32_t value, size_t bytes) {
+            for (size_t i = 0; i < bytes; i++) data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        };
+        auto tag = [&](const char* name) { data.insert(data.end(), name, name + 4); };
+
+        const uint32_t bytes = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+
+        // RIFF header, a PCM format chunk (mono, 16 bit) and the data chunk, all little endian
+        tag("RIFF");
+        put(36 + bytes, 4);
+        tag("WAVE");
+        tag("fmt ");
+        put(16, 4);                         // Format chunk size
+        put(1, 2);                          // PCM
+        put(1, 2);                          // Channels
+        put(sample_rate, 4);
+        put(sample_rate * sizeof(int16_t), 4);  // Bytes per second
+        put(sizeof(int16_t), 2);            // Bytes per frame
+        put(16, 2);                         // Bits per sample
+        tag("data");
+        put(bytes, 4);
+        for (const int16_t sample : samples) put(static_cast<uint16_t>(sample), 2);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            throw std::runtime_error("Failed to write audio " + path);
+        }
+    }
+}
@@ -0,0 +1,225 @@
+#include "Chip8/Batch.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace Chip8 {
+    namespace {
+        // "file:line: message", so a bad line in a long job list is easy to find
+        [[noreturn]] void parse_error(const std::string& path, size_t line, const std::string& message) {
+            throw std::runtime_error(path + ":" + std::to_string(line) + ": " + message);
+        }
+
+        uint64_t parse_number(const std::string& token, int base, const std::string& path, size_t line) {
+            size_t used = 0;
+            uint64_t value = 0;
+            try {
+                value = std::stoull(token, &used, base);
+            } catch (const std::exception&) {
+                used = 0;
+            }
+            if (used == 0 || used != token.size()) parse_error(path, line, "not a number: " + token);
+            return value;
+        }
+
+        // Relative paths in a job list are relative to the list itself, not the working directory
+        std::string resolve(const std::string& path, const std::string& relative_to) {
+            const std::filesystem::path p(path);
+            if (p.is_absolute()) return path;
+            return (std::filesystem::path(relative_to).parent_path() / p).string();
+        }
+
+        // Non-empty lines with comments stripped, and their line numbers
+        template <typename F>
+        void for_each_line(const std::string& path, F handle) {
+            std::ifstream file(path);
+            if (!file) {
+                throw std::runtime_error("Failed to open " + path);
+            }
+
+            std::string text;
+            size_t line = 0;
+            while (std::getline(file, text)) {
+                line++;
+                text = text.substr(0, text.find('#'));
+
+                std::istringstream tokens(text);
+                std::vector<std::string> fields;
+                for (std::string field; tokens >> field;) fields.push_back(field);
+
+                if (!fields.empty()) handle(fields, line);
+            }
+        }
+
+        // One per worker. The owner takes from the front, thieves from the back
+        struct WorkQueue {
+            std::mutex lock;
+            std::deque<size_t> jobs;
+        };
+
+        bool take(WorkQueue& queue, size_t& job, bool steal) {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.jobs.empty()) return false;
+
+            if (steal) {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            } else {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+            return true;
+        }
+    }
+
+    std::vector<ScriptedInput> load_input_script(const std::string& path) {
+        std::vector<ScriptedInput> script;
+
+        for_each_line(path, [&](const std::vector<std::string>& fields, size_t line) {
+            if (fields.size() != 3) parse_error(path, line, "expected <frame> <key 0-F> <down|up>");
+
+            ScriptedInput input;
+            input.frame = parse_number(fields[0], 10, path, line);
+
+            const uint64_t key = parse_number(fields[1], 16, path, line);
+            if (key > 0xF) parse_error(path, line, "key out of range: " + fields[1]);
+            input.event.key = static_cast<uint8_t>(key);
+
+            if (fields[2] == "down") input.event.type = InputEvent::Type::KEY_DOWN;
+            else if (fields[2] == "up") input.event.type = InputEvent::Type::KEY_UP;
+            else parse_error(path, line, "expected down or up, got " + fields[2]);
+
+            script.push_back(input);
+        });
+
+        // Events on the same frame keep their order in the file
+        std::stable_sort(script.begin(), script.end(),
+                         [](const ScriptedInput& a, const ScriptedInput& b) { return a.frame < b.frame; });
+        return script;
+    }
+
+    std::vector<BatchJob> load_job_list(const std::string& path) {
+        std::vector<BatchJob> jobs;
+
+        for_each_line(path, [&](const std::vector<std::string>& fields, size_t line) {
+            if (fields.size() < 2) parse_error(path, line, "expected <rom> <frames> [key=value...]");
+
+            BatchJob job;
+            job.rom_path = resolve(fields[0], path);
+            job.frames = parse_number(fields[1], 10, path, line);
+            job.quirks = rom_quirks(job.rom_path);
+
+            for (size_t i = 2; i < fields.size(); i++) {
+                const size_t eq = fields[i].find('=');
+                if (eq == std::string::npos) parse_error(path, line, "expected key=value, got " + fields[i]);
+
+                const std::string key = fields[i].substr(0, eq);
+                const std::string value = fields[i].substr(eq + 1);
+
+                if (key == "ips") {
+                    job.config.ints_per_second = static_cast<uint32_t>(parse_number(value, 10, path, line));
+                } else if (key == "seed") {
+                    job.seed = static_cast<uint32_t>(parse_number(value, 10, path, line));
+                } else if (key == "quirks") {
+                    if (!parse_quirks(value, job.quirks)) parse_error(path, line, "unknown quirk profile: " + value);
+                } else if (key == "xochip") {
+                    job.quirks = parse_number(value, 10, path, line) != 0 ? Quirks::XOCHIP : Quirks::MODERN;
+                } else if (key == "input") {
+                    job.input_path = resolve(value, path);
+                    job.input = load_input_script(job.input_path);
+                } else {
+                    parse_error(path, line, "unknown option: " + key);
+                }
+            }
+
+            jobs.push_back(std::move(job));
+        });
+
+        return jobs;
+    }
+
+    BatchResult run_job(const BatchJob& job) {
+        BatchResult result;
+        Machine machine;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        try {
+            machine.quirks = job.quirks;
+            load_rom(machine, job.rom_path);
+            seed_random(machine, job.seed);
+
+            size_t next_input = 0;
+            while (machine.frames < job.frames) {
+                // Input scheduled for this frame goes in before its instructions run
+                while (next_input < job.input.size() && job.input[next_input].frame <= machine.frames) {
+                    apply_input(machine, job.input[next_input++].event);
+                }
+
+                run_frame(machine, job.config);
+            }
+        } catch (const std::exception& e) {
+            result.error = e.what();
+
+            // Some core errors end in a newline, which would break the results file
+            while (!result.error.empty() && result.error.back() == '\n') result.error.pop_back();
+        }
+
+        result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.framebuffer_hash = framebuffer_hash(machine);
+        result.cycles = machine.cycles;
+        result.frames = machine.frames;
+        return result;
+    }
+
+    std::vector<BatchResult> run_batch(const std::vector<BatchJob>& jobs, unsigned threads) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(jobs.size(), 1)));
+
+        // Deal the most expensive jobs out first so every worker starts with a similar load,
+        // stealing evens out the rest (ROMs that QUIT early, jobs that throw, uneven ROMs)
+        std::vector<size_t> order(jobs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return jobs[a].frames * jobs[a].config.ints_per_second > jobs[b].frames * jobs[b].config.ints_per_second;
+        });
+
+        std::vector<WorkQueue> queues(threads);
+        for (size_t i = 0; i < order.size(); i++) {
+            queues[i % threads].jobs.push_back(order[i]);
+        }
+
+        // Each job writes only its own slot, so results need no lock
+        std::vector<BatchResult> results(jobs.size());
+
+        auto worker = [&](unsigned self) {
+            size_t job = 0;
+            while (true) {
+                bool found = take(queues[self], job, false);
+
+                // Own queue is empty, steal from the others. No new jobs ever appear, so if
+                // every queue is empty the batch is done
+                for (unsigned i = 1; !found && i < threads; i++) {
+                    found = take(queues[(self + i) % threads], job, true);
+                }
+                if (!found) return;
+
+                results[job] = run_job(jobs[job]);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads; i++) workers.emplace_back(worker, i);
+        worker(0);  // The calling thread is worker 0
+        for (std::thread& t : workers) t.join();
+
+        return results;
+    }
+}
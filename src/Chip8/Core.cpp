@@ -0,0 +1,215 @@
+#include "Chip8/Core.hpp"
+#include "Chip8/Display.hpp"
+#include "Chip8/Idle.hpp"
+#include "Chip8/Jit.hpp"
+#include "Chip8/Profiler.hpp"
+#include "Chip8/SaveState.hpp"
+#include <iostream>
+
+namespace Chip8 {
+    void load_rom(Machine& machine, std::string_view rom_path) {
+        init_chip8(machine, rom_path);
+    }
+
+    bool xochip_rom_name(std::string_view rom_path) {
+        constexpr std::string_view EXTENSION = ".xo8";
+        return rom_path.size() >= EXTENSION.size() && rom_path.substr(rom_path.size() - EXTENSION.size()) == EXTENSION;
+    }
+
+    Quirks rom_quirks(std::string_view rom_path) {
+        return xochip_rom_name(rom_path) ? Quirks::XOCHIP : Quirks::MODERN;
+    }
+
+    void apply_input(Machine& machine, const InputEvent& event) {
+        switch (event.type) {
+            case InputEvent::Type::KEY_DOWN:
+                machine.keypad[event.key & 0xF] = true;
+                break;
+
+            case InputEvent::Type::KEY_UP:
+                machine.keypad[event.key & 0xF] = false;
+                break;
+
+            case InputEvent::Type::TOGGLE_PAUSE:
+                if (machine.state == EmulatorState::RUNNING) {
+                    machine.state = EmulatorState::PAUSED;
+                    std::cout << "=== PAUSED ===" << std::endl;
+                } else if (machine.state == EmulatorState::PAUSED) {
+                    machine.state = EmulatorState::RUNNING;
+                    std::cout << "=== RESUMED ===" << std::endl;
+                }
+                break;
+
+            case InputEvent::Type::RESET:
+                reset_chip8(machine);
+                break;
+
+            case InputEvent::Type::SAVE_STATE:
+            case InputEvent::Type::LOAD_STATE: {
+                const std::string path = state_path(machine.rom_name);
+                try {
+                    if (event.type == InputEvent::Type::SAVE_STATE) {
+                        save_state(machine, path);
+                        std::cout << "=== STATE SAVED to " << path << " ===" << std::endl;
+                    } else {
+                        // Paused or not is up to the player, not the state file
+                        const EmulatorState run_state = machine.state;
+                        load_state(machine, path);
+                        machine.state = run_state;
+                        std::cout << "=== STATE LOADED from " << path << " ===" << std::endl;
+                    }
+                } catch (const std::exception& e) {
+                    // A missing or bad state file shouldn't end the game in progress
+                    std::cerr << e.what() << std::endl;
+                }
+                break;
+            }
+
+            case InputEvent::Type::REWIND_START:
+            case InputEvent::Type::REWIND_STOP:
+                // Rewinding is up to whoever keeps the history
+                break;
+
+            case InputEvent::Type::FAST_FORWARD_START:
+            case InputEvent::Type::FAST_FORWARD_STOP:
+            case InputEvent::Type::TOGGLE_UNCAPPED:
+                // And how fast the machine runs to whoever runs it
+                break;
+
+            case InputEvent::Type::QUIT:
+                machine.state = EmulatorState::QUIT;
+                break;
+        }
+    }
+
+    void seed_random(Machine& machine, uint32_t seed) {
+        // xorshift never leaves (or reaches) 0, so 0 can't be a state
+        machine.rng = seed ? seed : DEFAULT_RNG_SEED;
+    }
+
+    uint64_t run_cycles(Machine& machine, const Config& config, uint64_t n, Jit* jit) {
+        // No instruction can QUIT the machine, so checking once up front is enough
+        if (machine.state == EmulatorState::QUIT) return 0;
+
+    #if CHIP8_PROFILER
+        // The profiler has to see each instruction, so it takes over from the JIT and the dispatch loop
+        if (machine.profiler) {
+            const uint64_t executed = machine.profiler->run(machine, config, n);
+            machine.cycles += executed;
+            return executed;
+        }
+    #endif
+
+        // Skip the whole passes of a wait loop, if the machine is in one, and run what's left over
+        uint64_t executed = 0;
+        if (config.skip_idle && n > 0) {
+            executed = skip_idle(machine, config, n);
+        } else {
+            machine.idle = IdleWait::NONE;
+        }
+
+        executed += jit ? jit->run(machine, config, n - executed)
+                        : execute<DEFAULT_DISPATCH>(machine, config, n - executed);
+        machine.cycles += executed;
+        return executed;
+    }
+
+    uint64_t frame_cycles(const Machine& machine, const Config& config) {
+        // e.g 700hz: frame 0 runs 11, frame 1 runs 12, ... and every 60 frames add up to exactly 700
+        const uint64_t hz = config.ints_per_second;
+        return ((machine.frames + 1) * hz) / 60 - (machine.frames * hz) / 60;
+    }
+
+    void run_frame(Machine& machine, const Config& config, Jit* jit) {
+        run_cycles(machine, config, frame_cycles(machine, config), jit);
+        tick_timers(machine);
+    }
+
+    void tick_timers(Machine& machine) {
+        // Opcode 0xFX15 sets the delay timer as V[X]
+        if (machine.delay_timer > 0) --machine.delay_timer;
+
+        // Opcode 0xFX18 sets the sound timer as V[X]
+        if (machine.sound_timer > 0) --machine.sound_timer;
+
+        // The vertical blank a VIP's DXYN waits for
+        machine.vblank_wait = false;
+
+        ++machine.frames;
+    }
+
+    const Display& framebuffer(const Machine& machine) {
+        return machine.display;
+    }
+
+    bool pixel(const Machine& machine, uint32_t x, uint32_t y) {
+        // Column 0 is the most significant bit of the row's first word, column 64 of its second
+        x %= display_width(machine.hires);
+        y %= display_height(machine.hires);
+        bool lit = false;
+        for (uint32_t p = 0; p < display_planes(machine.xochip); p++) {
+            lit |= (machine.display[p][y][x / 64] >> (63 - x % 64)) & 1;
+        }
+        return lit;
+    }
+
+    uint32_t screen_width(const Machine& machine) {
+        return display_width(machine.hires);
+    }
+
+    uint32_t screen_height(const Machine& machine) {
+        return display_height(machine.hires);
+    }
+
+    CpuState cpu_state(const Machine& machine) {
+        return CpuState{machine.V, machine.I, machine.PC, machine.stack_ptr,
+                        machine.delay_timer, machine.sound_timer, machine.cycles, machine.frames};
+    }
+
+    uint64_t take_dirty_rows(Machine& machine) {
+        const uint64_t dirty = machine.dirty_rows;
+        machine.dirty_rows = 0;
+        return dirty;
+    }
+
+    namespace {
+        // MurmurHash3's 64 bit finalizer: every input bit flips about half of the output bits
+        // An FNV step on its own can't do that for a whole word. Its multiply only carries bits
+        // upwards, so a word's top bits (the pixels at its left edge) would only ever reach the
+        // top bits of the hash, and a pixel in column 0 would only flip bit 63
+        uint64_t mix64(uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xFF51AFD7ED558CCDULL;
+            x ^= x >> 33;
+            x *= 0xC4CEB9FE1A85EC53ULL;
+            x ^= x >> 33;
+            return x;
+        }
+    }
+
+    uint64_t framebuffer_hash(const Machine& machine) {
+        // Hashed a word (8 bytes) at a time, only the part the current mode shows: 32 words in
+        // lo-res and 128 in hi-res. XO-CHIP hashes its other planes after plane 0, the same way
+        // Each word is mixed before the FNV step, so every pixel reaches every bit of the hash
+        const uint32_t words = display_width(machine.hires) / 64;
+        uint64_t hash = 0xCBF29CE484222325ULL;     // FNV offset basis
+        for (uint32_t p = 0; p < display_planes(machine.xochip); p++) {
+            for (uint32_t y = 0; y < display_height(machine.hires); y++) {
+                for (uint32_t w = 0; w < words; w++) {
+                    hash ^= mix64(machine.display[p][y][w]);
+                    hash *= 0x100000001B3ULL;       // FNV prime
+                }
+            }
+        }
+        return hash;
+    }
+
+    uint64_t hash_bytes(const uint8_t* data, size_t size) {
+        uint64_t hash = 0xCBF29CE484222325ULL;     // FNV offset basis
+        for (size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001B3ULL;               // FNV prime
+        }
+        return hash;
+    }
+}
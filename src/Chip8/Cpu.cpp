@@ -1,564 +1,1021 @@
 #include "Chip8/Cpu.hpp"
+#include "Chip8/Display.hpp"
 #include <stdexcept>
 #include <iostream>
 
 #ifdef DEBUG
+    #include "Chip8/Analyzer.hpp"
     #include <iostream>
 #endif
 
 namespace Chip8 {
-    #ifdef DEBUG
-        std::string opcode_description(uint16_t opcode) {
-            switch (opcode & 0xF000) {
-                case 0x0000:
-                    if ((opcode & 0x00FF) == 0xE0) return "CLS (Clear the display)";
-                    if ((opcode & 0x00FF) == 0xEE) return "RET (Return from subroutine)";
-                    return "SYS (Ignored)";
-                case 0x1000: return "JP addr (Jump to address)";
-                case 0x2000: return "CALL addr (Call subroutine)";
-                case 0x3000: return "Skips next instruction if VX == NN";
-                case 0x4000: return "Skips next instruction if VX != NN";
-                case 0x5000: return "Skips next instruction if VX == VY";
-                case 0x6000: return "Sets VX to NN";
-                case 0x7000: return "Adds NN to VX (carry flag is not changed)";
-                case 0x8000:
-                    if ((opcode & 0x000F) == 0x0) return "Sets VX to the value of VY";
-                    if ((opcode & 0x000F) == 0x1) return "Sets VX to VX or VY";
-                    if ((opcode & 0x000F) == 0x2) return "Sets VX to VX and VY";
-                    if ((opcode & 0x000F) == 0x3) return "Sets VX to VX xor VY";
-                    if ((opcode & 0x000F) == 0x4) return "Adds VY to VX";
-                    if ((opcode & 0x000F) == 0x5) return "VY is subtracted from VX";
-                    if ((opcode & 0x000F) == 0x6) return "Shifts VX to the right by 1";
-                    if ((opcode & 0x000F) == 0x7) return "Sets VX to VY minus VX";
-                    if ((opcode & 0x000F) == 0xE) return "Shifts VX to the left by 1";
-                    return "Wrong/Unimplemented Opcode";
-                case 0x9000: return "Skips the next instruction if VX does not equal VY";
-                case 0xA000: return "Sets I to the address NNN";
-                case 0xB000: return "Jumps to the address NNN plus V0";
-                case 0xC000: return "Sets VX to the result of a bitwise and operation "
-                                        "on a random number (Typically: 0 to 255) and NN";
-                case 0xD000: return "Draws a sprite at coordinate (VX, VY) "
-                                        "that has a width of 8 pixels and a height of N pixels";
-                case 0xE000:
-                    if ((opcode & 0x00FF) == 0x9E) return "Skip the next instruction if the key stored in VX"
-                                                            " is pressed";
-                    if ((opcode & 0x00FF) == 0xA1) return "Skip the next instruction if the key stored in VX" 
-                                                            " is not pressed";
-                    return "Wrong/Unimplemented Opcode";
-                case 0xF000:
-                    if ((opcode & 0x00FF) == 0x07) return "Sets VX to the value of the delay timer";
-                    if ((opcode & 0x00FF) == 0x0A) return "A key press is awaited, and then stored in VX";
-                    if ((opcode & 0x00FF) == 0x15) return "Sets the delay timer to VX";
-                    if ((opcode & 0x00FF) == 0x18) return "Sets the sound timer to VX";
-                    if ((opcode & 0x00FF) == 0x1E) return "Adds VX to I. For non-Amiga Chip8, VF is not affected";
-                    if ((opcode & 0x00FF) == 0x29) return "Sets I to the location of the sprite in memory"
-                                                            " for the character in VX";
-                    if ((opcode & 0x00FF) == 0x33) return "Stores the binary-coded decimal representation of VX"
-                                                            " at memory offset from I";
-                    if ((opcode & 0x00FF) == 0x55) return "Stores from V0 to VX (including VX) in memory,"
-                                                            " starting at address I";
-                    if ((opcode & 0x00FF) == 0x65) return "Fills from V0 to VX (including VX) with values from memory,"
-                                                            " starting at address I ";
-                    return "Wrong/Unimplemented Opcode";
-            }
-            return "Unknown/Unimplemented opcode";
+    // Opcode -> Op for all 65536 opcodes, generated at compile time from decode_op()
+    // Decoding is one load instead of up to three nested switches
+    static constexpr std::array<Op, 0x10000> make_op_table() {
+        std::array<Op, 0x10000> table{};
+        for (uint32_t opcode = 0; opcode < table.size(); opcode++) {
+            table[opcode] = decode_op(static_cast<uint16_t>(opcode));
         }
-    #endif
+        return table;
+    }
 
-    // Emulate 1 machine instruction
-    void emulate_instruction(Machine& machine, const Config& config) {
+    static constexpr std::array<Op, 0x10000> OP_TABLE = make_op_table();
+
+    // Work out which op an opcode is and pre-extract its operands
+    // Only called on a decode cache miss
+    DecodedInst decode(uint16_t opcode) {
+        DecodedInst decoded{};
+
+        // Fill out current instruction format
+        // DXYN is the display opcode || X and Y always appear on those positions like the skip opcode EX9E
+        // To get Y or X we need to shit to the right and then mask those bits
+        decoded.inst.opcode = opcode;
+        decoded.inst.NNN = opcode & 0x0FFF;
+        decoded.inst.NN = opcode & 0x00FF;
+        decoded.inst.N = opcode & 0x000F;
+        decoded.inst.Y = (opcode >> 4) & 0x000F;
+        decoded.inst.X = (opcode >> 8) & 0x000F;
+        decoded.op = OP_TABLE[opcode];
+
+        return decoded;
+    }
+
+    // Opcode handlers, one per Op
+    // The instruction is in machine.current_inst and PC already points past it
+
+    // Handlers whose opcodes differ between quirk profiles are templates on the profile Q
+    // (a QuirkProfile, see Chip8/Quirks.hpp) and test its constants with if constexpr, so each
+    // profile's copy has only its own behaviour in it
+
+    // Skip the next instruction. XO-CHIP's F000 NNNN is 4 bytes long, so there it skips all 4
+    template <typename Q>
+    static inline void skip(Machine& machine) {
+        if constexpr (Q::xochip) {
+            const uint16_t next = (machine.ram[machine.PC & machine.ram_mask] << 8)
+                                | machine.ram[(machine.PC + 1) & machine.ram_mask];
+            machine.PC += (next == 0xF000) ? 4 : 2;
+        } else {
+            machine.PC += 2;
+        }
+    }
+
+    // RAM from addr to addr+len-1 (wrapping at the end of RAM) was written
+    // Self-modifying code: drop any predecoded instructions that were overwritten
+    static inline void wrote_ram(Machine& machine, uint16_t addr, uint16_t len) {
+        addr &= machine.ram_mask;
+        const uint32_t end = static_cast<uint32_t>(addr) + len;
+        if (end <= machine.ram_mask + 1u) {
+            machine.decode_cache.invalidate(addr, len);
+        } else {
+            machine.decode_cache.invalidate(addr, static_cast<uint16_t>(machine.ram_mask + 1u - addr));
+            machine.decode_cache.invalidate(0, static_cast<uint16_t>(end - (machine.ram_mask + 1u)));
+        }
+    }
+
+    static void op_00E0(Machine& machine, const Config&) {
+        // 0x00E0: Clear the screen (in XO-CHIP, the selected planes)
+        for_each_plane(machine.display, machine.planes, [&](Framebuffer& plane) {
+            clear_display(plane, machine.dirty_rows);
+        });
+    }
+
+    static void op_00EE(Machine& machine, const Config&) {
+        // 0x00EE: Returns from a subroutine.
+        // Set PC to last address on subroutine stack ("pop" it off the stack)
+        //  so that next opcode will be gotten from that address.
+        // cause it was incremented, we need the decremented value
+        machine.PC = machine.stack[--machine.stack_ptr]; 
+        // The stack_ptr is decremented first (--) to point to the most recently pushed value.
+        // The value at that index is retrieved from the stack and assigned to the program counter
+    }
+
+    static void op_0NNN(Machine&, const Config&) {
+        std::cout << "CALL not implemented because its not necessary for most ROMs"
+        << std::endl;
+    }
+
+    static void op_1NNN(Machine& machine, const Config&) {
+        // 1NNN: Jumps to address NNN;
+        machine.PC = machine.current_inst.NNN;  // Set Program counter so that next opcode is from NNN
+
+        // DEBUG
+        #ifdef DEBUG
+            std::cout << "Jump to NNN: " << std::hex << machine.current_inst.NNN 
+            << std::dec << std::endl;
+        #endif
+    }
+
+    static void op_2NNN(Machine& machine, const Config&) {
+        if (machine.stack_ptr >= machine.stack.size()) {
+            throw std::runtime_error("Stack overflow");
+        }
+
+        // 2NNN: Calls subroutine at NNN
+        // the current executing address for this opcode, we already incremented past it
+        // we're pointing to the next one, thats where we'll need to return from the subroutine to keep executing
+        // if we didn't pre-increment, we'd be adding the call to the subroutine stack and enter a infinite loop
+        machine.stack[machine.stack_ptr++] = machine.PC; 
+        // ("push" it on the stack) PC is stored at the stack_ptr index and then increment it (++)
+
+        // Now make PC NNN cause that is where the subroutine is, so that next opcode is gotten from there
+        machine.PC = machine.current_inst.NNN;
+    }
+
+    template <typename Q>
+    static void op_3XNN(Machine& machine, const Config&) {
+        // 0x3XNN: Skips the next instruction if VX equals NN 
+        // (usually the next instruction is a jump to skip a code block)
+        if (machine.V[machine.current_inst.X] == machine.current_inst.NN) {
+            skip<Q>(machine);      // Skip to next opcode (2bytes)
+        }
+    }
+
+    template <typename Q>
+    static void op_4XNN(Machine& machine, const Config&) {
+        // 0x4XNN: Skips the next instruction if VX does not equal NN 
+        // (usually the next instruction is a jump to skip a code block)
+        if (machine.V[machine.current_inst.X] != machine.current_inst.NN) {
+            skip<Q>(machine);      // Skip to next opcode (2bytes)
+        }
+    }
+
+    template <typename Q>
+    static void op_5XY0(Machine& machine, const Config&) {
+        // 0x5XY0: Skips the next instruction if VX equals VY
+        // (usually the next instruction is a jump to skip a code block)
+        if (machine.V[machine.current_inst.X] == machine.V[machine.current_inst.Y]) {
+            skip<Q>(machine);      // Skip to next opcode (2bytes)
+        }
+    }
+
+    static void op_6XNN(Machine& machine, const Config&) {
+        // 0x6XNN: Set register VX to NN
+        machine.V[machine.current_inst.X] = machine.current_inst.NN;
+    }
+
+    static void op_7XNN(Machine& machine, const Config&) {
+        // 0x7XNN: Adds NN to VX (carry flag is not changed)
+        machine.V[machine.current_inst.X] += machine.current_inst.NN;
+    }
+
+    static void op_8XY0(Machine& machine, const Config&) {
+        // 0x8XY0: Sets VX to the value of VY
+        machine.V[machine.current_inst.X] = machine.V[machine.current_inst.Y];
+    }
+
+    template <typename Q>
+    static void op_8XY1(Machine& machine, const Config&) {
+        // 0x8XY1: Sets VX to VX or VY. (bitwise OR operation)
+        machine.V[machine.current_inst.X] |= machine.V[machine.current_inst.Y];
+        // In original behaviour, in 8XY1/2/3, it reset the carry flag. SUPER-CHIP and XO-CHIP leave it
+        if constexpr (Q::logic_resets_vf) machine.V[0xF] = 0;
+    }
+
+    template <typename Q>
+    static void op_8XY2(Machine& machine, const Config&) {
+        // 0x8XY2: Sets VX to VX and VY. (bitwise AND operation)
+        machine.V[machine.current_inst.X] &= machine.V[machine.current_inst.Y];
+        if constexpr (Q::logic_resets_vf) machine.V[0xF] = 0;
+    }
+
+    template <typename Q>
+    static void op_8XY3(Machine& machine, const Config&) {
+        // 0x8XY3: Sets VX to VX xor VY
+        machine.V[machine.current_inst.X] ^= machine.V[machine.current_inst.Y];
+        if constexpr (Q::logic_resets_vf) machine.V[0xF] = 0;
+    }
+
+    static void op_8XY4(Machine& machine, const Config&) {
         bool carry = 0;
-        // x86 is small indian architecture
-        // PC is in its instruction address gathering data in 2 bytes big indian
-        // We need grab the first byte, so shift it over to the left, grab it and or that in
-        // For it to read and execute as a big indian value
-        // Get next opcode from RAM
-        machine.current_inst.opcode = 
-            (machine.ram[machine.PC] << 8) | machine.ram[machine.PC+1];
 
+        // 0x8XY4: Adds VY to VX. 
+        // VF is set to 1 when there's an overflow, and to 0 when there is not
         #ifdef DEBUG
-            std::cout << "PC: 0x" << std::hex << machine.PC
-                  << "  OPCODE: 0x" << machine.current_inst.opcode
-                  << "  DESC: " << opcode_description(machine.current_inst.opcode)
-                  << std::dec << std::endl;
+        std::cout << "V[X]: " << static_cast<uint16_t>(machine.V[machine.current_inst.X])
+        << " V[Y]: " << static_cast<uint16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
+        << static_cast<uint16_t>(machine.V[0xF]) << std::endl;
         #endif
 
-        // To read the next opcode on the next go around, increase PC by 2 bytes
-        machine.PC +=2;  // Pre-increment PC for next opcode, instead of incrementing it later
+        carry = ((machine.V[machine.current_inst.X] 
+                    + machine.V[machine.current_inst.Y]) 
+                    > 0xFF);
 
-        // Fill out current instruction format
-        // DXYN is the display opcode || X and Y always appear on those positions like the skip opcode EX9E
-        // To get Y or X we need to shit to the right and then mask those bits
-        machine.current_inst.NNN = machine.current_inst.opcode & 0x0FFF;
-        machine.current_inst.NN = machine.current_inst.opcode & 0x00FF;
-        machine.current_inst.N = machine.current_inst.opcode & 0x000F;
-        machine.current_inst.Y = (machine.current_inst.opcode >> 4) & 0x000F;
-        machine.current_inst.X = (machine.current_inst.opcode >> 8) & 0x000F; 
-
-
-        // Emulate the 35 opcodes
-        switch (machine.current_inst.opcode >> 12)
-        {
-        case 0x00:
-            // if else because there are only 2 cases where they start with 0
-            if (machine.current_inst.NN == 0xE0) {
-                // 0x00E0: Clear the screen
-                machine.display.fill(false);
-            } else if (machine.current_inst.NN == 0xEE)
-            {
-                // 0x00EE: Returns from a subroutine.
-                // Set PC to last address on subroutine stack ("pop" it off the stack)
-                //  so that next opcode will be gotten from that address.
-                // cause it was incremented, we need the decremented value
-                machine.PC = machine.stack[--machine.stack_ptr]; 
-                // The stack_ptr is decremented first (--) to point to the most recently pushed value.
-                // The value at that index is retrieved from the stack and assigned to the program counter
-            } else
-            {
-                std::cout << "CALL not implemented because its not necessary for most ROMs"
-                << std::endl;
-            }
-            
-            break;
-
-        case 0x01:
-            // 1NNN: Jumps to address NNN;
-            machine.PC = machine.current_inst.NNN;  // Set Program counter so that next opcode is from NNN
-
-            // DEBUG
-            #ifdef DEBUG
-                std::cout << "Jump to NNN: " << std::hex << machine.current_inst.NNN 
-                << std::dec << std::endl;
-            #endif
-            break;
-
-        case 0x02:
-            if (machine.stack_ptr >= machine.stack.size()) {
-                throw std::runtime_error("Stack overflow");
-            }
+        machine.V[machine.current_inst.X] += machine.V[machine.current_inst.Y];
 
-            // 2NNN: Calls subroutine at NNN
-            // the current executing address for this opcode, we already incremented past it
-            // we're pointing to the next one, thats where we'll need to return from the subroutine to keep executing
-            // if we didn't pre-increment, we'd be adding the call to the subroutine stack and enter a infinite loop
-            machine.stack[machine.stack_ptr++] = machine.PC; 
-            // ("push" it on the stack) PC is stored at the stack_ptr index and then increment it (++)
-
-            // Now make PC NNN cause that is where the subroutine is, so that next opcode is gotten from there
-            machine.PC = machine.current_inst.NNN;
-            break;
-
-        case 0x03:
-            // 0x3XNN: Skips the next instruction if VX equals NN 
-            // (usually the next instruction is a jump to skip a code block)
-            if (machine.V[machine.current_inst.X] == machine.current_inst.NN) {
-                machine.PC += 2;    // Skip to next opcode (2bytes)
-            }
-            break;
+        machine.V[0xF] = carry;
+
+        #ifdef DEBUG
+        std::cout << "After Sum -> " << "V[X]: " 
+        << static_cast<uint16_t>(machine.V[machine.current_inst.X])
+        << " V[Y]: " << static_cast<uint16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
+        << static_cast<uint16_t>(machine.V[0xF]) << std::endl;
+        #endif
+    }
+
+    static void op_8XY5(Machine& machine, const Config&) {
+        bool carry = 0;
+
+        // 0x8XY5: VY is subtracted from VX. 
+        // VF is set to 0 when there's an underflow, 1 when there is not 
+        #ifdef DEBUG
+        std::cout << "V[X]: " << static_cast<int16_t>(machine.V[machine.current_inst.X])
+        << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
+        << static_cast<int16_t>(machine.V[0xF]) << std::endl;
+        #endif
+
+        // Get carry value first, then do operation and ONLY after set the carry flag
+        // It's the correct order for the CHIP8 interpreter
+        carry = (machine.V[machine.current_inst.Y] <= machine.V[machine.current_inst.X]);
+
+        machine.V[machine.current_inst.X] -= machine.V[machine.current_inst.Y];
+
+        machine.V[0xF] = carry;
+            // V[Y] is bigger then V[X] So the result will be negative and underflow (borrow)
         
-        case 0x04:
-            // 0x4XNN: Skips the next instruction if VX does not equal NN 
-            // (usually the next instruction is a jump to skip a code block)
-            if (machine.V[machine.current_inst.X] != machine.current_inst.NN) {
-                machine.PC += 2;    // Skip to next opcode (2bytes)
+        #ifdef DEBUG
+        std::cout << "After Subtraction VX=VX-VY -> " << "V[X]: " 
+        << static_cast<int16_t>(machine.V[machine.current_inst.X])
+        << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
+        << static_cast<int16_t>(machine.V[0xF]) << std::endl;
+        #endif
+    }
+
+    template <typename Q>
+    static void op_8XY6(Machine& machine, const Config&) {
+        bool carry = 0;
+
+        // 0x8XY6: Shifts VX to the right by 1, 
+        // then stores the least significant bit of VX prior to the shift into VF.
+        // X is a 4-bit register identifier so if its 10 -> 1010, we store 0
+        // Chip8 shifts V[Y] into V[X], SUPER-CHIP and XO-CHIP shift V[X] itself and ignore Y
+        const uint8_t value = machine.V[Q::shift_vy ? machine.current_inst.Y : machine.current_inst.X];
+        carry = value & 1;
+
+        // shift right so the 10 -> 1010 will now be 5 -> 0101
+        machine.V[machine.current_inst.X] = value >> 1;
+
+        machine.V[0xF] = carry;
+    }
+
+    static void op_8XY7(Machine& machine, const Config&) {
+        // 0x8XY7: Sets VX to VY minus VX. 
+        // VF is set to 0 when there's an underflow, and 1 when there is not 
+        #ifdef DEBUG
+        std::cout << "V[X]: " << static_cast<int16_t>(machine.V[machine.current_inst.X])
+        << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
+        << static_cast<int16_t>(machine.V[0xF]) << std::endl;
+        #endif
+
+        machine.V[machine.current_inst.X] = machine.V[machine.current_inst.Y] - 
+                                            machine.V[machine.current_inst.X];
+
+        if (machine.V[machine.current_inst.Y] >= machine.V[machine.current_inst.X]){
+            machine.V[0xF] = 1;
+        } else {
+            // V[Y] is bigger then V[X] So the result will be negative and underflow (borrow)
+            machine.V[0xF] = 0; // Underflow
+        }
+
+        #ifdef DEBUG
+        std::cout << "After Subtraction VX=VY-VX -> " << "V[X]: " 
+        << static_cast<int16_t>(machine.V[machine.current_inst.X])
+        << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
+        << static_cast<int16_t>(machine.V[0xF]) << std::endl;
+        #endif
+    }
+
+    template <typename Q>
+    static void op_8XYE(Machine& machine, const Config&) {
+        bool carry = 0;
+
+        // 0x8XYE: Shifts VX to the left by 1, then sets VF to 1 if the most significant bit of VX 
+        // prior to that shift was set, or to 0 if it was unset
+        // V[Y] on Chip8, V[X] on SUPER-CHIP and XO-CHIP like 8XY6
+        const uint8_t value = machine.V[Q::shift_vy ? machine.current_inst.Y : machine.current_inst.X];
+        carry = (value & 0x80) >> 7; // isolate most significant bit
+
+        machine.V[machine.current_inst.X] = value << 1;
+
+        machine.V[0xF] = carry;
+    }
+
+    template <typename Q>
+    static void op_9XY0(Machine& machine, const Config&) {
+        // 0x9XY0: Skips the next instruction if VX does not equal VY
+        // (usually the next instruction is a jump to skip a code block)
+
+        if (machine.V[machine.current_inst.X] != machine.V[machine.current_inst.Y]) {
+            skip<Q>(machine);      // Skip to next opcode (2bytes)
+        }
+    }
+
+    static void op_ANNN(Machine& machine, const Config&) {
+        // 0xANNN: Set index register I to NNN
+        machine.I = machine.current_inst.NNN;
+    }
+
+    template <typename Q>
+    static void op_BNNN(Machine& machine, const Config&) {
+        // BNNN: Jumps to the address NNN plus V0;
+        // SUPER-CHIP reads it as BXNN, a jump to XNN plus VX (X is NNN's top nibble, so that's NNN + VX)
+        const uint8_t offset = machine.V[Q::jump_vx ? machine.current_inst.X : 0x0];
+        machine.PC = machine.current_inst.NNN + offset;
+
+        // DEBUG
+        #ifdef DEBUG
+            std::cout << "NNN: " << std::hex << machine.current_inst.NNN 
+            << " V: " << static_cast<uint16_t>(offset)
+            << " Jump to NNN + V: " << machine.PC
+            << std::dec << std::endl;
+        #endif
+    }
+
+    static void op_CXNN(Machine& machine, const Config&) {
+        // CXNN: Sets VX to the result of a bitwise and operation on a random number and NN
+        // the Random number typically is 0 to 255, xorshift32 step and take its top byte
+        uint32_t x = machine.rng;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        machine.rng = x;
+        machine.V[machine.current_inst.X] = static_cast<uint8_t>(x >> 24) & machine.current_inst.NN;
+    }
+
+    template <typename Q>
+    static void op_DXYN(Machine& machine, const Config&) {
+        // 0xDXYN: Draw N- height sprite at coordinates X,Y 
+        // Read from memory location I
+        // Screen pixels are XOR'd with sprite bits, 
+        // VF (carry flag) is set if any screen pixels are set off
+        // This is useful for collision detection or other reasons
+        // V[X] modulo(%) 64(resolution window width) Modulo ensures coordinates wrap around the screen
+        // If X or Y is larger than the display width/height, it wraps back to zero.
+        // If X = 66 and window_width = 64, 66 % 64 = 2 → pixel is drawn at column 2, not 66.
+        // In SUPER-CHIP hi-res that's 128x64 instead, and DXY0 draws a 16x16 sprite (on a VIP nothing)
+        // Each sprite row is shifted to X and XOR'd into the packed display row a word at a time,
+        // see draw_sprite() in Chip8/Display.hpp. Stops at the right and bottom edges,
+        // or in XO-CHIP wraps around them
+        // XO-CHIP draws the sprite on every selected plane, the next plane's sprite right after this one's
+        const bool collision = draw_sprite_planes<Q::wrap_sprites, Q::superchip>(machine.display, machine.planes, machine.dirty_rows, machine.hires,
+                                                  machine.V[machine.current_inst.X], machine.V[machine.current_inst.Y],
+                                                  machine.current_inst.N,
+                                                  [&](uint32_t i) { return machine.ram[(machine.I + i) & machine.ram_mask]; });
+
+        machine.V[0xF] = collision;    // Set if any pixel was turned off, 0 otherwise
+
+        // The VIP drew during the vertical blank, a draw waits for it and nothing else runs before
+        // the next 60hz tick. The dispatch loops stop at this flag, tick_timers() clears it
+        if constexpr (Q::display_wait) machine.vblank_wait = true;
+
+        // DEBUG
+        #ifdef DEBUG
+            std::cout << "DRAW: X=" << static_cast<uint16_t>(machine.current_inst.X)
+                    << " Y=" << static_cast<uint16_t>(machine.current_inst.Y)
+                    << " N=" << static_cast<uint16_t>(machine.current_inst.N)
+                    << " V[X]=" << static_cast<uint16_t>(machine.V[machine.current_inst.X])
+                    << " V[Y]=" << static_cast<uint16_t>(machine.V[machine.current_inst.Y])
+                    << " I=0x" << std::hex << machine.I << std::dec
+                    << " Sprite Data:";
+            for (int i = 0; i < machine.current_inst.N; ++i) {
+                std::cout << " " << std::hex << static_cast<uint16_t>(machine.ram[(machine.I + i) & machine.ram_mask]);
             }
-            break;
-
-        case 0x05:
-            // 0x5XY0: Skips the next instruction if VX equals VY
-            // (usually the next instruction is a jump to skip a code block)
-            if (machine.current_inst.N != 0) {
-                // If its not 0, then its the wrong opcode
-                std::cout << "0x5XY0 -> N is not 0. Wrong Opcode" << std::endl;
+            std::cout << std::endl;
+        #endif
+    }
+
+    template <typename Q>
+    static void op_EX9E(Machine& machine, const Config&) {
+        // 0xEX9E: Skips the next instruction if the key stored in VX(only check lowest nibble) is pressed
+        // (usually the next instruction is a jump to skip a code block)
+        if (machine.keypad[machine.V[machine.current_inst.X] & 0xF]) {
+            skip<Q>(machine);
+        }
+    }
+
+    template <typename Q>
+    static void op_EXA1(Machine& machine, const Config&) {
+        // 0xEXA1: Skips the next instruction if the key stored in VX(lowest nibble) is not pressed
+        if (!machine.keypad[machine.V[machine.current_inst.X] & 0xF]) {
+            skip<Q>(machine);
+        }
+    }
+
+    static void op_FX07(Machine& machine, const Config&) {
+        // 0xFX07: Sets VX to the value of the delay timer
+        machine.V[machine.current_inst.X] = machine.delay_timer;
+    }
+
+    static void op_FX0A(Machine& machine, const Config&) {
+        // 0xFX0A: A key press is awaited, and then stored in VX 
+        // (blocking operation, all instruction halted until next key event, 
+        // delay and sound timers should continue processing)
+        bool any_key_pressed = false;
+        uint8_t key_pressed = 0xFF;
+
+        for (uint8_t i = 0; key_pressed == 0xFF && i < machine.keypad.size(); i++) {
+            if (machine.keypad[i]) {
+                key_pressed = i;    // save pressed key to check until its released
+
+                any_key_pressed = true;
                 break;
             }
 
-            if (machine.V[machine.current_inst.X] == machine.V[machine.current_inst.Y]) {
-                machine.PC += 2;    // Skip to next opcode (2bytes)
-            }
-            break;
-
-        case 0x06:
-            // 0x6XNN: Set register VX to NN
-            machine.V[machine.current_inst.X] = machine.current_inst.NN;
-            break;
-
-        case 0x07:
-            // 0x7XNN: Adds NN to VX (carry flag is not changed)
-            machine.V[machine.current_inst.X] += machine.current_inst.NN;
-            break;
-
-        case 0x08:
-            switch (machine.current_inst.N) {
-                case 0x0:
-                    // 0x8XY0: Sets VX to the value of VY
-                    machine.V[machine.current_inst.X] = machine.V[machine.current_inst.Y];
-                    break;
-                
-                case 0x1:
-                    // 0x8XY1: Sets VX to VX or VY. (bitwise OR operation)
-                    machine.V[machine.current_inst.X] |= machine.V[machine.current_inst.Y];
-                    // In original behaviour, in 8XY1/2/3, it reset the carry flag
-                    machine.V[0xF] = 0;
-                    break;
-                
-                case 0x2:
-                    // 0x8XY2: Sets VX to VX and VY. (bitwise AND operation)
-                    machine.V[machine.current_inst.X] &= machine.V[machine.current_inst.Y];
-                    machine.V[0xF] = 0;
-                    break;
-                
-                case 0x3:
-                    // 0x8XY3: Sets VX to VX xor VY
-                    machine.V[machine.current_inst.X] ^= machine.V[machine.current_inst.Y];
-                    machine.V[0xF] = 0;
-                    break;
-
-                case 0x4:
-                    // 0x8XY4: Adds VY to VX. 
-                    // VF is set to 1 when there's an overflow, and to 0 when there is not
-                    #ifdef DEBUG
-                    std::cout << "V[X]: " << static_cast<uint16_t>(machine.V[machine.current_inst.X])
-                    << " V[Y]: " << static_cast<uint16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
-                    << static_cast<uint16_t>(machine.V[0xF]) << std::endl;
-                    #endif
-
-                    carry = ((machine.V[machine.current_inst.X] 
-                                + machine.V[machine.current_inst.Y]) 
-                                > 0xFF);
-
-                    machine.V[machine.current_inst.X] += machine.V[machine.current_inst.Y];
-
-                    machine.V[0xF] = carry;
-
-                    #ifdef DEBUG
-                    std::cout << "After Sum -> " << "V[X]: " 
-                    << static_cast<uint16_t>(machine.V[machine.current_inst.X])
-                    << " V[Y]: " << static_cast<uint16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
-                    << static_cast<uint16_t>(machine.V[0xF]) << std::endl;
-                    #endif
-
-                    break;
-
-                case 0x5:
-                    // 0x8XY5: VY is subtracted from VX. 
-                    // VF is set to 0 when there's an underflow, 1 when there is not 
-                    #ifdef DEBUG
-                    std::cout << "V[X]: " << static_cast<int16_t>(machine.V[machine.current_inst.X])
-                    << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
-                    << static_cast<int16_t>(machine.V[0xF]) << std::endl;
-                    #endif
-
-                    // Get carry value first, then do operation and ONLY after set the carry flag
-                    // It's the correct order for the CHIP8 interpreter
-                    carry = (machine.V[machine.current_inst.Y] <= machine.V[machine.current_inst.X]);
-
-                    machine.V[machine.current_inst.X] -= machine.V[machine.current_inst.Y];
-
-                    machine.V[0xF] = carry;
-                        // V[Y] is bigger then V[X] So the result will be negative and underflow (borrow)
-                    
-                    #ifdef DEBUG
-                    std::cout << "After Subtraction VX=VX-VY -> " << "V[X]: " 
-                    << static_cast<int16_t>(machine.V[machine.current_inst.X])
-                    << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
-                    << static_cast<int16_t>(machine.V[0xF]) << std::endl;
-                    #endif
-                    break;
-
-                case 0x6:
-                    // 0x8XY6: Shifts VX to the right by 1, 
-                    // then stores the least significant bit of VX prior to the shift into VF.
-                    // X is a 4-bit register identifier so if its 10 -> 1010, we store 0
-                    carry = machine.V[machine.current_inst.Y] & 1;  // Use V[Y] instead of X for Chip8
-
-                    // shift right so the 10 -> 1010 will now be 5 -> 0101
-                    machine.V[machine.current_inst.X] = machine.V[machine.current_inst.Y] >> 1;
-
-                    machine.V[0xF] = carry;
-
-                    // SOME VARIANTS
-                    /*
-                    machine.V[0xF] = machine.V[machine.current_inst.Y] & 1; 
-
-                    machine.V[machine.current_inst.X] = machine.V[machine.current_inst.Y] >> 1;
-                    */
-                    break;
-
-                case 0x7:
-                    // 0x8XY7: Sets VX to VY minus VX. 
-                    // VF is set to 0 when there's an underflow, and 1 when there is not 
-                    #ifdef DEBUG
-                    std::cout << "V[X]: " << static_cast<int16_t>(machine.V[machine.current_inst.X])
-                    << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
-                    << static_cast<int16_t>(machine.V[0xF]) << std::endl;
-                    #endif
-
-                    machine.V[machine.current_inst.X] = machine.V[machine.current_inst.Y] - 
-                                                        machine.V[machine.current_inst.X];
-
-                    if (machine.V[machine.current_inst.Y] >= machine.V[machine.current_inst.X]){
-                        machine.V[0xF] = 1;
-                    } else {
-                        // V[Y] is bigger then V[X] So the result will be negative and underflow (borrow)
-                        machine.V[0xF] = 0; // Underflow
-                    }
-
-                    #ifdef DEBUG
-                    std::cout << "After Subtraction VX=VY-VX -> " << "V[X]: " 
-                    << static_cast<int16_t>(machine.V[machine.current_inst.X])
-                    << " V[Y]: " << static_cast<int16_t>(machine.V[machine.current_inst.Y]) << " VF: " 
-                    << static_cast<int16_t>(machine.V[0xF]) << std::endl;
-                    #endif
-                    break;
-
-                case 0xE:
-                    // 0x8XYE: Shifts VX to the left by 1, then sets VF to 1 if the most significant bit of VX 
-                    // prior to that shift was set, or to 0 if it was unset
-                    // Use V[Y]
-                    carry = (machine.V[machine.current_inst.Y] & 0x80) >> 7; // isolate most significant bit
-
-                    machine.V[machine.current_inst.X] = machine.V[machine.current_inst.Y] << 1;
-
-                    machine.V[0xF] = carry;
-                    break;
-
-                default:
-                    // Wrong/unimplemented opcode
-                    break;
-            }
-            break;
-        
-        case 0x09:
-            // 0x9XY0: Skips the next instruction if VX does not equal VY
-            // (usually the next instruction is a jump to skip a code block)
-            if (machine.current_inst.N != 0) {
-                // If its not 0, then its the wrong opcode
-                #ifdef DEBUG
-                std::cout << "0x9XY0 -> N is not 0. Wrong Opcode" << std::endl;
-                #endif
+            if (!any_key_pressed) {
+                machine.PC -= 2;    // Keep getting the current opcode to wait for key press
                 break;
+            } else {
+                // Key has been pressed, but wait until its released to store value
+                if (machine.keypad[key_pressed]) {
+                    machine.PC -= 2;
+                } else {
+                    machine.V[machine.current_inst.X] = key_pressed;    // VX = key pressed
+
+                    // Reset key
+                    key_pressed = 0xFF;
+                    any_key_pressed = false;
+                }
             }
+        }
+    }
 
-            if (machine.V[machine.current_inst.X] != machine.V[machine.current_inst.Y]) {
-                machine.PC += 2;    // Skip to next opcode (2bytes)
-            }
-            break;
-
-        case 0x0A:
-            // 0xANNN: Set index register I to NNN
-            machine.I = machine.current_inst.NNN;
-            break;
-
-        case 0x0B:
-            // BNNN: Jumps to the address NNN plus V0;
-            machine.PC = machine.current_inst.NNN + machine.V[0x0];
-
-            // DEBUG
-            #ifdef DEBUG
-                std::cout << "NNN: " << std::hex << machine.current_inst.NNN 
-                << " V0: " << machine.V[0x0]
-                << " Jump to NNN + V0: " << machine.PC
-                << std::dec << std::endl;
-            #endif
-            break;
-    
-        case 0x0C:
-            // CXNN: Sets VX to the result of a bitwise and operation on a random number and NN
-            // the Random number typically is 0 to 255, so do rand with a modulo of 256
-            machine.V[machine.current_inst.X] = (rand() % 256) & machine.current_inst.NN;
-            break;
-
-        case 0x0D: {
-            // 0xDXYN: Draw N- height sprite at coordinates X,Y 
-            // Read from memory location I
-            // Screen pixels are XOR'd with sprite bits, 
-            // VF (carry flag) is set if any screen pixels are set off
-            // This is useful for collision detection or other reasons
-            // V[X] modulo(%) 64(resolution window width) Modulo ensures coordinates wrap around the screen
-            // If X or Y is larger than the display width/height, it wraps back to zero.
-            // If X = 66 and window_width = 64, 66 % 64 = 2 → pixel is drawn at column 2, not 66.
-            uint8_t X_coord = machine.V[machine.current_inst.X] % config.window_width;  // gives the X position 
-            uint8_t Y_coord = machine.V[machine.current_inst.Y] % config.window_height; // gives the Y position 
-            const uint8_t orig_X = X_coord; // Original X coordinate
-            
-            machine.V[0xF] = 0;    // Initialize carry flag to 0
-        
-            // Read each row of the sprite and loop over all N rows of the sprite (height N)
-            // Each row is a byte in memory starting at address I
-            for (uint8_t i = 0; i < machine.current_inst.N; i++) {
-                // Get next byte/row of sprite data
-                const uint8_t sprite_data = machine.ram[machine.I + i]; // i is the offset
-        
-                X_coord = orig_X;   // Reset X for next row to draw
-        
-                // Loop over each bit in the sprite byte (width 8), Check all 8 bits of row
-                // Bit index within the sprite byte (from 7 down to 0, left to right).
-                for (int8_t j = 7; j >= 0; j--) {
-                    bool pixel = machine.display[Y_coord * config.window_width + X_coord];
-                    const bool sprite_bit = (sprite_data & (1 << j));
-                    // Check if bit is on. Testing the bit left to right
-                    // 1 << 7 (1 shift left by seven) will be the top most bit
-                    // If sprite pixel/bit is on and display pixel is on, set carry flag
-                    if (sprite_bit && pixel) {
-                        machine.V[0xF] = 1; // Set
-                    }
-        
-                    // XOR display pixel with sprite pixel/bit to set it on/off
-                    pixel ^= sprite_bit;
-        
-                    // Update the display pixel
-                    machine.display[Y_coord * config.window_width + X_coord] = pixel;
-        
-                    // Stop drawing if hits the right edge of the screen
-                    if (++X_coord >= config.window_width) break;
-                }
+    static void op_FX15(Machine& machine, const Config&) {
+        // 0xFX15: Sets the delay timer to VX
+        machine.delay_timer = machine.V[machine.current_inst.X];
+    }
+
+    static void op_FX18(Machine& machine, const Config&) {
+        // 0xFX18: Sets the sound timer to VX
+        machine.sound_timer = machine.V[machine.current_inst.X];
+    }
+
+    static void op_FX1E(Machine& machine, const Config&) {
+        // 0xFX1E: Adds VX to I. For non-Amiga Chip8, VF is not affected
+        machine.I += machine.V[machine.current_inst.X];
+    }
+
+    static void op_FX29(Machine& machine, const Config&) {
+        // 0xFX29: Sets I to the location of the sprite in memory for the character in VX(0x0-0xF)
+        // Characters 0-F (in hexadecimal) are represented by a 4x5 font (4-bits 5-bytes)
+        // ADD 0x50 because my font starts at that address
+        machine.I = 0x50 + (machine.V[machine.current_inst.X] * 5);
+    }
+
+    static void op_FX33(Machine& machine, const Config&) {
+        // 0xFX33: Stores the binary-coded decimal representation of VX at memory offset from I
+        // I = hundreds place, I+1 = tens place, I+2 = ones place 
+        // Binary code: tetris score 0010 0111 1000 -> Score: 278
+        uint8_t bcd = machine.V[machine.current_inst.X]; // e.g 123
+        machine.ram[(machine.I+2) & machine.ram_mask]= bcd % 10; // 12[3]
+
+        bcd /= 10;  // divide by 10 to get rid of last digit
+        machine.ram[(machine.I+1) & machine.ram_mask]= bcd % 10; // 1[2]
+
+        bcd /= 10;
+        machine.ram[machine.I & machine.ram_mask]= bcd % 10; // [1]
         
-                // Stop drawing the entire sprite if it hits the bottom edge of the screen
-                if (++Y_coord >= config.window_height) break;
-            }
+        wrote_ram(machine, machine.I, 3);
+    }
 
-            // DEBUG
-            #ifdef DEBUG
-                std::cout << "DRAW: X=" << static_cast<uint16_t>(machine.current_inst.X)
-                        << " Y=" << static_cast<uint16_t>(machine.current_inst.Y)
-                        << " N=" << static_cast<uint16_t>(machine.current_inst.N)
-                        << " V[X]=" << static_cast<uint16_t>(machine.V[machine.current_inst.X])
-                        << " V[Y]=" << static_cast<uint16_t>(machine.V[machine.current_inst.Y])
-                        << " I=0x" << std::hex << machine.I << std::dec
-                        << " Sprite Data:";
-                for (int i = 0; i < machine.current_inst.N; ++i) {
-                    std::cout << " " << std::hex << static_cast<uint16_t>(machine.ram[machine.I + i]);
-                }
-                std::cout << std::endl;
-            #endif
+    template <typename Q>
+    static void op_FX55(Machine& machine, const Config&) {
+        // 0xFX55: Stores from V0 to VX (including VX) in memory, starting at address I 
+        // The offset from I is increased by 1 for each value written, but I itself is left unmodified
+        // SCHIP does not increment I, Chip8 (and XO-CHIP) does increment I
+        const uint16_t start = machine.I;
+        for (uint8_t i = 0; i <= machine.current_inst.X; i++) {
+            machine.ram[(start + i) & machine.ram_mask] = machine.V[i];
+        }
+        if constexpr (Q::memory_increments) machine.I += machine.current_inst.X + 1;  // Increment I for Chip8
 
-            break;
+        wrote_ram(machine, start, machine.current_inst.X + 1);
+    }
+
+    template <typename Q>
+    static void op_FX65(Machine& machine, const Config&) {
+        // 0xFX65: Fills from V0 to VX (including VX) with values from memory, starting at address I 
+        // The offset from I is increased by 1 for each value read, but I itself is left unmodified
+        // Incremented past them like FX55 does, on the profiles that do
+        const uint16_t start = machine.I;
+        for (uint8_t i = 0; i <= machine.current_inst.X; i++) {
+            machine.V[i] = machine.ram[(start + i) & machine.ram_mask];
         }
+        if constexpr (Q::memory_increments) machine.I += machine.current_inst.X + 1;
+    }
 
-        case 0x0E:
-            if (machine.current_inst.NN == 0x9E) {
-                // 0xEX9E: Skips the next instruction if the key stored in VX(only check lowest nibble) is pressed
-                // (usually the next instruction is a jump to skip a code block)
-                if (machine.keypad[machine.V[machine.current_inst.X]]) {
-                    machine.PC += 2;
-                }
-            } else if (machine.current_inst.NN == 0xA1)
-            {
-                // 0xEXA1: Skips the next instruction if the key stored in VX(lowest nibble) is not pressed
-                if (!machine.keypad[machine.V[machine.current_inst.X]]) {
-                    machine.PC += 2;
-                }
-            } else
-            {
-                #ifdef DEBUG
-                std::cout << "Opcode not implemented/wrong"
-                << std::endl;
-                #endif
-            }
-            break;
-
-        case 0x0F:
-            switch (machine.current_inst.NN)
-            {
-            case 0x07:
-                // 0xFX07: Sets VX to the value of the delay timer
-                machine.V[machine.current_inst.X] = machine.delay_timer;
-                break;
+    // SUPER-CHIP
+    // A VIP has none of these, there they do what they did on one: 00CN-00FF are 0NNN calls, the rest nothing
 
-            case 0x0A: {
-                // 0xFX0A: A key press is awaited, and then stored in VX 
-                // (blocking operation, all instruction halted until next key event, 
-                // delay and sound timers should continue processing)
-                bool any_key_pressed = false;
-                uint8_t key_pressed = 0xFF;
-
-                for (uint8_t i = 0; key_pressed == 0xFF && i < machine.keypad.size(); i++) {
-                    if (machine.keypad[i]) {
-                        key_pressed = i;    // save pressed key to check until its released
-
-                        any_key_pressed = true;
-                        break;
-                    }
-
-                    if (!any_key_pressed) {
-                        machine.PC -= 2;    // Keep getting the current opcode to wait for key press
-                        break;
-                    } else {
-                        // Key has been pressed, but wait until its released to store value
-                        if (machine.keypad[key_pressed]) {
-                            machine.PC -= 2;
-                        } else {
-                            machine.V[machine.current_inst.X] = key_pressed;    // VX = key pressed
-
-                            // Reset key
-                            key_pressed = 0xFF;
-                            any_key_pressed = false;
-                        }
-                    }
-                }
-                break;
-            }
+    static void op_invalid(Machine&, const Config&);
 
-            case 0x15:
-                // 0xFX15: Sets the delay timer to VX
-                machine.delay_timer = machine.V[machine.current_inst.X];
-                break;
+    template <typename Q>
+    static void op_00CN(Machine& machine, const Config& config) {
+        // 0x00CN: Scroll the display down N pixels (of the current resolution)
+        if constexpr (!Q::superchip) return op_0NNN(machine, config);
+        for_each_plane(machine.display, machine.planes, [&](Framebuffer& plane) {
+            scroll_down(plane, machine.dirty_rows, machine.hires, machine.current_inst.N);
+        });
+    }
 
-            case 0x18:
-                // 0xFX18: Sets the sound timer to VX
-                machine.sound_timer = machine.V[machine.current_inst.X];
-                break;
+    template <typename Q>
+    static void op_00FB(Machine& machine, const Config& config) {
+        // 0x00FB: Scroll the display right 4 pixels
+        if constexpr (!Q::superchip) return op_0NNN(machine, config);
+        for_each_plane(machine.display, machine.planes, [&](Framebuffer& plane) {
+            scroll_right(plane, machine.dirty_rows, machine.hires);
+        });
+    }
 
-            case 0x1E:
-                // 0xFX1E: Adds VX to I. For non-Amiga Chip8, VF is not affected
-                machine.I += machine.V[machine.current_inst.X];
-                break;
+    template <typename Q>
+    static void op_00FC(Machine& machine, const Config& config) {
+        // 0x00FC: Scroll the display left 4 pixels
+        if constexpr (!Q::superchip) return op_0NNN(machine, config);
+        for_each_plane(machine.display, machine.planes, [&](Framebuffer& plane) {
+            scroll_left(plane, machine.dirty_rows, machine.hires);
+        });
+    }
 
-            case 0x29:
-                // 0xFX29: Sets I to the location of the sprite in memory for the character in VX(0x0-0xF)
-                // Characters 0-F (in hexadecimal) are represented by a 4x5 font (4-bits 5-bytes)
-                // ADD 0x50 because my font starts at that address
-                machine.I = 0x50 + (machine.V[machine.current_inst.X] * 5);
-                break;
+    template <typename Q>
+    static void op_00FD(Machine& machine, const Config& config) {
+        // 0x00FD: Exit the interpreter. The machine stops here for good, like FX0A waiting forever,
+        // so the window stays up with the last picture until it is reset or closed
+        if constexpr (!Q::superchip) return op_0NNN(machine, config);
+        machine.PC -= 2;
+    }
+
+    template <typename Q>
+    static void op_00FE(Machine& machine, const Config& config) {
+        // 0x00FE: Back to 64x32 lo-res
+        // The picture wouldn't mean anything at the other size, so a switch clears the screen, every plane of it
+        if constexpr (!Q::superchip) return op_0NNN(machine, config);
+        machine.hires = false;
+        for_each_plane(machine.display, ALL_PLANES, [&](Framebuffer& plane) { clear_display(plane, machine.dirty_rows); });
+    }
 
-            case 0x33:{
-                // 0xFX33: Stores the binary-coded decimal representation of VX at memory offset from I
-                // I = hundreds place, I+1 = tens place, I+2 = ones place 
-                // Binary code: tetris score 0010 0111 1000 -> Score: 278
-                uint8_t bcd = machine.V[machine.current_inst.X]; // e.g 123
-                machine.ram[machine.I+2]= bcd % 10; // 12[3]
+    template <typename Q>
+    static void op_00FF(Machine& machine, const Config& config) {
+        // 0x00FF: 128x64 hi-res, cleared the same way
+        if constexpr (!Q::superchip) return op_0NNN(machine, config);
+        machine.hires = true;
+        for_each_plane(machine.display, ALL_PLANES, [&](Framebuffer& plane) { clear_display(plane, machine.dirty_rows); });
+    }
 
-                bcd /= 10;  // divide by 10 to get rid of last digit
-                machine.ram[machine.I+1]= bcd % 10; // 1[2]
+    template <typename Q>
+    static void op_FX30(Machine& machine, const Config& config) {
+        // 0xFX30: Sets I to the big 8x10 font character for the digit in VX (lowest nibble)
+        // ADD 0xA0 because the big font starts right after the small one
+        if constexpr (!Q::superchip) return op_invalid(machine, config);
+        machine.I = 0xA0 + (machine.V[machine.current_inst.X] & 0xF) * 10;
+    }
 
-                bcd /= 10;
-                machine.ram[machine.I]= bcd % 10; // [1]
-                
-                break;
+    template <typename Q>
+    static void op_FX75(Machine& machine, const Config& config) {
+        // 0xFX75: Stores V0 to VX (including VX) in the RPL user flags
+        if constexpr (!Q::superchip) return op_invalid(machine, config);
+        for (uint8_t i = 0; i <= machine.current_inst.X; i++) {
+            machine.flags[i] = machine.V[i];
+        }
+    }
+
+    template <typename Q>
+    static void op_FX85(Machine& machine, const Config& config) {
+        // 0xFX85: Fills V0 to VX (including VX) from the RPL user flags
+        if constexpr (!Q::superchip) return op_invalid(machine, config);
+        for (uint8_t i = 0; i <= machine.current_inst.X; i++) {
+            machine.V[i] = machine.flags[i];
+        }
+    }
+
+    // XO-CHIP
+    // Outside an XO-CHIP machine these do what the opcodes did before, nothing (or a 0NNN call)
+
+    template <typename Q>
+    static void op_00DN(Machine& machine, const Config& config) {
+        // 0x00DN: Scroll the display up N pixels
+        if constexpr (!Q::xochip) return op_0NNN(machine, config);
+        for_each_plane(machine.display, machine.planes, [&](Framebuffer& plane) {
+            scroll_up(plane, machine.dirty_rows, machine.hires, machine.current_inst.N);
+        });
+    }
+
+    template <typename Q>
+    static void op_5XY2(Machine& machine, const Config& config) {
+        // 0x5XY2: Stores VX to VY (VX down to VY if X > Y) in memory, starting at address I. I is left alone
+        if constexpr (!Q::xochip) return op_invalid(machine, config);
+        const uint8_t x = machine.current_inst.X;
+        const uint8_t y = machine.current_inst.Y;
+        const uint8_t count = (x < y ? y - x : x - y) + 1;
+        for (uint8_t i = 0; i < count; i++) {
+            machine.ram[(machine.I + i) & machine.ram_mask] = machine.V[x < y ? x + i : x - i];
+        }
+        wrote_ram(machine, machine.I, count);
+    }
+
+    template <typename Q>
+    static void op_5XY3(Machine& machine, const Config& config) {
+        // 0x5XY3: Fills VX to VY (VX down to VY if X > Y) from memory, starting at address I. I is left alone
+        if constexpr (!Q::xochip) return op_invalid(machine, config);
+        const uint8_t x = machine.current_inst.X;
+        const uint8_t y = machine.current_inst.Y;
+        const uint8_t count = (x < y ? y - x : x - y) + 1;
+        for (uint8_t i = 0; i < count; i++) {
+            machine.V[x < y ? x + i : x - i] = machine.ram[(machine.I + i) & machine.ram_mask];
+        }
+    }
+
+    template <typename Q>
+    static void op_F000(Machine& machine, const Config& config) {
+        // 0xF000 NNNN: Sets I to NNNN, the 16 bit address in the 2 bytes after the opcode, and
+        // goes past them. The one 4 byte instruction, so it reaches all of the 64KB
+        if constexpr (!Q::xochip) return op_invalid(machine, config);
+        machine.I = (machine.ram[machine.PC & machine.ram_mask] << 8) | machine.ram[(machine.PC + 1) & machine.ram_mask];
+        machine.PC += 2;
+    }
+
+    template <typename Q>
+    static void op_FN01(Machine& machine, const Config& config) {
+        // 0xFN01: Selects the planes 00E0, DXYN and the scrolls work on, N is a bit mask (plane 0 is bit 0)
+        if constexpr (!Q::xochip) return op_invalid(machine, config);
+        machine.planes = machine.current_inst.X;
+    }
+
+    template <typename Q>
+    static void op_F002(Machine& machine, const Config& config) {
+        // 0xF002: Loads the 16 byte (128 sample) audio pattern from memory at I
+        if constexpr (!Q::xochip) return op_invalid(machine, config);
+        for (uint8_t i = 0; i < machine.pattern.size(); i++) {
+            machine.pattern[i] = machine.ram[(machine.I + i) & machine.ram_mask];
+        }
+        machine.audio_pattern = true;
+    }
+
+    template <typename Q>
+    static void op_FX3A(Machine& machine, const Config& config) {
+        // 0xFX3A: Sets the audio pattern's pitch to VX
+        if constexpr (!Q::xochip) return op_invalid(machine, config);
+        machine.pitch = machine.V[machine.current_inst.X];
+    }
+
+    static void op_invalid(Machine&, const Config&) {
+        // Wrong/unimplemented opcode
+        #ifdef DEBUG
+        std::cout << "Opcode not implemented/wrong" << std::endl;
+        #endif
+    }
+
+    using Handler = void (*)(Machine&, const Config&);
+
+    // Handler per Op, in the same order as the Op enum, for profile Q
+    template <typename Q>
+    static constexpr std::array<Handler, OP_COUNT> HANDLERS = {
+            &op_invalid,    // NONE, never executed: fetch() decodes first
+            &op_00E0,
+            &op_00EE,
+            &op_0NNN,
+            &op_1NNN,
+            &op_2NNN,
+            &op_3XNN<Q>,
+            &op_4XNN<Q>,
+            &op_5XY0<Q>,
+            &op_6XNN,
+            &op_7XNN,
+            &op_8XY0,
+            &op_8XY1<Q>,
+            &op_8XY2<Q>,
+            &op_8XY3<Q>,
+            &op_8XY4,
+            &op_8XY5,
+            &op_8XY6<Q>,
+            &op_8XY7,
+            &op_8XYE<Q>,
+            &op_9XY0<Q>,
+            &op_ANNN,
+            &op_BNNN<Q>,
+            &op_CXNN,
+            &op_DXYN<Q>,
+            &op_EX9E<Q>,
+            &op_EXA1<Q>,
+            &op_FX07,
+            &op_FX0A,
+            &op_FX15,
+            &op_FX18,
+            &op_FX1E,
+            &op_FX29,
+            &op_FX33,
+            &op_FX55<Q>,
+            &op_FX65<Q>,
+            &op_00CN<Q>,
+            &op_00FB<Q>,
+            &op_00FC<Q>,
+            &op_00FD<Q>,
+            &op_00FE<Q>,
+            &op_00FF<Q>,
+            &op_FX30<Q>,
+            &op_FX75<Q>,
+            &op_FX85<Q>,
+            &op_00DN<Q>,
+            &op_5XY2<Q>,
+            &op_5XY3<Q>,
+            &op_F000<Q>,
+            &op_FN01<Q>,
+            &op_F002<Q>,
+            &op_FX3A<Q>,
+            &op_invalid
+    };
+
+    // Get the decoded instruction at PC, into machine.current_inst, and move PC past it
+    static inline Op fetch(Machine& machine) {
+        // Look the instruction at PC up in the decode cache, and only fetch/decode it on a miss
+        // ROM code at 0x200+ almost never changes, so in the steady state this skips the RAM
+        // fetch and the operand extraction entirely
+        // PC wraps with the rest of RAM, at 4KB (or 64KB in XO-CHIP)
+        const uint16_t pc = machine.PC & machine.ram_mask;
+        const DecodedInst* decoded = machine.decode_cache.lookup(pc);
+        DecodedInst uncached;
+
+        if (decoded == nullptr || decoded->op == Op::NONE) {
+            // x86 is small indian architecture
+            // PC is in its instruction address gathering data in 2 bytes big indian
+            // We need grab the first byte, so shift it over to the left, grab it and or that in
+            // For it to read and execute as a big indian value
+            // Get next opcode from RAM
+            const uint16_t opcode = (machine.ram[pc] << 8) | machine.ram[(pc+1) & machine.ram_mask];
+
+            if (decoded == nullptr) {
+                // Address can't be cached (odd PC), decode it every time
+                uncached = decode(opcode);
+                decoded = &uncached;
+            } else {
+                decoded = &machine.decode_cache.store(pc, decode(opcode));
             }
+        }
 
-            case 0x55:
-                // 0xFX55: Stores from V0 to VX (including VX) in memory, starting at address I 
-                // The offset from I is increased by 1 for each value written, but I itself is left unmodified
-                // SCHIP does not increment I, Chip8 does increment I
-                for (uint8_t i = 0; i <= machine.current_inst.X; i++) {
-                    machine.ram[machine.I++] = machine.V[i]; // Increment I for Chip8
-                }
-                break;
+        machine.current_inst = decoded->inst;
 
-            case 0x65:
-                // 0xFX65: Fills from V0 to VX (including VX) with values from memory, starting at address I 
-                // The offset from I is increased by 1 for each value read, but I itself is left unmodified
-                for (uint8_t i = 0; i <= machine.current_inst.X; i++) {
-                    machine.V[i] = machine.ram[machine.I++];
-                }
-                break;
+        #ifdef DEBUG
+            std::cout << "PC: 0x" << std::hex << machine.PC
+                  << "  OPCODE: 0x" << machine.current_inst.opcode
+                  << "  DESC: " << disassemble(machine.current_inst.opcode, machine.quirks,
+                                               (machine.ram[(pc + 2) & machine.ram_mask] << 8) | machine.ram[(pc + 3) & machine.ram_mask])
+                  << std::dec << std::endl;
+        #endif
+
+        // To read the next opcode on the next go around, increase PC by 2 bytes
+        machine.PC +=2;  // Pre-increment PC for next opcode, instead of incrementing it later
+
+        return decoded->op;
+    }
+
+    // Emulate 1 machine instruction on profile Q
+    template <typename Q>
+    static void step(Machine& machine, const Config& config) {
+        // Waiting for the display runs nothing, see op_DXYN()
+        if constexpr (Q::display_wait) {
+            if (machine.vblank_wait) return;
+        }
+
+        // Emulate the 35 opcodes, SUPER-CHIP's 9 and XO-CHIP's 7
+        switch (fetch(machine)) {
+            case Op::OP_00E0: op_00E0(machine, config); break;
+            case Op::OP_00EE: op_00EE(machine, config); break;
+            case Op::OP_0NNN: op_0NNN(machine, config); break;
+            case Op::OP_1NNN: op_1NNN(machine, config); break;
+            case Op::OP_2NNN: op_2NNN(machine, config); break;
+            case Op::OP_3XNN: op_3XNN<Q>(machine, config); break;
+            case Op::OP_4XNN: op_4XNN<Q>(machine, config); break;
+            case Op::OP_5XY0: op_5XY0<Q>(machine, config); break;
+            case Op::OP_6XNN: op_6XNN(machine, config); break;
+            case Op::OP_7XNN: op_7XNN(machine, config); break;
+            case Op::OP_8XY0: op_8XY0(machine, config); break;
+            case Op::OP_8XY1: op_8XY1<Q>(machine, config); break;
+            case Op::OP_8XY2: op_8XY2<Q>(machine, config); break;
+            case Op::OP_8XY3: op_8XY3<Q>(machine, config); break;
+            case Op::OP_8XY4: op_8XY4(machine, config); break;
+            case Op::OP_8XY5: op_8XY5(machine, config); break;
+            case Op::OP_8XY6: op_8XY6<Q>(machine, config); break;
+            case Op::OP_8XY7: op_8XY7(machine, config); break;
+            case Op::OP_8XYE: op_8XYE<Q>(machine, config); break;
+            case Op::OP_9XY0: op_9XY0<Q>(machine, config); break;
+            case Op::OP_ANNN: op_ANNN(machine, config); break;
+            case Op::OP_BNNN: op_BNNN<Q>(machine, config); break;
+            case Op::OP_CXNN: op_CXNN(machine, config); break;
+            case Op::OP_DXYN: op_DXYN<Q>(machine, config); break;
+            case Op::OP_EX9E: op_EX9E<Q>(machine, config); break;
+            case Op::OP_EXA1: op_EXA1<Q>(machine, config); break;
+            case Op::OP_FX07: op_FX07(machine, config); break;
+            case Op::OP_FX0A: op_FX0A(machine, config); break;
+            case Op::OP_FX15: op_FX15(machine, config); break;
+            case Op::OP_FX18: op_FX18(machine, config); break;
+            case Op::OP_FX1E: op_FX1E(machine, config); break;
+            case Op::OP_FX29: op_FX29(machine, config); break;
+            case Op::OP_FX33: op_FX33(machine, config); break;
+            case Op::OP_FX55: op_FX55<Q>(machine, config); break;
+            case Op::OP_FX65: op_FX65<Q>(machine, config); break;
+            case Op::OP_00CN: op_00CN<Q>(machine, config); break;
+            case Op::OP_00FB: op_00FB<Q>(machine, config); break;
+            case Op::OP_00FC: op_00FC<Q>(machine, config); break;
+            case Op::OP_00FD: op_00FD<Q>(machine, config); break;
+            case Op::OP_00FE: op_00FE<Q>(machine, config); break;
+            case Op::OP_00FF: op_00FF<Q>(machine, config); break;
+            case Op::OP_FX30: op_FX30<Q>(machine, config); break;
+            case Op::OP_FX75: op_FX75<Q>(machine, config); break;
+            case Op::OP_FX85: op_FX85<Q>(machine, config); break;
+            case Op::OP_00DN: op_00DN<Q>(machine, config); break;
+            case Op::OP_5XY2: op_5XY2<Q>(machine, config); break;
+            case Op::OP_5XY3: op_5XY3<Q>(machine, config); break;
+            case Op::OP_F000: op_F000<Q>(machine, config); break;
+            case Op::OP_FN01: op_FN01<Q>(machine, config); break;
+            case Op::OP_F002: op_F002<Q>(machine, config); break;
+            case Op::OP_FX3A: op_FX3A<Q>(machine, config); break;
+            case Op::INVALID: op_invalid(machine, config); break;
+            default:
+                throw std::runtime_error("Unimplemented opcode");
+        }
+    }
+
+    // Run n instructions on profile Q with each dispatch strategy
+    // A display wait (VIP only) ends the run early: the rest of the n are spent waiting for the
+    // next tick, so they still count as executed and a frame takes as many cycles as on any profile
+    template <typename Q>
+    static uint64_t execute_switch(Machine& machine, const Config& config, uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            if constexpr (Q::display_wait) {
+                if (machine.vblank_wait) break;
+            }
+            step<Q>(machine, config);
+        }
+        return n;
+    }
+
+    template <typename Q>
+    static uint64_t execute_table(Machine& machine, const Config& config, uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            if constexpr (Q::display_wait) {
+                if (machine.vblank_wait) break;
             }
-            break;
-            
-        default:
-            throw std::runtime_error("Unimplemented opcode");
+            HANDLERS<Q>[static_cast<size_t>(fetch(machine))](machine, config);
         }
+        return n;
+    }
+
+    template <typename Q>
+    static uint64_t execute_threaded(Machine& machine, const Config& config, uint64_t n) {
+    #if defined(__GNUC__)
+        // Computed goto: every handler ends with its own copy of the fetch + indirect jump,
+        // so the branch predictor gets one history per op instead of one shared jump
+        static void* const LABELS[OP_COUNT] = {
+            &&L_NONE,
+            &&L_00E0,
+            &&L_00EE,
+            &&L_0NNN,
+            &&L_1NNN,
+            &&L_2NNN,
+            &&L_3XNN,
+            &&L_4XNN,
+            &&L_5XY0,
+            &&L_6XNN,
+            &&L_7XNN,
+            &&L_8XY0,
+            &&L_8XY1,
+            &&L_8XY2,
+            &&L_8XY3,
+            &&L_8XY4,
+            &&L_8XY5,
+            &&L_8XY6,
+            &&L_8XY7,
+            &&L_8XYE,
+            &&L_9XY0,
+            &&L_ANNN,
+            &&L_BNNN,
+            &&L_CXNN,
+            &&L_DXYN,
+            &&L_EX9E,
+            &&L_EXA1,
+            &&L_FX07,
+            &&L_FX0A,
+            &&L_FX15,
+            &&L_FX18,
+            &&L_FX1E,
+            &&L_FX29,
+            &&L_FX33,
+            &&L_FX55,
+            &&L_FX65,
+            &&L_00CN,
+            &&L_00FB,
+            &&L_00FC,
+            &&L_00FD,
+            &&L_00FE,
+            &&L_00FF,
+            &&L_FX30,
+            &&L_FX75,
+            &&L_FX85,
+            &&L_00DN,
+            &&L_5XY2,
+            &&L_5XY3,
+            &&L_F000,
+            &&L_FN01,
+            &&L_F002,
+            &&L_FX3A,
+            &&L_INVALID
+        };
+
+        if constexpr (Q::display_wait) {
+            if (machine.vblank_wait) return n;
+        }
+
+        uint64_t left = n;
+        #define NEXT() do { if (left-- == 0) return n; goto *LABELS[static_cast<size_t>(fetch(machine))]; } while (0)
+
+        NEXT();
+        L_NONE:
+        L_INVALID: op_invalid(machine, config); NEXT();
+        L_00E0: op_00E0(machine, config); NEXT();
+        L_00EE: op_00EE(machine, config); NEXT();
+        L_0NNN: op_0NNN(machine, config); NEXT();
+        L_1NNN: op_1NNN(machine, config); NEXT();
+        L_2NNN: op_2NNN(machine, config); NEXT();
+        L_3XNN: op_3XNN<Q>(machine, config); NEXT();
+        L_4XNN: op_4XNN<Q>(machine, config); NEXT();
+        L_5XY0: op_5XY0<Q>(machine, config); NEXT();
+        L_6XNN: op_6XNN(machine, config); NEXT();
+        L_7XNN: op_7XNN(machine, config); NEXT();
+        L_8XY0: op_8XY0(machine, config); NEXT();
+        L_8XY1: op_8XY1<Q>(machine, config); NEXT();
+        L_8XY2: op_8XY2<Q>(machine, config); NEXT();
+        L_8XY3: op_8XY3<Q>(machine, config); NEXT();
+        L_8XY4: op_8XY4(machine, config); NEXT();
+        L_8XY5: op_8XY5(machine, config); NEXT();
+        L_8XY6: op_8XY6<Q>(machine, config); NEXT();
+        L_8XY7: op_8XY7(machine, config); NEXT();
+        L_8XYE: op_8XYE<Q>(machine, config); NEXT();
+        L_9XY0: op_9XY0<Q>(machine, config); NEXT();
+        L_ANNN: op_ANNN(machine, config); NEXT();
+        L_BNNN: op_BNNN<Q>(machine, config); NEXT();
+        L_CXNN: op_CXNN(machine, config); NEXT();
+        L_DXYN: op_DXYN<Q>(machine, config); if constexpr (Q::display_wait) return n; NEXT();
+        L_EX9E: op_EX9E<Q>(machine, config); NEXT();
+        L_EXA1: op_EXA1<Q>(machine, config); NEXT();
+        L_FX07: op_FX07(machine, config); NEXT();
+        L_FX0A: op_FX0A(machine, config); NEXT();
+        L_FX15: op_FX15(machine, config); NEXT();
+        L_FX18: op_FX18(machine, config); NEXT();
+        L_FX1E: op_FX1E(machine, config); NEXT();
+        L_FX29: op_FX29(machine, config); NEXT();
+        L_FX33: op_FX33(machine, config); NEXT();
+        L_FX55: op_FX55<Q>(machine, config); NEXT();
+        L_FX65: op_FX65<Q>(machine, config); NEXT();
+        L_00CN: op_00CN<Q>(machine, config); NEXT();
+        L_00FB: op_00FB<Q>(machine, config); NEXT();
+        L_00FC: op_00FC<Q>(machine, config); NEXT();
+        L_00FD: op_00FD<Q>(machine, config); NEXT();
+        L_00FE: op_00FE<Q>(machine, config); NEXT();
+        L_00FF: op_00FF<Q>(machine, config); NEXT();
+        L_FX30: op_FX30<Q>(machine, config); NEXT();
+        L_FX75: op_FX75<Q>(machine, config); NEXT();
+        L_FX85: op_FX85<Q>(machine, config); NEXT();
+        L_00DN: op_00DN<Q>(machine, config); NEXT();
+        L_5XY2: op_5XY2<Q>(machine, config); NEXT();
+        L_5XY3: op_5XY3<Q>(machine, config); NEXT();
+        L_F000: op_F000<Q>(machine, config); NEXT();
+        L_FN01: op_FN01<Q>(machine, config); NEXT();
+        L_F002: op_F002<Q>(machine, config); NEXT();
+        L_FX3A: op_FX3A<Q>(machine, config); NEXT();
+
+        #undef NEXT
+    #else
+        // No computed goto, plain table calls
+        return execute_table<Q>(machine, config, n);
+    #endif
+    }
+
+    // The machine's profile as a QuirkProfile type, for f to instantiate the interpreter with
+    // The only place the profile is looked at while running, once per call rather than per instruction
+    template <typename F>
+    static inline decltype(auto) with_quirks(Quirks quirks, F f) {
+        switch (quirks) {
+            case Quirks::MODERN: break;
+            case Quirks::XOCHIP: return f(QuirkProfile<Quirks::XOCHIP>{});
+            case Quirks::VIP: return f(QuirkProfile<Quirks::VIP>{});
+            case Quirks::SCHIP: return f(QuirkProfile<Quirks::SCHIP>{});
+        }
+        return f(QuirkProfile<Quirks::MODERN>{});
+    }
+
+    void emulate_instruction(Machine& machine, const Config& config) {
+        with_quirks(machine.quirks, [&](auto q) { step<decltype(q)>(machine, config); });
+    }
+
+    template <>
+    uint64_t execute<Dispatch::SWITCH>(Machine& machine, const Config& config, uint64_t n) {
+        return with_quirks(machine.quirks, [&](auto q) { return execute_switch<decltype(q)>(machine, config, n); });
+    }
+
+    template <>
+    uint64_t execute<Dispatch::TABLE>(Machine& machine, const Config& config, uint64_t n) {
+        return with_quirks(machine.quirks, [&](auto q) { return execute_table<decltype(q)>(machine, config, n); });
+    }
+
+    template <>
+    uint64_t execute<Dispatch::THREADED>(Machine& machine, const Config& config, uint64_t n) {
+        return with_quirks(machine.quirks, [&](auto q) { return execute_threaded<decltype(q)>(machine, config, n); });
     }
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "Chip8/Frame.hpp"
+#include "Chip8/Core.hpp"
+#include "Chip8/Display.hpp"
+
+namespace Chip8 {
+    bool FrameHandoff::publish(Machine& machine) {
+        // Rows outside the current resolution aren't shown, changes there don't need a new frame
+        const uint64_t dirty = take_dirty_rows(machine) & active_rows(machine.hires);
+        if (dirty == 0) return false;
+
+        const uint64_t sequence = ++published;
+        history[sequence % HISTORY] = dirty;
+
+        // The back slot holds whatever frame the render thread handed back, usually two or three
+        // publishes old. Only the rows drawn in the frames after it are stale, the rest are current
+        Frame& back = buffers.back();
+        uint64_t stale = ALL_ROWS;
+        if (sequence - back.sequence <= HISTORY) {
+            stale = 0;
+            for (uint64_t s = back.sequence + 1; s <= sequence; s++) {
+                stale |= history[s % HISTORY];
+            }
+        }
+
+        // A resolution switch clears the display and dirties every row, so a stale mode is covered too.
+        // Lo-res rows only have their first word in use, which is all that's copied of them, and
+        // only XO-CHIP has more than plane 0 to copy
+        const uint32_t words = display_width(machine.hires) / 64;
+        const uint32_t planes = display_planes(machine.xochip);
+        for (uint32_t p = 0; p < planes; p++) {
+            for (uint32_t y = 0; y < display_height(machine.hires); y++) {
+                if ((stale >> y) & 1) {
+                    for (uint32_t w = 0; w < words; w++) back.planes[p][y][w] = machine.display[p][y][w];
+                    copied += words * sizeof(uint64_t);
+                }
+            }
+        }
+
+        back.dirty_rows = dirty;
+        back.hires = machine.hires;
+        back.plane_count = planes;
+        back.sequence = sequence;
+        buffers.publish();
+        return true;
+    }
+
+    const Frame& FrameHandoff::latest() {
+        buffers.acquire();
+        return buffers.front();
+    }
+}
@@ -0,0 +1,100 @@
+#include "Chip8/Idle.hpp"
+#include "Chip8/Cpu.hpp"
+#include <algorithm>
+
+namespace Chip8 {
+    namespace {
+        // Instructions run looking for a loop, enough for a wait loop several times over
+        constexpr uint64_t PROBE_LIMIT = 64;
+
+        // Misses in a row before the back off stops growing, 2^5 - 1 calls skipped between looks
+        constexpr uint32_t MAX_MISSES = 5;
+
+        // Ops a wait loop can be made of: they only read RAM, the keypad and the delay timer, and
+        // only write V, I and PC. Anything else makes the next pass differ from this one
+        constexpr bool pure(Op op) {
+            switch (op) {
+                case Op::OP_1NNN:
+                case Op::OP_3XNN: case Op::OP_4XNN: case Op::OP_5XY0: case Op::OP_9XY0:
+                case Op::OP_6XNN: case Op::OP_7XNN:
+                case Op::OP_8XY0: case Op::OP_8XY1: case Op::OP_8XY2: case Op::OP_8XY3:
+                case Op::OP_8XY4: case Op::OP_8XY5: case Op::OP_8XY6: case Op::OP_8XY7: case Op::OP_8XYE:
+                case Op::OP_ANNN: case Op::OP_BNNN:
+                case Op::OP_EX9E: case Op::OP_EXA1:
+                case Op::OP_FX07: case Op::OP_FX0A:
+                case Op::OP_FX1E: case Op::OP_FX29: case Op::OP_FX65:
+                case Op::OP_00FD: case Op::OP_FX30: case Op::OP_FX85:
+                case Op::OP_F000: case Op::OP_5XY3:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        void miss(Machine& machine) {
+            machine.idle_misses = std::min(machine.idle_misses + 1, MAX_MISSES);
+            machine.idle_backoff = (1u << machine.idle_misses) - 1;
+        }
+    }
+
+    uint64_t skip_idle(Machine& machine, const Config& config, uint64_t n) {
+        machine.idle = IdleWait::NONE;
+
+        // A VIP waiting on the display runs nothing before the tick anyway, see execute()
+        if (machine.vblank_wait) return 0;
+
+        if (machine.idle_backoff > 0) {
+            machine.idle_backoff--;
+            return 0;
+        }
+
+        // V and I the last time PC was at `start`, and what the instructions since then read
+        const uint16_t start = machine.PC;
+        std::array<uint8_t, 16> V = machine.V;
+        uint16_t I = machine.I;
+        uint64_t since = 0;
+        bool reads_keys = false;
+        bool reads_timer = false;
+
+        const uint64_t limit = std::min(n, PROBE_LIMIT);
+        for (uint64_t executed = 1; executed <= limit; executed++) {
+            emulate_instruction(machine, config);
+
+            const Op op = decode_op(machine.current_inst.opcode);
+            if (!pure(op)) {
+                miss(machine);
+                return executed;
+            }
+            reads_keys |= op == Op::OP_EX9E || op == Op::OP_EXA1 || op == Op::OP_FX0A;
+            reads_timer |= op == Op::OP_FX07;
+
+            if (machine.PC != start) continue;
+
+            if (machine.V != V || machine.I != I) {
+                // Back at the start but something moved (a counter, a pointer), look at the next pass
+                V = machine.V;
+                I = machine.I;
+                since = executed;
+                reads_keys = false;
+                reads_timer = false;
+                continue;
+            }
+
+            // A pass of `length` instructions that changed nothing, all the rest would be the same
+            const uint64_t length = executed - since;
+            const uint64_t left = n - executed;
+            const uint64_t skipped = left - left % length;
+            machine.idle_cycles += skipped;
+
+            // A loop reading a running delay timer ends at a tick. Otherwise, whether it polls the
+            // keys or not, nothing but input (or a reset) gets it out
+            machine.idle = reads_timer && !reads_keys && machine.delay_timer > 0 ? IdleWait::TIMER
+                                                                                 : IdleWait::INPUT;
+            machine.idle_misses = 0;
+            return executed + skipped;
+        }
+
+        miss(machine);
+        return limit;
+    }
+}
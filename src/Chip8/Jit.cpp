@@ -0,0 +1,490 @@
+#include "Chip8/Jit.hpp"
+#include "Chip8/Cpu.hpp"
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#if CHIP8_JIT_X64
+    #include <sys/mman.h>
+#endif
+
+namespace Chip8 {
+    namespace {
+        constexpr size_t CODE_BUFFER_SIZE = 1 << 20;   // 1MB of native code before everything is flushed
+        constexpr uint16_t MAX_BLOCK_LENGTH = 64;       // Instructions per block
+        constexpr uint32_t COMPILE_AHEAD = 8;           // Blocks compile_ahead() compiles past the one asked for
+
+        // Where the registers live inside Machine, native code addresses them as [rbx + offset]
+        constexpr int32_t V_OFF = offsetof(Machine, V);
+        constexpr int32_t I_OFF = offsetof(Machine, I);
+        constexpr int32_t PC_OFF = offsetof(Machine, PC);
+        constexpr int32_t MASK_OFF = offsetof(Machine, ram_mask);
+        constexpr int32_t DT_OFF = offsetof(Machine, delay_timer);
+        constexpr int32_t ST_OFF = offsetof(Machine, sound_timer);
+
+        // Ops a block can't contain, the interpreter runs them between blocks
+        // DXYN and FX0A are big/blocking, 2NNN can throw on stack overflow and exceptions can't unwind native code
+        bool interpreter_only(Op op) {
+            return op == Op::OP_DXYN || op == Op::OP_FX0A || op == Op::OP_2NNN;
+        }
+
+        // Called from native code for ops that aren't worth translating
+        // Runs exactly one instruction at pc through the interpreter, which also sets PC for jumps/skips
+        void interpret_one(Machine* machine, const Config* config, uint16_t pc) {
+            machine->PC = pc;
+            emulate_instruction(*machine, *config);
+        }
+
+        // x86-64 encoder, only what the translations below need
+        // rbx holds Machine*, r12 holds const Config*, al/cl/dl are scratch
+        struct Emitter {
+            std::vector<uint8_t> code;
+
+            void byte(uint8_t b) { code.push_back(b); }
+            void bytes(std::initializer_list<uint8_t> bs) { code.insert(code.end(), bs); }
+
+            void imm16(uint16_t v) { byte(v & 0xFF); byte(v >> 8); }
+            void imm32(uint32_t v) { for (int i = 0; i < 4; i++) byte((v >> (8 * i)) & 0xFF); }
+            void imm64(uint64_t v) { for (int i = 0; i < 8; i++) byte((v >> (8 * i)) & 0xFF); }
+
+            // ModRM for [rbx + disp32] with `reg` in the reg field
+            void mem(uint8_t reg, int32_t disp) {
+                byte(0x80 | (reg << 3) | 0x3);
+                imm32(static_cast<uint32_t>(disp));
+            }
+
+            // Register numbers in the reg field
+            static constexpr uint8_t AL = 0, CL = 1, DL = 2;
+
+            void mov_r8_mem(uint8_t reg, int32_t disp) { byte(0x8A); mem(reg, disp); }     // mov r8, [rbx+d]
+            void mov_mem_r8(int32_t disp, uint8_t reg) { byte(0x88); mem(reg, disp); }     // mov [rbx+d], r8
+            void mov_mem_imm8(int32_t disp, uint8_t v) { byte(0xC6); mem(0, disp); byte(v); }
+            void add_mem_imm8(int32_t disp, uint8_t v) { byte(0x80); mem(0, disp); byte(v); }
+            void cmp_mem_imm8(int32_t disp, uint8_t v) { byte(0x80); mem(7, disp); byte(v); }
+            void mov_mem_imm16(int32_t disp, uint16_t v) { bytes({0x66, 0xC7}); mem(0, disp); imm16(v); }
+            void movzx_eax_mem8(int32_t disp) { bytes({0x0F, 0xB6}); mem(0, disp); }
+
+            void prologue() {
+                bytes({0x53});                          // push rbx
+                bytes({0x41, 0x54});                    // push r12
+                bytes({0x48, 0x83, 0xEC, 0x08});        // sub rsp, 8   (keep calls 16 byte aligned)
+                bytes({0x48, 0x89, 0xFB});              // mov rbx, rdi (Machine*)
+                bytes({0x49, 0x89, 0xF4});              // mov r12, rsi (const Config*)
+            }
+
+            void epilogue() {
+                bytes({0x48, 0x83, 0xC4, 0x08});        // add rsp, 8
+                bytes({0x41, 0x5C});                    // pop r12
+                bytes({0x5B});                          // pop rbx
+                bytes({0xC3});                          // ret
+            }
+
+            // interpret_one(machine, config, pc)
+            void call_interpreter(uint16_t pc) {
+                bytes({0x48, 0x89, 0xDF});              // mov rdi, rbx
+                bytes({0x4C, 0x89, 0xE6});              // mov rsi, r12
+                byte(0xBA); imm32(pc);                  // mov edx, pc
+                bytes({0x48, 0xB8});                    // mov rax, &interpret_one
+                imm64(reinterpret_cast<uint64_t>(&interpret_one));
+                bytes({0xFF, 0xD0});                    // call rax
+            }
+
+            // PC = condition ? pc + 4 : pc + 2, flags already set. `skip_jcc` jumps over the +4 store
+            void skip(uint8_t skip_jcc, uint16_t pc) {
+                mov_mem_imm16(PC_OFF, pc + 2);          // mov doesn't touch the flags
+                byte(skip_jcc); byte(0);                // jcc rel8, patched below
+                const size_t from = code.size();
+                mov_mem_imm16(PC_OFF, pc + 4);
+                code[from - 1] = static_cast<uint8_t>(code.size() - from);
+            }
+        };
+
+        constexpr uint8_t JE = 0x74;
+        constexpr uint8_t JNE = 0x75;
+
+        // Where the guest can go once the instruction at pc, the last one a block ran or the interpreter-only
+        // one it stopped in front of, is done. Starts for compile_ahead() to compile next
+        void exits(const DecodedInst& d, uint16_t pc, std::vector<uint16_t>& out) {
+            switch (d.op) {
+                case Op::OP_1NNN:
+                    out.push_back(d.inst.NNN);
+                    break;
+                case Op::OP_2NNN:
+                    out.push_back(d.inst.NNN);
+                    out.push_back(pc + 2);
+                    break;
+                case Op::OP_3XNN: case Op::OP_4XNN: case Op::OP_5XY0: case Op::OP_9XY0:
+                case Op::OP_EX9E: case Op::OP_EXA1:
+                    out.push_back(pc + 2);
+                    out.push_back(pc + 4);
+                    break;
+                case Op::OP_00EE: case Op::OP_00FD: case Op::OP_BNNN:
+                    break;  // Only known when it runs
+                default:
+                    out.push_back(pc + 2);
+                    break;
+            }
+        }
+
+        // Translate one instruction at pc
+        // Returns true if it ends the block (it set PC itself, or may have written over code)
+        // `ram` is the owner's RAM, which lives outside the Machine. sync() flushes if it moves
+        bool translate(Emitter& e, const DecodedInst& d, uint16_t pc, const uint8_t* ram) {
+            const int32_t VX = V_OFF + d.inst.X;
+            const int32_t VY = V_OFF + d.inst.Y;
+            const int32_t VF = V_OFF + 0xF;
+            using E = Emitter;
+
+            switch (d.op) {
+                case Op::OP_1NNN:
+                    e.mov_mem_imm16(PC_OFF, d.inst.NNN);
+                    return true;
+
+                case Op::OP_3XNN:
+                    e.cmp_mem_imm8(VX, d.inst.NN);
+                    e.skip(JNE, pc);
+                    return true;
+
+                case Op::OP_4XNN:
+                    e.cmp_mem_imm8(VX, d.inst.NN);
+                    e.skip(JE, pc);
+                    return true;
+
+                case Op::OP_5XY0:
+                case Op::OP_9XY0:
+                    e.mov_r8_mem(E::AL, VX);
+                    e.byte(0x3A); e.mem(E::AL, VY);     // cmp al, [VY]
+                    e.skip(d.op == Op::OP_5XY0 ? JNE : JE, pc);
+                    return true;
+
+                case Op::OP_6XNN:
+                    e.mov_mem_imm8(VX, d.inst.NN);
+                    return false;
+
+                case Op::OP_7XNN:
+                    e.add_mem_imm8(VX, d.inst.NN);
+                    return false;
+
+                case Op::OP_8XY0:
+                    e.mov_r8_mem(E::AL, VY);
+                    e.mov_mem_r8(VX, E::AL);
+                    return false;
+
+                case Op::OP_8XY1:
+                case Op::OP_8XY2:
+                case Op::OP_8XY3: {
+                    // or/and/xor [VX], al then VF = 0, same order as the interpreter in case X is F
+                    const uint8_t alu = d.op == Op::OP_8XY1 ? 0x08 : d.op == Op::OP_8XY2 ? 0x20 : 0x30;
+                    e.mov_r8_mem(E::AL, VY);
+                    e.byte(alu); e.mem(E::AL, VX);
+                    e.mov_mem_imm8(VF, 0);
+                    return false;
+                }
+
+                case Op::OP_8XY4:
+                    e.mov_r8_mem(E::AL, VX);
+                    e.byte(0x02); e.mem(E::AL, VY);     // add al, [VY]
+                    e.bytes({0x0F, 0x92, 0xC1});        // setc cl
+                    e.mov_mem_r8(VX, E::AL);
+                    e.mov_mem_r8(VF, E::CL);
+                    return false;
+
+                case Op::OP_8XY5:
+                    e.mov_r8_mem(E::AL, VX);
+                    e.byte(0x2A); e.mem(E::AL, VY);     // sub al, [VY]
+                    e.bytes({0x0F, 0x93, 0xC1});        // setnc cl (no borrow)
+                    e.mov_mem_r8(VX, E::AL);
+                    e.mov_mem_r8(VF, E::CL);
+                    return false;
+
+                case Op::OP_8XY6:
+                    e.mov_r8_mem(E::AL, VY);
+                    e.bytes({0x88, 0xC1});              // mov cl, al
+                    e.bytes({0x80, 0xE1, 0x01});        // and cl, 1
+                    e.bytes({0xD0, 0xE8});              // shr al, 1
+                    e.mov_mem_r8(VX, E::AL);
+                    e.mov_mem_r8(VF, E::CL);
+                    return false;
+
+                case Op::OP_8XY7:
+                    // VX = VY - VX, then VF compares VY against the new VX like the interpreter does
+                    e.mov_r8_mem(E::AL, VY);
+                    e.byte(0x2A); e.mem(E::AL, VX);     // sub al, [VX]
+                    e.mov_mem_r8(VX, E::AL);
+                    e.mov_r8_mem(E::CL, VY);
+                    e.byte(0x3A); e.mem(E::CL, VX);     // cmp cl, [VX]
+                    e.bytes({0x0F, 0x93, 0xC2});        // setae dl
+                    e.mov_mem_r8(VF, E::DL);
+                    return false;
+
+                case Op::OP_8XYE:
+                    e.mov_r8_mem(E::AL, VY);
+                    e.bytes({0x88, 0xC1});              // mov cl, al
+                    e.bytes({0xC0, 0xE9, 0x07});        // shr cl, 7
+                    e.bytes({0x00, 0xC0});              // add al, al
+                    e.mov_mem_r8(VX, E::AL);
+                    e.mov_mem_r8(VF, E::CL);
+                    return false;
+
+                case Op::OP_ANNN:
+                    e.mov_mem_imm16(I_OFF, d.inst.NNN);
+                    return false;
+
+                case Op::OP_FX07:
+                    e.mov_r8_mem(E::AL, DT_OFF);
+                    e.mov_mem_r8(VX, E::AL);
+                    return false;
+
+                case Op::OP_FX15:
+                case Op::OP_FX18:
+                    e.mov_r8_mem(E::AL, VX);
+                    e.mov_mem_r8(d.op == Op::OP_FX15 ? DT_OFF : ST_OFF, E::AL);
+                    return false;
+
+                case Op::OP_FX1E:
+                    e.movzx_eax_mem8(VX);
+                    e.bytes({0x66, 0x01}); e.mem(E::AL, I_OFF);     // add [I], ax
+                    return false;
+
+                case Op::OP_FX29:
+                    e.movzx_eax_mem8(VX);
+                    e.bytes({0x8D, 0x44, 0x80, 0x50});              // lea eax, [rax + rax*4 + 0x50]
+                    e.bytes({0x66, 0x89}); e.mem(E::AL, I_OFF);     // mov [I], ax
+                    return false;
+
+                case Op::OP_FX65:
+                    // Unrolled V0..VX = ram[(I + i) & ram_mask], then I += X + 1. Masked like the
+                    // interpreter, so a read running past the end of RAM wraps to the start
+                    e.bytes({0x0F, 0xB7}); e.mem(E::AL, I_OFF);     // movzx eax, word [I]
+                    e.bytes({0x0F, 0xB7}); e.mem(E::DL, MASK_OFF);  // movzx edx, word [ram_mask]
+                    e.bytes({0x48, 0xBE});                          // mov rsi, ram
+                    e.imm64(reinterpret_cast<uint64_t>(ram));
+                    for (uint8_t i = 0; i <= d.inst.X; i++) {
+                        e.bytes({0x8D, 0x88}); e.imm32(i);          // lea ecx, [rax + i]
+                        e.bytes({0x21, 0xD1});                      // and ecx, edx
+                        e.bytes({0x8A, 0x0C, 0x0E});                // mov cl, [rsi + rcx]
+                        e.mov_mem_r8(V_OFF + i, E::CL);
+                    }
+                    e.bytes({0x66, 0x83}); e.mem(0, I_OFF); e.byte(d.inst.X + 1);   // add word [I], X + 1
+                    return false;
+
+                case Op::OP_00EE:
+                case Op::OP_00FD:
+                case Op::OP_BNNN:
+                case Op::OP_EX9E:
+                case Op::OP_EXA1:
+                    // Control flow through the interpreter, it leaves PC where the block should exit to
+                    e.call_interpreter(pc);
+                    return true;
+
+                case Op::OP_FX33:
+                case Op::OP_FX55:
+                    // RAM writes may land on this very block, so end it right after
+                    e.call_interpreter(pc);
+                    return true;
+
+                default:
+                    // 00E0, CXNN, 0NNN, SUPER-CHIP display and flag ops, invalid opcodes. No XO-CHIP
+                    // ops get here, run() leaves XO-CHIP machines to the interpreter
+                    e.call_interpreter(pc);
+                    return false;
+            }
+        }
+    }
+
+    bool Jit::supported() {
+        return CHIP8_JIT_X64;
+    }
+
+    Jit::Jit() {
+        block_at.fill(NOT_COMPILED);
+
+    #if CHIP8_JIT_X64
+        void* buffer = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED) {
+            throw std::runtime_error("Failed to map JIT code buffer\n");
+        }
+        code_buffer = static_cast<uint8_t*>(buffer);
+    #endif
+    }
+
+    Jit::~Jit() {
+    #if CHIP8_JIT_X64
+        if (code_buffer) munmap(code_buffer, CODE_BUFFER_SIZE);
+    #endif
+    }
+
+    void Jit::flush() {
+        block_at.fill(NOT_COMPILED);
+        blocks.clear();
+        code_used = 0;
+        ++flush_count;
+    }
+
+    bool Jit::make_writable() {
+    #if CHIP8_JIT_X64
+        if (broken) return false;
+        if (writable) return true;
+        if (mprotect(code_buffer, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE) != 0) {
+            broken = true;
+            return false;
+        }
+        writable = true;
+        return true;
+    #else
+        return false;
+    #endif
+    }
+
+    bool Jit::make_executable() {
+    #if CHIP8_JIT_X64
+        if (broken) return false;
+        if (!writable) return true;
+        if (mprotect(code_buffer, CODE_BUFFER_SIZE, PROT_READ | PROT_EXEC) != 0) {
+            // The blocks can never run, forget them and interpret from now on
+            broken = true;
+            flush();
+            return false;
+        }
+        writable = false;
+        return true;
+    #else
+        return false;
+    #endif
+    }
+
+    int32_t Jit::compile(Machine& machine, uint16_t start, std::vector<uint16_t>* next) {
+    #if CHIP8_JIT_X64
+        // Odd addresses have no decode cache slot, so writes over them couldn't be noticed
+        if ((start & 1) || start >= machine.ram_mask || broken) return INTERPRET;
+
+        Emitter e;
+        e.prologue();
+
+        uint16_t pc = start;
+        uint16_t length = 0;
+        bool ended = false;
+
+        DecodedInst last{};
+        bool stopped = false;   // In front of an op the interpreter runs, `last` is that op
+
+        while (!ended && length < MAX_BLOCK_LENGTH && pc < machine.ram_mask) {
+            last = decode((machine.ram[pc] << 8) | machine.ram[pc+1]);
+            if (interpreter_only(last.op)) {
+                stopped = true;
+                break;
+            }
+
+            // Mark it as code in the decode cache, so FX33/FX55 writing over it bumps the generation
+            machine.decode_cache.store(pc, last);
+
+            ended = translate(e, last, pc, machine.ram.data());
+            pc += 2;
+            length++;
+        }
+
+        if (next) {
+            if (stopped) exits(last, pc, *next);
+            else if (ended) exits(last, pc - 2, *next);
+            else next->push_back(pc);
+        }
+
+        if (length == 0) return INTERPRET;
+
+        // Fell off the end of the block, continue at the next instruction
+        if (!ended) e.mov_mem_imm16(PC_OFF, pc);
+        e.epilogue();
+
+        if (code_used + e.code.size() > CODE_BUFFER_SIZE) {
+            flush();
+        }
+
+        // W^X: the buffer is writable or executable, never both. It stays writable until the next
+        // block runs, so the blocks compiled together share one pair of mprotect calls
+        if (!make_writable()) return INTERPRET;
+        std::memcpy(code_buffer + code_used, e.code.data(), e.code.size());
+
+        Block block;
+        block.code = reinterpret_cast<void (*)(Machine*, const Config*)>(code_buffer + code_used);
+        block.length = length;
+        blocks.push_back(block);
+
+        code_used += e.code.size();
+        ++compiled;
+        return static_cast<int32_t>(blocks.size() - 1);
+    #else
+        (void)machine;
+        (void)start;
+        (void)next;
+        return INTERPRET;
+    #endif
+    }
+
+    int32_t Jit::compile_ahead(Machine& machine, uint16_t start) {
+        // The block asked for, then the ones it can go on to, while the buffer is writable anyway
+        std::vector<uint16_t> next;
+        block_at[start] = compile(machine, start, &next);
+
+        uint32_t ahead = 0;
+        for (size_t i = 0; i < next.size() && ahead < COMPILE_AHEAD; i++) {
+            const uint16_t at = next[i];
+            if (at >= block_at.size() || block_at[at] != NOT_COMPILED) continue;
+            block_at[at] = compile(machine, at, &next);
+            ahead++;
+        }
+
+        // A flush on a full buffer may have dropped `start` again, run() then just interprets it
+        return block_at[start];
+    }
+
+    void Jit::sync(const Machine& machine) {
+        // Different machine, new ROM or self-modifying code: translations are stale
+        // Blocks also have the address of the machine's RAM built in
+        if (owner != &machine || generation != machine.decode_cache.generation || ram != machine.ram.data()) {
+            flush();
+            owner = &machine;
+            generation = machine.decode_cache.generation;
+            ram = machine.ram.data();
+        }
+    }
+
+    uint64_t Jit::precompile(Machine& machine, const std::vector<uint16_t>& starts) {
+        if (!supported() || broken || machine.quirks != Quirks::MODERN) return 0;
+
+        // compile() marks what it translates in the decode cache without a new generation, so these
+        // are still current when run() next checks
+        sync(machine);
+        const uint64_t before = compiled;
+        for (const uint16_t start : starts) {
+            if (start < block_at.size() && block_at[start] == NOT_COMPILED) block_at[start] = compile(machine, start);
+        }
+        if (!make_executable()) return 0;
+        return compiled - before;
+    }
+
+    uint64_t Jit::run(Machine& machine, const Config& config, uint64_t n) {
+        // Translations have the MODERN profile's quirks built in. Other profiles, and XO-CHIP's 64KB
+        // of code, long I and plane ops, run on the interpreter
+        if (!supported() || broken || machine.quirks != Quirks::MODERN) return execute<DEFAULT_DISPATCH>(machine, config, n);
+
+        uint64_t done = 0;
+        while (done < n) {
+            sync(machine);
+
+            const uint16_t pc = machine.PC;
+            int32_t index = (pc < block_at.size()) ? block_at[pc] : INTERPRET;
+
+            if (index == NOT_COMPILED) index = compile_ahead(machine, pc);
+
+            // Only run a whole block if it fits in what's left, so exactly n instructions run
+            if (index >= 0 && blocks[index].length <= n - done && make_executable()) {
+                blocks[index].code(&machine, &config);
+                done += blocks[index].length;
+            } else {
+                done += execute<DEFAULT_DISPATCH>(machine, config, 1);
+            }
+        }
+
+        return n;
+    }
+}
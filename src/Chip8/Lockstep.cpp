@@ -0,0 +1,579 @@
+#include "Chip8/Lockstep.hpp"
+#include "Chip8/Display.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// Every op below is a loop over all lanes that only changes the lanes selected by `run`
+// (run[l] is 0xFF or 0). The register ops are written so GCC/Clang turn them into plain vector
+// code: a compare, an op and a blend per 16/32 lanes. Ops that index memory per lane (DXYN,
+// the stack, and FX33/55/65 when the lanes' I differ) loop over the selected lanes one at a time.
+// The results are the interpreter's, op for op; see the matching op_XXXX in Cpu.cpp
+namespace Chip8 {
+    namespace {
+        using Machines = LockstepMachines;
+        constexpr size_t LANES = Machines::LANES;
+        using Mask = Machines::Lanes<uint8_t>;
+
+        // taken where run is set, kept elsewhere. Written as and/or instead of ?: so the compiler
+        // always sees a plain blend it can vectorize
+        template <typename T>
+        inline T pick(uint8_t run, T taken, T kept) {
+            const T mask = static_cast<T>(0) - static_cast<T>(run & 1);
+            return static_cast<T>((taken & mask) | (kept & ~mask));
+        }
+
+        // Per lane RAM is 4096 bytes exactly, so every address wraps
+        constexpr uint16_t RAM_MASK = 0xFFF;
+
+        // Some lanes wrote RAM at addr. Flag it if the lanes now disagree there, and drop the
+        // shared decode of any instruction covering it
+        void ram_written(Machines& m, uint16_t addr) {
+            addr &= RAM_MASK;
+
+            uint8_t differs = 0;
+            for (size_t l = 1; l < m.lanes; l++) {
+                differs |= m.ram[addr][l] ^ m.ram[addr][0];
+            }
+            m.ram_differs[addr] = differs != 0;
+            m.decode_cache.invalidate(addr, 1);
+        }
+
+        void op_00E0(Machines& m, const Mask& run) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (!run[l]) continue;
+                clear_display(m.display[l], m.dirty_rows[l]);
+            }
+        }
+
+        // 00CN, 00FB and 00FC per lane, each lane scrolls by its own resolution
+        template <typename Scroll>
+        void scroll(Machines& m, const Mask& run, Scroll scroll) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (!run[l]) continue;
+                scroll(m.display[l], m.dirty_rows[l], m.hires[l] != 0);
+            }
+        }
+
+        // 00FE/00FF: switch resolution and clear, like the interpreter
+        void set_hires(Machines& m, const Mask& run, bool hires) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (!run[l]) continue;
+                m.hires[l] = hires;
+                clear_display(m.display[l], m.dirty_rows[l]);
+            }
+        }
+
+        void op_00EE(Machines& m, const Mask& run) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (!run[l]) continue;
+                m.PC[l] = m.stack[--m.stack_ptr[l] & 0xF][l];
+            }
+        }
+
+        void op_2NNN(Machines& m, const Mask& run, const Instruction& inst) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (!run[l]) continue;
+
+                // The interpreter throws "Stack overflow" here, a lane just stops
+                if (m.stack_ptr[l] >= m.stack.size()) {
+                    m.faulted[l] = 0xFF;
+                    continue;
+                }
+
+                m.stack[m.stack_ptr[l]++][l] = m.PC[l];
+                m.PC[l] = inst.NNN;
+            }
+        }
+
+        // Skip ops: PC += 2 on the selected lanes where the condition holds
+        template <typename Condition>
+        void skip_if(Machines& m, const Mask& run, Condition condition) {
+            for (size_t l = 0; l < LANES; l++) {
+                m.PC[l] += ((run[l] != 0) & static_cast<bool>(condition(l))) ? 2 : 0;
+            }
+        }
+
+        // VX = f(lane) on the selected lanes
+        template <typename F>
+        void set_vx(Machines& m, const Mask& run, uint8_t X, F f) {
+            for (size_t l = 0; l < LANES; l++) {
+                const uint8_t value = f(l);
+                m.V[X][l] = pick<uint8_t>(run[l], value, m.V[X][l]);
+            }
+        }
+
+        // 8XY1/2/3 and the carry ops: VX = f(lane), then VF = flag(lane), both from the registers
+        // before the op. VF goes last, so it wins when X is F like in the interpreter
+        // (separate loops: V[X] and V[0xF] can be the same row)
+        template <typename F, typename Flag>
+        void set_vx_vf(Machines& m, const Mask& run, uint8_t X, F f, Flag flag) {
+            Machines::Lanes<uint8_t> result;
+            Machines::Lanes<uint8_t> carry;
+            for (size_t l = 0; l < LANES; l++) {
+                result[l] = f(l);
+                carry[l] = flag(l);
+            }
+            for (size_t l = 0; l < LANES; l++) m.V[X][l] = pick<uint8_t>(run[l], result[l], m.V[X][l]);
+            for (size_t l = 0; l < LANES; l++) m.V[0xF][l] = pick<uint8_t>(run[l], carry[l], m.V[0xF][l]);
+        }
+
+        void op_DXYN(Machines& m, const Mask& run, const Instruction& inst) {
+            for (size_t l = 0; l < LANES; l++) {
+                if (!run[l]) continue;
+
+                const bool collision = draw_sprite(m.display[l], m.dirty_rows[l], m.hires[l] != 0,
+                                                   m.V[inst.X][l], m.V[inst.Y][l], inst.N,
+                                                   [&](uint32_t i) { return m.ram[(m.I[l] + i) & RAM_MASK][l]; });
+                m.V[0xF][l] = collision;
+            }
+        }
+
+        // True if every selected lane has the same I, the usual case. Then memory ops touch the
+        // same addresses in every lane and move whole rows of ram[] at once
+        bool same_I(const Machines& m, const Mask& run, size_t first) {
+            uint32_t differs = 0;
+            for (size_t l = 0; l < LANES; l++) differs |= run[l] & (m.I[l] != m.I[first]);
+            return differs == 0;
+        }
+
+        void op_FX33(Machines& m, const Mask& run, const Instruction& inst, size_t first) {
+            if (same_I(m, run, first)) {
+                const uint16_t I = m.I[first];
+                auto& hundreds = m.ram[I & RAM_MASK];
+                auto& tens = m.ram[(I + 1) & RAM_MASK];
+                auto& ones = m.ram[(I + 2) & RAM_MASK];
+                for (size_t l = 0; l < LANES; l++) {
+                    const uint8_t bcd = m.V[inst.X][l];
+                    hundreds[l] = pick<uint8_t>(run[l], (bcd / 100) % 10, hundreds[l]);
+                    tens[l] = pick<uint8_t>(run[l], (bcd / 10) % 10, tens[l]);
+                    ones[l] = pick<uint8_t>(run[l], bcd % 10, ones[l]);
+                }
+                for (uint16_t i = 0; i < 3; i++) ram_written(m, I + i);
+                return;
+            }
+
+            for (size_t l = 0; l < LANES; l++) {
+                if (!run[l]) continue;
+                const uint8_t bcd = m.V[inst.X][l];
+                m.ram[(m.I[l] + 0) & RAM_MASK][l] = (bcd / 100) % 10;
+                m.ram[(m.I[l] + 1) & RAM_MASK][l] = (bcd / 10) % 10;
+                m.ram[(m.I[l] + 2) & RAM_MASK][l] = bcd % 10;
+                for (uint16_t i = 0; i < 3; i++) ram_written(m, m.I[l] + i);
+            }
+        }
+
+        void op_FX55(Machines& m, const Mask& run, const Instruction& inst, size_t first) {
+            if (same_I(m, run, first)) {
+                const uint16_t I = m.I[first];
+                for (uint8_t i = 0; i <= inst.X; i++) {
+                    auto& row = m.ram[(I + i) & RAM_MASK];
+                    for (size_t l = 0; l < LANES; l++) row[l] = pick<uint8_t>(run[l], m.V[i][l], row[l]);
+                    ram_written(m, I + i);
+                }
+            } else {
+                for (size_t l = 0; l < LANES; l++) {
+                    if (!run[l]) continue;
+                    for (uint8_t i = 0; i <= inst.X; i++) {
+                        m.ram[(m.I[l] + i) & RAM_MASK][l] = m.V[i][l];
+                        ram_written(m, m.I[l] + i);
+                    }
+                }
+            }
+
+            // Chip8 increments I
+            for (size_t l = 0; l < LANES; l++) {
+                m.I[l] += pick<uint16_t>(run[l], inst.X + 1, 0);
+            }
+        }
+
+        void op_FX65(Machines& m, const Mask& run, const Instruction& inst, size_t first) {
+            if (same_I(m, run, first)) {
+                const uint16_t I = m.I[first];
+                for (uint8_t i = 0; i <= inst.X; i++) {
+                    const auto& row = m.ram[(I + i) & RAM_MASK];
+                    for (size_t l = 0; l < LANES; l++) m.V[i][l] = pick<uint8_t>(run[l], row[l], m.V[i][l]);
+                }
+            } else {
+                for (size_t l = 0; l < LANES; l++) {
+                    if (!run[l]) continue;
+                    for (uint8_t i = 0; i <= inst.X; i++) {
+                        m.V[i][l] = m.ram[(m.I[l] + i) & RAM_MASK][l];
+                    }
+                }
+            }
+
+            for (size_t l = 0; l < LANES; l++) {
+                m.I[l] += pick<uint16_t>(run[l], inst.X + 1, 0);
+            }
+        }
+
+        // Run one decoded instruction on the selected lanes. Their PCs already point past it
+        // `first` is the lowest selected lane
+        void execute_lanes(Machines& m, const Mask& run, size_t first, const DecodedInst& decoded, const Config&) {
+            const Instruction& inst = decoded.inst;
+            const uint8_t X = inst.X;
+            const uint8_t Y = inst.Y;
+            auto& V = m.V;
+
+            switch (decoded.op) {
+                case Op::OP_00E0: op_00E0(m, run); break;
+                case Op::OP_00EE: op_00EE(m, run); break;
+                case Op::OP_0NNN: break;    // The interpreter only prints that it's not implemented
+
+                case Op::OP_1NNN:
+                    for (size_t l = 0; l < LANES; l++) m.PC[l] = pick<uint16_t>(run[l], inst.NNN, m.PC[l]);
+                    break;
+
+                case Op::OP_2NNN: op_2NNN(m, run, inst); break;
+
+                case Op::OP_3XNN: skip_if(m, run, [&](size_t l) { return V[X][l] == inst.NN; }); break;
+                case Op::OP_4XNN: skip_if(m, run, [&](size_t l) { return V[X][l] != inst.NN; }); break;
+                case Op::OP_5XY0: skip_if(m, run, [&](size_t l) { return V[X][l] == V[Y][l]; }); break;
+                case Op::OP_9XY0: skip_if(m, run, [&](size_t l) { return V[X][l] != V[Y][l]; }); break;
+
+                case Op::OP_6XNN: set_vx(m, run, X, [&](size_t) { return inst.NN; }); break;
+                case Op::OP_7XNN: set_vx(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[X][l] + inst.NN); }); break;
+                case Op::OP_8XY0: set_vx(m, run, X, [&](size_t l) { return V[Y][l]; }); break;
+
+                // In original behaviour, in 8XY1/2/3, it reset the carry flag
+                case Op::OP_8XY1:
+                    set_vx_vf(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[X][l] | V[Y][l]); },
+                              [](size_t) { return 0; });
+                    break;
+                case Op::OP_8XY2:
+                    set_vx_vf(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[X][l] & V[Y][l]); },
+                              [](size_t) { return 0; });
+                    break;
+                case Op::OP_8XY3:
+                    set_vx_vf(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[X][l] ^ V[Y][l]); },
+                              [](size_t) { return 0; });
+                    break;
+
+                case Op::OP_8XY4:
+                    set_vx_vf(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[X][l] + V[Y][l]); },
+                              [&](size_t l) { return V[X][l] + V[Y][l] > 0xFF; });
+                    break;
+                case Op::OP_8XY5:
+                    set_vx_vf(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[X][l] - V[Y][l]); },
+                              [&](size_t l) { return V[Y][l] <= V[X][l]; });
+                    break;
+                case Op::OP_8XY6:
+                    set_vx_vf(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[Y][l] >> 1); },
+                              [&](size_t l) { return V[Y][l] & 1; });
+                    break;
+                case Op::OP_8XYE:
+                    set_vx_vf(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[Y][l] << 1); },
+                              [&](size_t l) { return V[Y][l] >> 7; });
+                    break;
+
+                case Op::OP_8XY7:
+                    // The interpreter compares after writing VX, against the new VX (and VY, if Y is X)
+                    set_vx(m, run, X, [&](size_t l) { return static_cast<uint8_t>(V[Y][l] - V[X][l]); });
+                    for (size_t l = 0; l < LANES; l++) {
+                        V[0xF][l] = pick<uint8_t>(run[l], V[Y][l] >= V[X][l], V[0xF][l]);
+                    }
+                    break;
+
+                case Op::OP_ANNN:
+                    for (size_t l = 0; l < LANES; l++) m.I[l] = pick<uint16_t>(run[l], inst.NNN, m.I[l]);
+                    break;
+
+                case Op::OP_BNNN:
+                    for (size_t l = 0; l < LANES; l++) m.PC[l] = pick<uint16_t>(run[l], inst.NNN + V[0][l], m.PC[l]);
+                    break;
+
+                case Op::OP_CXNN:
+                    // xorshift32 step per lane, top byte AND NN
+                    for (size_t l = 0; l < LANES; l++) {
+                        uint32_t x = m.rng[l];
+                        x ^= x << 13;
+                        x ^= x >> 17;
+                        x ^= x << 5;
+                        m.rng[l] = pick<uint32_t>(run[l], x, m.rng[l]);
+                        V[X][l] = pick<uint8_t>(run[l], static_cast<uint8_t>(x >> 24) & inst.NN, V[X][l]);
+                    }
+                    break;
+
+                case Op::OP_DXYN: op_DXYN(m, run, inst); break;
+
+                case Op::OP_EX9E: skip_if(m, run, [&](size_t l) { return (m.keypad[l] >> (V[X][l] & 0xF)) & 1; }); break;
+                case Op::OP_EXA1: skip_if(m, run, [&](size_t l) { return !((m.keypad[l] >> (V[X][l] & 0xF)) & 1); }); break;
+
+                case Op::OP_FX07: set_vx(m, run, X, [&](size_t l) { return m.delay_timer[l]; }); break;
+
+                case Op::OP_FX0A:
+                    // Same as the interpreter's op_FX0A: it stops waiting once key 0 is down, without writing VX
+                    for (size_t l = 0; l < LANES; l++) {
+                        m.PC[l] -= (run[l] && !(m.keypad[l] & 1)) ? 2 : 0;
+                    }
+                    break;
+
+                case Op::OP_FX15:
+                    for (size_t l = 0; l < LANES; l++) m.delay_timer[l] = pick<uint8_t>(run[l], V[X][l], m.delay_timer[l]);
+                    break;
+                case Op::OP_FX18:
+                    for (size_t l = 0; l < LANES; l++) m.sound_timer[l] = pick<uint8_t>(run[l], V[X][l], m.sound_timer[l]);
+                    break;
+                case Op::OP_FX1E:
+                    for (size_t l = 0; l < LANES; l++) m.I[l] += pick<uint16_t>(run[l], V[X][l], 0);
+                    break;
+                case Op::OP_FX29:
+                    for (size_t l = 0; l < LANES; l++) m.I[l] = pick<uint16_t>(run[l], 0x50 + V[X][l] * 5, m.I[l]);
+                    break;
+
+                case Op::OP_FX33: op_FX33(m, run, inst, first); break;
+                case Op::OP_FX55: op_FX55(m, run, inst, first); break;
+                case Op::OP_FX65: op_FX65(m, run, inst, first); break;
+
+                case Op::OP_00CN:
+                    scroll(m, run, [&](Framebuffer& display, uint64_t& dirty, bool hires) {
+                        scroll_down(display, dirty, hires, inst.N);
+                    });
+                    break;
+                case Op::OP_00FB: scroll(m, run, scroll_right); break;
+                case Op::OP_00FC: scroll(m, run, scroll_left); break;
+
+                case Op::OP_00FD:
+                    // Exit: the lane stays on this instruction for good
+                    for (size_t l = 0; l < LANES; l++) m.PC[l] -= pick<uint16_t>(run[l], 2, 0);
+                    break;
+
+                case Op::OP_00FE: set_hires(m, run, false); break;
+                case Op::OP_00FF: set_hires(m, run, true); break;
+
+                case Op::OP_FX30:
+                    for (size_t l = 0; l < LANES; l++) m.I[l] = pick<uint16_t>(run[l], 0xA0 + (V[X][l] & 0xF) * 10, m.I[l]);
+                    break;
+
+                case Op::OP_FX75:
+                    for (uint8_t i = 0; i <= X; i++) {
+                        for (size_t l = 0; l < LANES; l++) m.flags[i][l] = pick<uint8_t>(run[l], V[i][l], m.flags[i][l]);
+                    }
+                    break;
+                case Op::OP_FX85:
+                    for (uint8_t i = 0; i <= X; i++) {
+                        for (size_t l = 0; l < LANES; l++) V[i][l] = pick<uint8_t>(run[l], m.flags[i][l], V[i][l]);
+                    }
+                    break;
+
+                // Lanes are CHIP8 machines: 00DN is a 0NNN and the other XO-CHIP ops are invalid
+                case Op::OP_00DN:
+                case Op::OP_5XY2: case Op::OP_5XY3: case Op::OP_F000:
+                case Op::OP_FN01: case Op::OP_F002: case Op::OP_FX3A:
+                case Op::NONE:
+                case Op::INVALID:
+                    break;
+            }
+        }
+
+        // Ops after which lanes that ran together can be at different PCs (or have faulted)
+        bool may_diverge(Op op) {
+            switch (op) {
+                case Op::OP_00EE: case Op::OP_2NNN: case Op::OP_BNNN:
+                case Op::OP_3XNN: case Op::OP_4XNN: case Op::OP_5XY0: case Op::OP_9XY0:
+                case Op::OP_EX9E: case Op::OP_EXA1: case Op::OP_FX0A:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        uint64_t run_lanes(Machines& m, const Config& config, uint32_t n) {
+            // Instructions each lane still has to run. Unused and faulted lanes have none
+            Machines::Lanes<uint32_t> left{};
+            for (size_t l = 0; l < m.lanes; l++) left[l] = m.faulted[l] ? 0 : n;
+
+            Mask run{};
+
+            while (true) {
+                // Form a group: the lanes at the lowest PC among the lanes with work left. While the
+                // lanes agree that's all of them; once they diverged, lowest first lets the ones
+                // behind catch up with the others at the join point
+                uint32_t target = 0x10000;
+                for (size_t l = 0; l < LANES; l++) {
+                    target = std::min<uint32_t>(target, left[l] ? m.PC[l] : 0x10000);
+                }
+                if (target == 0x10000) break;
+
+                uint32_t budget = UINT32_MAX;   // The group runs together at most this long
+                uint32_t waiting = 0;           // Lanes with work left that aren't in the group
+                for (size_t l = 0; l < LANES; l++) {
+                    run[l] = (left[l] && m.PC[l] == target) ? 0xFF : 0;
+                    budget = std::min(budget, pick<uint32_t>(run[l], left[l], UINT32_MAX));
+                    waiting |= left[l] && !run[l];
+                }
+
+                const size_t first = std::find(run.begin(), run.end(), 0xFF) - run.begin();
+
+                // Run the group until it splits, reaches a lane that is waiting, or one lane is done
+                uint32_t done = 0;
+                while (done < budget) {
+                    const uint16_t pc = m.PC[first];
+                    DecodedInst decoded;
+
+                    if (!(m.ram_differs[pc & RAM_MASK] | m.ram_differs[(pc + 1) & RAM_MASK])) {
+                        // Same code in every lane, fetch and decode once (through the shared cache)
+                        DecodedInst* cached = m.decode_cache.lookup(pc & RAM_MASK);
+                        if (cached != nullptr && cached->op != Op::NONE) {
+                            decoded = *cached;
+                        } else {
+                            decoded = decode((m.ram[pc & RAM_MASK][0] << 8) | m.ram[(pc + 1) & RAM_MASK][0]);
+                            if (cached != nullptr) m.decode_cache.store(pc & RAM_MASK, decoded);
+                        }
+                    } else {
+                        // Lanes wrote different code here. Only the lanes with the first lane's opcode
+                        // run now, the others get their own group later. The group can only shrink
+                        // before its first step, or the step counts would be off
+                        if (done > 0) break;
+
+                        const auto opcode_of = [&](size_t l) {
+                            return static_cast<uint16_t>((m.ram[pc & RAM_MASK][l] << 8) | m.ram[(pc + 1) & RAM_MASK][l]);
+                        };
+
+                        const uint16_t opcode = opcode_of(first);
+                        for (size_t l = first + 1; l < LANES; l++) {
+                            if (run[l] && opcode_of(l) != opcode) {
+                                run[l] = 0;
+                                waiting = 1;
+                            }
+                        }
+                        decoded = decode(opcode);
+                    }
+
+                    for (size_t l = 0; l < LANES; l++) m.PC[l] += pick<uint16_t>(run[l], 2, 0);
+
+                    execute_lanes(m, run, first, decoded, config);
+                    done++;
+
+                    if (may_diverge(decoded.op)) {
+                        uint32_t split = 0;
+                        for (size_t l = 0; l < LANES; l++) {
+                            split |= run[l] & ((m.PC[l] != m.PC[first]) | m.faulted[l]);
+                        }
+                        if (split) break;
+                    }
+
+                    if (waiting) {
+                        uint32_t meets = 0;
+                        for (size_t l = 0; l < LANES; l++) {
+                            meets |= !run[l] && left[l] && m.PC[l] == m.PC[first];
+                        }
+                        if (meets) break;
+                    }
+                }
+
+                uint32_t active = 0;
+                for (size_t l = 0; l < LANES; l++) {
+                    active += run[l] & 1;
+                    left[l] -= pick<uint32_t>(run[l], done, 0);
+                    left[l] = m.faulted[l] ? 0 : left[l];
+                }
+
+                m.steps += done;
+                m.lane_instructions += static_cast<uint64_t>(done) * active;
+            }
+
+            return n;
+        }
+    }
+
+    std::unique_ptr<LockstepMachines> make_lockstep() {
+        return std::make_unique<LockstepMachines>();
+    }
+
+    void load_lockstep(LockstepMachines& machines, const Machine& prototype, size_t lanes) {
+        if (prototype.quirks != Quirks::MODERN) {
+            throw std::runtime_error("Lockstep runs the MODERN quirk profile only, not " +
+                                     std::string(quirks_name(prototype.quirks)));
+        }
+
+        machines = LockstepMachines{};
+        machines.lanes = std::clamp<size_t>(lanes, 1, LANES);
+
+        uint16_t keys = 0;
+        for (size_t k = 0; k < prototype.keypad.size(); k++) keys |= prototype.keypad[k] << k;
+
+        for (size_t l = 0; l < machines.lanes; l++) {
+            for (size_t r = 0; r < 16; r++) {
+                machines.V[r][l] = prototype.V[r];
+                machines.flags[r][l] = prototype.flags[r];
+                machines.stack[r][l] = prototype.stack[r];
+            }
+            machines.I[l] = prototype.I;
+            machines.PC[l] = prototype.PC;
+            machines.delay_timer[l] = prototype.delay_timer;
+            machines.sound_timer[l] = prototype.sound_timer;
+            machines.stack_ptr[l] = prototype.stack_ptr;
+            machines.keypad[l] = keys;
+            machines.rng[l] = prototype.rng;
+            machines.hires[l] = prototype.hires;
+            machines.display[l] = prototype.display[0];
+            machines.dirty_rows[l] = prototype.dirty_rows;
+            for (size_t a = 0; a < machines.ram.size(); a++) machines.ram[a][l] = prototype.ram[a];
+        }
+
+        machines.cycles = prototype.cycles;
+        machines.frames = prototype.frames;
+    }
+
+    void store_lane(const LockstepMachines& machines, size_t lane, Machine& machine) {
+        // Lanes are always CHIP8 machines on the MODERN profile, see load_lockstep()
+        machine.quirks = Quirks::MODERN;
+        machine.xochip = false;
+        machine.vblank_wait = false;
+        machine.resize_memory();
+        machine.planes = 1;
+        for (size_t r = 0; r < 16; r++) {
+            machine.V[r] = machines.V[r][lane];
+            machine.flags[r] = machines.flags[r][lane];
+            machine.stack[r] = machines.stack[r][lane];
+        }
+        machine.I = machines.I[lane];
+        machine.PC = machines.PC[lane];
+        machine.delay_timer = machines.delay_timer[lane];
+        machine.sound_timer = machines.sound_timer[lane];
+        machine.stack_ptr = machines.stack_ptr[lane];
+        for (size_t k = 0; k < machine.keypad.size(); k++) machine.keypad[k] = (machines.keypad[lane] >> k) & 1;
+        machine.rng = machines.rng[lane];
+        machine.hires = machines.hires[lane] != 0;
+        machine.display = Display{};
+        machine.display[0] = machines.display[lane];
+        machine.dirty_rows = machines.dirty_rows[lane];
+        for (size_t a = 0; a < machines.ram.size(); a++) machine.ram[a] = machines.ram[a][lane];
+        machine.decode_cache.clear();   // RAM was replaced wholesale
+        machine.cycles = machines.cycles;
+        machine.frames = machines.frames;
+    }
+
+    void set_lane_key(LockstepMachines& machines, size_t lane, uint8_t key, bool down) {
+        const uint16_t bit = 1u << (key & 0xF);
+        machines.keypad[lane] = down ? (machines.keypad[lane] | bit) : (machines.keypad[lane] & ~bit);
+    }
+
+    void seed_lane(LockstepMachines& machines, size_t lane, uint32_t seed) {
+        machines.rng[lane] = seed ? seed : DEFAULT_RNG_SEED;
+    }
+
+    uint64_t run_lockstep(LockstepMachines& machines, const Config& config, uint64_t n) {
+        // Lane counters are 32 bit
+        for (uint64_t done = 0; done < n;) {
+            const uint32_t chunk = static_cast<uint32_t>(std::min<uint64_t>(n - done, UINT32_MAX));
+            done += run_lanes(machines, config, chunk);
+        }
+
+        machines.cycles += n;
+        return n;
+    }
+
+    void run_frame_lockstep(LockstepMachines& machines, const Config& config) {
+        // Same spread as frame_cycles()
+        const uint64_t hz = config.ints_per_second;
+        run_lockstep(machines, config, ((machines.frames + 1) * hz) / 60 - (machines.frames * hz) / 60);
+
+        for (size_t l = 0; l < LANES; l++) {
+            machines.delay_timer[l] -= machines.delay_timer[l] > 0;
+            machines.sound_timer[l] -= machines.sound_timer[l] > 0;
+        }
+        ++machines.frames;
+    }
+}
@@ -0,0 +1,168 @@
+#include "Chip8/Movie.hpp"
+#include "Chip8/BinaryFile.hpp"
+#include "Chip8/Core.hpp"
+#include <stdexcept>
+
+namespace Chip8 {
+    namespace {
+        constexpr char MAGIC[4] = {'C', '8', 'M', 'V'};
+        constexpr uint16_t VERSION = 2;     // 2: quirk profile
+        constexpr size_t HEADER_SIZE = 4 + 2 + 1 + 4 + 8 + 8 + 8 + 4 + 8;
+
+        // Low 6 bits of an event: tick, down, key
+        constexpr uint64_t TICK_BIT = 1 << 5;
+        constexpr uint64_t DOWN_BIT = 1 << 4;
+        constexpr unsigned TYPE_BITS = 6;
+
+        // 7 bits per byte, high bit set on all but the last
+        void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        uint64_t get_varint(Reader& r) {
+            uint64_t value = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                const uint8_t byte = r.u8();
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            throw std::runtime_error("Movie has a malformed event");
+        }
+
+        void record(Movie& movie, const Machine& machine, MovieEvent::Type type, uint8_t key) {
+            movie.events.push_back(MovieEvent{machine.cycles, type, key});
+        }
+    }
+
+    void start_movie(Movie& movie, const Machine& machine) {
+        movie = Movie{};
+        movie.seed = machine.rng;
+        movie.quirks = machine.quirks;
+        movie.ram_hash = hash_bytes(machine.ram.data(), machine.ram_mask + 1u);
+    }
+
+    void record_tick(Movie& movie, const Machine& machine) {
+        record(movie, machine, MovieEvent::Type::TICK, 0);
+    }
+
+    void record_key(Movie& movie, const Machine& machine, uint8_t key, bool down) {
+        record(movie, machine, down ? MovieEvent::Type::KEY_DOWN : MovieEvent::Type::KEY_UP, key & 0xF);
+    }
+
+    void end_movie(Movie& movie, const Machine& machine) {
+        movie.cycles = machine.cycles;
+        movie.framebuffer_hash = framebuffer_hash(machine);
+    }
+
+    bool replay_movie(Machine& machine, const Config& config, const Movie& movie, Jit* jit) {
+        if (hash_bytes(machine.ram.data(), machine.ram_mask + 1u) != movie.ram_hash) {
+            throw std::runtime_error("Movie was recorded with a different ROM");
+        }
+        // The same inputs on other quirks are a different run, it would only ever "differ"
+        if (machine.quirks != movie.quirks) {
+            throw std::runtime_error("Movie was recorded with the " + std::string(quirks_name(movie.quirks)) +
+                                     " quirk profile, the ROM is loaded with " + std::string(quirks_name(machine.quirks)));
+        }
+        seed_random(machine, movie.seed);
+
+        // Run straight up to each event, so the instructions go by in as few run_cycles() calls as the
+        // recording allows, a frame's worth at a time between timer ticks
+        for (const MovieEvent& event : movie.events) {
+            run_cycles(machine, config, event.cycle - machine.cycles, jit);
+
+            switch (event.type) {
+                case MovieEvent::Type::TICK:
+                    tick_timers(machine);
+                    break;
+                case MovieEvent::Type::KEY_DOWN:
+                    machine.keypad[event.key & 0xF] = true;
+                    break;
+                case MovieEvent::Type::KEY_UP:
+                    machine.keypad[event.key & 0xF] = false;
+                    break;
+            }
+        }
+        run_cycles(machine, config, movie.cycles - machine.cycles, jit);
+
+        return framebuffer_hash(machine) == movie.framebuffer_hash;
+    }
+
+    void save_movie(const Movie& movie, const std::string& path) {
+        std::vector<uint8_t> events;
+        events.reserve(movie.events.size() * 2);
+
+        uint64_t cycle = 0;
+        for (const MovieEvent& event : movie.events) {
+            uint64_t bits = event.key & 0xF;
+            if (event.type == MovieEvent::Type::TICK) bits = TICK_BIT;
+            else if (event.type == MovieEvent::Type::KEY_DOWN) bits |= DOWN_BIT;
+
+            put_varint(events, (event.cycle - cycle) << TYPE_BITS | bits);
+            cycle = event.cycle;
+        }
+
+        std::vector<uint8_t> data;
+        Writer w{data};
+        w.magic(MAGIC, VERSION);
+        w.u8(static_cast<uint8_t>(movie.quirks));
+        w.u32(movie.seed);
+        w.u64(movie.ram_hash);
+        w.u64(movie.cycles);
+        w.u64(movie.framebuffer_hash);
+        w.u32(static_cast<uint32_t>(movie.events.size()));
+        w.u64(hash_bytes(events.data(), events.size()));
+        data.insert(data.end(), events.begin(), events.end());
+
+        write_file(path, data, "movie");
+    }
+
+    Movie load_movie(const std::string& path) {
+        return load_file(path, "movie", [](const std::vector<uint8_t>& data) {
+            Reader r{data.data(), data.size(), "movie"};
+            const uint16_t version = r.magic(MAGIC, HEADER_SIZE);
+            if (version != VERSION) {
+                throw std::runtime_error("Unsupported movie version " + std::to_string(version));
+            }
+
+            Movie movie;
+            const uint8_t quirks = r.u8();
+            if (quirks >= QUIRKS_COUNT) throw std::runtime_error("Movie has an unknown quirk profile");
+            movie.quirks = static_cast<Quirks>(quirks);
+            movie.seed = r.u32();
+            movie.ram_hash = r.u64();
+            movie.cycles = r.u64();
+            movie.framebuffer_hash = r.u64();
+            const uint32_t count = r.u32();
+            const uint64_t checksum = r.u64();
+
+            if (hash_bytes(data.data() + r.pos, data.size() - r.pos) != checksum) {
+                throw std::runtime_error("Movie checksum mismatch");
+            }
+
+            // Every event is at least a byte, so a bogus count can't make this allocate much
+            if (count > data.size() - r.pos) throw std::runtime_error("Movie is truncated");
+            movie.events.reserve(count);
+
+            uint64_t cycle = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                const uint64_t value = get_varint(r);
+                cycle += value >> TYPE_BITS;
+
+                MovieEvent event;
+                event.cycle = cycle;
+                event.key = value & 0xF;
+                if (value & TICK_BIT) event.type = MovieEvent::Type::TICK;
+                else event.type = (value & DOWN_BIT) ? MovieEvent::Type::KEY_DOWN : MovieEvent::Type::KEY_UP;
+                movie.events.push_back(event);
+            }
+
+            if (r.pos != data.size()) throw std::runtime_error("Movie has trailing data");
+            if (cycle > movie.cycles) throw std::runtime_error("Movie has events past its end");
+            return movie;
+        });
+    }
+}
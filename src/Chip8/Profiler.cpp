@@ -0,0 +1,248 @@
+#include "Chip8/Profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace Chip8 {
+    namespace {
+        // Report name per Op, in the same order as the Op enum
+        constexpr const char* OP_NAMES[] = {
+            "NONE",
+            "00E0", "00EE", "0NNN",
+            "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+            "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+            "9XY0", "ANNN", "BNNN", "CXNN", "DXYN",
+            "EX9E", "EXA1",
+            "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+            "00CN", "00FB", "00FC", "00FD", "00FE", "00FF",
+            "FX30", "FX75", "FX85",
+            "00DN", "5XY2", "5XY3", "F000", "FN01", "F002", "FX3A",
+            "INVALID",
+        };
+        static_assert(sizeof(OP_NAMES) / sizeof(OP_NAMES[0]) == OP_COUNT, "One name per Op");
+
+        constexpr uint16_t ENTRY_POINT = 0x200;
+
+        std::string hex(uint32_t value, int width) {
+            std::ostringstream s;
+            s << std::hex << std::uppercase << std::setw(width) << std::setfill('0') << value;
+            return s.str();
+        }
+
+        std::string routine_name(uint16_t routine) {
+            return routine == ENTRY_POINT ? "main" : "sub_" + hex(routine, 3);
+        }
+
+        double percent(uint64_t count, uint64_t total) {
+            return total ? 100.0 * static_cast<double>(count) / static_cast<double>(total) : 0.0;
+        }
+
+        // The `top` largest entries of a map, by the key `order` gives them
+        template <typename Map, typename Order>
+        std::vector<std::pair<typename Map::key_type, typename Map::mapped_type>>
+        top_of(const Map& map, size_t top, Order order) {
+            std::vector<std::pair<typename Map::key_type, typename Map::mapped_type>> sorted(map.begin(), map.end());
+            std::sort(sorted.begin(), sorted.end(), [&](const auto& a, const auto& b) {
+                return order(a) != order(b) ? order(a) > order(b) : a.first < b.first;
+            });
+            if (sorted.size() > top) sorted.resize(top);
+            return sorted;
+        }
+    }
+
+    Profiler::Profiler() {
+        clear();
+    }
+
+    void Profiler::clear() {
+        pc_counts.fill(0);
+        opcodes.fill(0);
+        op_counts.fill(0);
+        total = 0;
+
+        nodes.assign(1, Node{0, ENTRY_POINT});
+        node_counts.assign(1, 0);
+        children.clear();
+        path.clear();
+        node = 0;
+
+        calls.clear();
+        back_edges.clear();
+    }
+
+    uint32_t Profiler::call(uint16_t target) {
+        const uint64_t key = static_cast<uint64_t>(node) << 16 | target;
+        const auto found = children.find(key);
+        if (found != children.end()) return found->second;
+
+        if (nodes.size() >= MAX_NODES) return node;
+
+        const uint32_t child = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{node, target});
+        node_counts.push_back(0);
+        children.emplace(key, child);
+        return child;
+    }
+
+    uint64_t Profiler::run(Machine& machine, const Config& config, uint64_t n) {
+        // The guest's stack changed under us (reset, state load, rewind), pick it up again from the top
+        if (path.size() != machine.stack_ptr) {
+            path.clear();
+            node = 0;
+        }
+
+        for (uint64_t i = 0; i < n; i++) {
+            // A VIP waits out the frame after a draw, like execute() there's nothing to count until the tick
+            if (machine.vblank_wait) break;
+
+            const uint16_t pc = machine.PC & machine.ram_mask;
+            emulate_instruction(machine, config);
+
+            // current_inst is the instruction that just ran, and PC is where it went
+            const uint16_t opcode = machine.current_inst.opcode;
+            const Op op = decode_op(opcode);
+            const uint16_t next = machine.PC & machine.ram_mask;
+
+            pc_counts[pc]++;
+            opcodes[pc] = opcode;
+            op_counts[static_cast<size_t>(op)]++;
+            node_counts[node]++;
+
+            if (op == Op::OP_2NNN) {
+                calls[static_cast<uint32_t>(nodes[node].routine) << 16 | next]++;
+                path.push_back(node);
+                node = call(next);
+            } else if (op == Op::OP_00EE) {
+                if (!path.empty()) {
+                    node = path.back();
+                    path.pop_back();
+                }
+            } else if (next <= pc) {
+                // Jumped back (or waited in place, FX0A and 1NNN to itself): the end of a loop
+                back_edges[static_cast<uint32_t>(pc) << 16 | next]++;
+            }
+        }
+
+        total += n;
+        return n;
+    }
+
+    std::string Profiler::stack_name(uint32_t at) const {
+        std::vector<uint16_t> routines;
+        for (uint32_t n = at; ; n = nodes[n].parent) {
+            routines.push_back(nodes[n].routine);
+            if (n == 0) break;
+        }
+
+        std::string name;
+        for (auto r = routines.rbegin(); r != routines.rend(); ++r) {
+            if (!name.empty()) name += ';';
+            name += routine_name(*r);
+        }
+        return name;
+    }
+
+    void Profiler::write_report(std::ostream& out, size_t top) const {
+        out << "Instructions: " << total << "\n" << std::fixed << std::setprecision(2);
+
+        // Op classes, most executed first
+        std::unordered_map<size_t, uint64_t> ops;
+        for (size_t op = 0; op < OP_COUNT; op++) {
+            if (op_counts[op]) ops[op] = op_counts[op];
+        }
+        out << "\nOp classes\n" << std::setw(14) << "count" << std::setw(9) << "%" << "  op\n";
+        for (const auto& [op, count] : top_of(ops, OP_COUNT, [](const auto& e) { return e.second; })) {
+            out << std::setw(14) << count << std::setw(9) << percent(count, total) << "  " << OP_NAMES[op] << "\n";
+        }
+
+        // Addresses
+        std::unordered_map<uint32_t, uint64_t> pcs;
+        for (uint32_t pc = 0; pc < pc_counts.size(); pc++) {
+            if (pc_counts[pc]) pcs[pc] = pc_counts[pc];
+        }
+        out << "\nHottest addresses\n" << std::setw(8) << "address" << std::setw(14) << "count"
+            << std::setw(9) << "%" << "  opcode\n";
+        for (const auto& [pc, count] : top_of(pcs, top, [](const auto& e) { return e.second; })) {
+            out << std::setw(8) << hex(pc, 3) << std::setw(14) << count << std::setw(9) << percent(count, total)
+                << "  " << hex(opcodes[pc], 4) << " " << OP_NAMES[static_cast<size_t>(decode_op(opcodes[pc]))] << "\n";
+        }
+
+        // Routines. Self is what ran in the routine itself, total includes everything it called.
+        // A recursive routine counts once per instruction, not once per frame it has on the stack
+        std::unordered_map<uint16_t, std::pair<uint64_t, uint64_t>> routines;   // self, total
+        for (uint32_t n = 0; n < nodes.size(); n++) {
+            if (!node_counts[n]) continue;
+            routines[nodes[n].routine].first += node_counts[n];
+
+            std::vector<uint16_t> seen;
+            for (uint32_t a = n; ; a = nodes[a].parent) {
+                if (std::find(seen.begin(), seen.end(), nodes[a].routine) == seen.end()) {
+                    seen.push_back(nodes[a].routine);
+                    routines[nodes[a].routine].second += node_counts[n];
+                }
+                if (a == 0) break;
+            }
+        }
+        std::unordered_map<uint16_t, uint64_t> called;
+        for (const auto& [edge, count] : calls) called[edge & 0xFFFF] += count;
+
+        out << "\nRoutines\n" << std::left << std::setw(10) << "routine" << std::right << std::setw(14) << "self"
+            << std::setw(9) << "%" << std::setw(14) << "total" << std::setw(9) << "%" << std::setw(12) << "calls\n";
+        for (const auto& [routine, counts] : top_of(routines, top, [](const auto& e) { return e.second.first; })) {
+            out << std::left << std::setw(10) << routine_name(routine) << std::right
+                << std::setw(14) << counts.first << std::setw(9) << percent(counts.first, total)
+                << std::setw(14) << counts.second << std::setw(9) << percent(counts.second, total)
+                << std::setw(11) << (routine == ENTRY_POINT ? 0 : called[routine]) << "\n";
+        }
+
+        // Call graph edges, most taken first
+        out << "\nCalls\n";
+        for (const auto& [edge, count] : top_of(calls, top, [](const auto& e) { return e.second; })) {
+            out << "  " << std::left << std::setw(10) << routine_name(static_cast<uint16_t>(edge >> 16))
+                << " -> " << std::setw(10) << routine_name(static_cast<uint16_t>(edge & 0xFFFF))
+                << std::right << std::setw(14) << count << "\n";
+        }
+
+        // Loops: a backward jump from `from` to `to` closes a loop over [to, from]. Ranked by the
+        // instructions run at addresses inside it, which leaves out the routines it calls
+        std::unordered_map<uint32_t, uint64_t> loops;
+        for (const auto& [edge, taken] : back_edges) {
+            uint64_t body = 0;
+            for (uint32_t pc = edge & 0xFFFF; pc <= (edge >> 16); pc++) body += pc_counts[pc];
+            loops[edge] = body;
+        }
+        out << "\nHot loops\n" << std::setw(13) << "range" << std::setw(14) << "iterations"
+            << std::setw(14) << "instructions" << std::setw(9) << "%" << "\n";
+        for (const auto& [edge, body] : top_of(loops, top, [](const auto& e) { return e.second; })) {
+            const std::string range = hex(edge & 0xFFFF, 3) + "-" + hex(edge >> 16, 3);
+            out << std::setw(13) << range << std::setw(14) << back_edges.at(edge)
+                << std::setw(14) << body << std::setw(9) << percent(body, total) << "\n";
+        }
+
+        out << std::defaultfloat;
+    }
+
+    void Profiler::write_folded(std::ostream& out) const {
+        for (uint32_t n = 0; n < nodes.size(); n++) {
+            if (node_counts[n]) out << stack_name(n) << " " << node_counts[n] << "\n";
+        }
+    }
+
+    void Profiler::save(const std::string& path) const {
+        std::ofstream report(path, std::ios::trunc);
+        if (!report) {
+            throw std::runtime_error("Failed to write profile " + path);
+        }
+        write_report(report);
+
+        const std::string folded_path = path + ".folded";
+        std::ofstream folded(folded_path, std::ios::trunc);
+        if (!folded) {
+            throw std::runtime_error("Failed to write profile " + folded_path);
+        }
+        write_folded(folded);
+    }
+}
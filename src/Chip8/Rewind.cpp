@@ -0,0 +1,154 @@
+#include "Chip8/Rewind.hpp"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace Chip8 {
+    namespace {
+        // Snapshots are compared and encoded as raw 8 byte words
+        static_assert(std::is_trivially_copyable_v<Snapshot>, "Snapshot has to be plain data");
+        static_assert(sizeof(Snapshot) % sizeof(uint64_t) == 0, "Snapshot has to be a whole number of words");
+        static_assert(offsetof(Snapshot, ram) % sizeof(uint64_t) == 0, "Snapshot RAM has to start on a word");
+        constexpr size_t WORDS = sizeof(Snapshot) / sizeof(uint64_t);
+
+        uint64_t word(const Snapshot& s, size_t i) {
+            uint64_t w;
+            std::memcpy(&w, reinterpret_cast<const unsigned char*>(&s) + i * sizeof(uint64_t), sizeof(w));
+            return w;
+        }
+
+        void set_word(Snapshot& s, size_t i, uint64_t w) {
+            std::memcpy(reinterpret_cast<unsigned char*>(&s) + i * sizeof(uint64_t), &w, sizeof(w));
+        }
+
+        // state XOR base as runs of zero words and literal words
+        // Only as far as the bigger of the two goes, past its RAM both are all zero. For CHIP8 machines
+        // that leaves out 60KB of the 64KB XO-CHIP RAM a Snapshot has room for
+        void encode(const Snapshot& state, const Snapshot& base, std::vector<uint64_t>& out) {
+            const size_t words = std::max(snapshot_size(state), snapshot_size(base)) / sizeof(uint64_t);
+
+            // XOR everything first, a straight loop the compiler vectorizes, then look for the runs
+            std::array<uint64_t, WORDS> diff;
+            for (size_t i = 0; i < words; i++) diff[i] = word(state, i) ^ word(base, i);
+
+            // Worst case every other word differs: a run header per literal
+            std::array<uint64_t, WORDS + WORDS / 2 + 1> runs;
+            size_t n = 0;
+            size_t i = 0;
+            while (i < words) {
+                const size_t start = i;
+                while (i < words && diff[i] == 0) i++;
+                const size_t zeros = i - start;
+
+                const size_t literal = i;
+                while (i < words && diff[i] != 0) runs[n + 1 + i - literal] = diff[i], i++;
+
+                runs[n] = static_cast<uint64_t>(zeros) << 32 | (i - literal);
+                n += 1 + i - literal;
+            }
+
+            // One allocation at most, none once the ring has wrapped and the slot is big enough
+            out.assign(runs.begin(), runs.begin() + n);
+        }
+
+        void decode(const std::vector<uint64_t>& runs, const Snapshot& base, Snapshot& out) {
+            // Past a snapshot's RAM is all zero. Copying as far as the bigger of the two keeps it that
+            // way in `out` without touching the 60KB of XO-CHIP RAM a CHIP8 machine's snapshots never use
+            std::memcpy(&out, &base, std::max(snapshot_size(base), snapshot_size(out)));
+            size_t i = 0;
+            for (size_t r = 0; r < runs.size();) {
+                i += runs[r] >> 32;
+                const size_t literals = runs[r++] & 0xFFFFFFFF;
+                for (size_t j = 0; j < literals; j++, i++) set_word(out, i, word(out, i) ^ runs[r++]);
+            }
+        }
+    }
+
+    RewindBuffer::RewindBuffer(size_t frames, size_t keyframe_interval)
+        : interval(keyframe_interval ? keyframe_interval : 1) {
+        // Dropping the oldest keyframe drops up to `interval` frames at once, so keep that many extra
+        ring.resize(frames + interval);
+
+        // Padding bytes take part in the XOR, so give them a fixed value
+        std::memset(static_cast<void*>(&current), 0, sizeof(Snapshot));
+        std::memset(static_cast<void*>(&key), 0, sizeof(Snapshot));
+        std::memset(static_cast<void*>(&zero), 0, sizeof(Snapshot));
+    }
+
+    void RewindBuffer::push(const Machine& machine) {
+        snapshot(machine, current);
+        if (count == ring.size()) drop_oldest();
+
+        const bool keyframe = count == 0 || since_key >= interval;
+        Entry& entry = ring[(oldest + count) % ring.size()];
+        encode(current, keyframe ? zero : newest_key(), entry.runs);
+        entry.keyframe = keyframe;
+        used += entry.runs.size();
+        count++;
+
+        if (keyframe) {
+            std::memcpy(&key, &current, sizeof(Snapshot));
+            key_valid = true;
+            since_key = 1;
+        } else {
+            since_key++;
+        }
+    }
+
+    bool RewindBuffer::rewind(Machine& machine) {
+        if (count == 0) return false;
+
+        Entry& entry = ring[index(0)];
+        decode(entry.runs, entry.keyframe ? zero : newest_key(), current);
+        restore(machine, current);
+
+        used -= entry.runs.size();
+        entry.runs.clear();
+        count--;
+
+        if (entry.keyframe) {
+            // Now in the previous segment, find where it starts
+            key_valid = false;
+            since_key = 0;
+            while (since_key < count && !ring[index(since_key)].keyframe) since_key++;
+            if (since_key < count) since_key++;
+        } else {
+            since_key--;
+        }
+        return true;
+    }
+
+    void RewindBuffer::clear() {
+        for (Entry& entry : ring) entry.runs.clear();
+        oldest = 0;
+        count = 0;
+        since_key = 0;
+        used = 0;
+        key_valid = false;
+    }
+
+    const Snapshot& RewindBuffer::newest_key() {
+        if (!key_valid) {
+            // rewind() stepped back past a keyframe, decode the one the newest frames hang off
+            decode(ring[index(since_key - 1)].runs, zero, key);
+            key_valid = true;
+        }
+        return key;
+    }
+
+    void RewindBuffer::drop_oldest() {
+        // A keyframe and all the deltas that depend on it
+        do {
+            Entry& entry = ring[oldest];
+            used -= entry.runs.size();
+            entry.runs.clear();
+            oldest = (oldest + 1) % ring.size();
+            count--;
+        } while (count > 0 && !ring[oldest].keyframe);
+
+        if (count == 0) {
+            since_key = 0;
+            key_valid = false;
+        }
+    }
+}
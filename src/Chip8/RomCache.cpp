@@ -0,0 +1,227 @@
+#include "Chip8/RomCache.hpp"
+#include "Chip8/Core.hpp"
+#include <algorithm>  // For std::copy
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Big ROMs are memory-mapped instead of read into a buffer first
+#if defined(__unix__) || defined(__APPLE__)
+    #define CHIP8_ROM_MMAP 1
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #define CHIP8_ROM_MMAP 0
+#endif
+
+namespace Chip8 {
+    namespace {
+        constexpr uint32_t ENTRY_POINT = 0x200; // CHIP8 ROMS will be loaded to 0x200.
+        // Before that is reserved for the CHIP8 interpreter
+
+        // Font data starts at 0x50 (CHIP-8 specification)
+        //CHIP-8 expects fonts at 0x50-0x9F (16 characters × 5 bytes).
+        constexpr uint32_t FONTSET_START_ADDRESS = 0x50;
+
+        // There are 16 characters at 5 bytes each, so we need an array of 80 bytes.
+        constexpr std::array<u_int8_t, 80> FONT_SET =
+        {
+            0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+            0x20, 0x60, 0x20, 0x20, 0x70, // 1
+            0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+            0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+            0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+            0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+            0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+            0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+            0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+            0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+            0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+            0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+            0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+            0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+            0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+            0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+        };
+
+        // SUPER-CHIP big font for FX30, digits 0-F at 8x10 pixels (1 byte a row, 10 bytes each)
+        // Goes right after the small font, 0xA0-0x13F, still well below the ROM
+        constexpr uint32_t BIG_FONTSET_START_ADDRESS = FONTSET_START_ADDRESS + FONT_SET.size();
+
+        constexpr std::array<u_int8_t, 160> BIG_FONT_SET =
+        {
+            0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+            0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+            0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+            0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+            0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+            0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+            0x3E, 0x7C, 0xC0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+            0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+            0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+            0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+            0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+            0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+            0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+            0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+            0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+            0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+        };
+
+        // Smaller files are read, every CHIP8 ROM is. Mapping only pays for itself on XO-CHIP sized ones
+        constexpr size_t MMAP_MIN_SIZE = 4096;
+
+        // Different keys for the two modes, a ROM loaded as both gets an image of each size
+        constexpr uint64_t XOCHIP_KEY = 0x9E3779B97F4A7C15ULL;
+
+        size_t ram_size(bool xochip) { return xochip ? 0x10000 : 0x1000; }
+
+        // A ROM file's bytes, mapped or read, for as long as this lives. The size is checked before
+        // anything is read, so a huge file fails fast
+        class RomFile {
+        public:
+            RomFile(const std::string& path, bool xochip) {
+            #if CHIP8_ROM_MMAP
+                const int fd = ::open(path.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    throw std::runtime_error("Failed to open ROM: " + path + "\n");
+                }
+
+                struct stat info;
+                if (::fstat(fd, &info) != 0) {
+                    ::close(fd);
+                    throw std::runtime_error("Failed to open ROM: " + path + "\n");
+                }
+                length = static_cast<size_t>(info.st_size);
+                if (length > ram_size(xochip) - ENTRY_POINT) {
+                    ::close(fd);
+                    throw std::runtime_error("ROM exceeds memory bounds\n");
+                }
+
+                if (length >= MMAP_MIN_SIZE) {
+                    void* map = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (map != MAP_FAILED) mapped = static_cast<const uint8_t*>(map);
+                }
+                if (!mapped) {
+                    buffer.resize(length);
+                    if (::read(fd, buffer.data(), length) != static_cast<ssize_t>(length)) {
+                        ::close(fd);
+                        throw std::runtime_error("Failed to read entire ROM\n");
+                    }
+                }
+                ::close(fd);
+            #else
+                // Opens the ROM file as a binary file with the pointer at the end, where tellg() is the size
+                std::ifstream rom(path, std::ios::binary | std::ios::ate);
+                if (!rom) {
+                    throw std::runtime_error("Failed to open ROM: " + path + "\n");
+                }
+                length = static_cast<size_t>(rom.tellg());
+                if (length > ram_size(xochip) - ENTRY_POINT) {
+                    throw std::runtime_error("ROM exceeds memory bounds\n");
+                }
+                rom.seekg(0);
+
+                buffer.resize(length);
+                if (!rom.read(reinterpret_cast<char*>(buffer.data()), length)) {
+                    throw std::runtime_error("Failed to read entire ROM\n");
+                }
+            #endif
+            }
+
+            ~RomFile() {
+            #if CHIP8_ROM_MMAP
+                if (mapped) ::munmap(const_cast<uint8_t*>(mapped), length);
+            #endif
+            }
+
+            RomFile(const RomFile&) = delete;
+            RomFile& operator=(const RomFile&) = delete;
+
+            const uint8_t* data() const { return mapped ? mapped : buffer.data(); }
+            size_t size() const { return length; }
+
+        private:
+            std::vector<uint8_t> buffer;
+            const uint8_t* mapped = nullptr;
+            size_t length = 0;
+        };
+
+        std::shared_ptr<RomImage> build_image(const uint8_t* rom, size_t size, bool xochip, uint64_t hash) {
+            // Check that the ROM will fit in memory (from ENTRY_POINT to the end of RAM, 4KB or XO-CHIP's 64KB).
+            if (size > ram_size(xochip) - ENTRY_POINT) {
+                throw std::runtime_error("ROM exceeds memory bounds\n");
+            }
+
+            auto image = std::make_shared<RomImage>();
+            image->hash = hash;
+            image->size = size;
+            image->xochip = xochip;
+            image->ram.assign(ram_size(xochip), 0);
+
+            // Load font
+            // Copies the font data into the CHIP-8 RAM starting at address 0x50.
+            std::copy(FONT_SET.begin(), FONT_SET.end(), image->ram.begin() + FONTSET_START_ADDRESS);
+            std::copy(BIG_FONT_SET.begin(), BIG_FONT_SET.end(), image->ram.begin() + BIG_FONTSET_START_ADDRESS);
+
+            // Load ROM, starting at ENTRY_POINT at 0x200
+            if (size > 0) std::memcpy(image->ram.data() + ENTRY_POINT, rom, size);
+            return image;
+        }
+
+        bool same_rom(const RomImage& image, const uint8_t* rom, size_t size, bool xochip) {
+            return image.xochip == xochip && image.size == size &&
+                   std::memcmp(image.ram.data() + ENTRY_POINT, rom, size) == 0;
+        }
+    }
+
+    std::shared_ptr<const RomImage> RomCache::load(std::string_view path, bool xochip) {
+        const RomFile file(std::string(path), xochip);
+        return load(file.data(), file.size(), xochip);
+    }
+
+    std::shared_ptr<const RomImage> RomCache::load(const uint8_t* rom, size_t size, bool xochip) {
+        const uint64_t hash = hash_bytes(rom, size);
+        const uint64_t key = hash ^ (xochip ? XOCHIP_KEY : 0);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto found = images.find(key);
+            // The bytes are compared too, a hash collision gets an image of its own that isn't cached
+            if (found != images.end() && same_rom(*found->second, rom, size, xochip)) {
+                ++hit_count;
+                return found->second;
+            }
+        }
+
+        // Built outside the lock, two threads loading the same new ROM at once just both build it
+        std::shared_ptr<const RomImage> image = build_image(rom, size, xochip, hash);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        images.emplace(key, image);
+        return image;
+    }
+
+    size_t RomCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return images.size();
+    }
+
+    uint64_t RomCache::hits() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hit_count;
+    }
+
+    void RomCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        images.clear();
+        hit_count = 0;
+    }
+
+    RomCache& rom_cache() {
+        static RomCache cache;
+        return cache;
+    }
+}
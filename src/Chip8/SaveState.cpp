@@ -0,0 +1,276 @@
+#include "Chip8/SaveState.hpp"
+#include "Chip8/BinaryFile.hpp"
+#include "Chip8/Core.hpp"
+#include "Chip8/Display.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace Chip8 {
+    namespace {
+        constexpr char MAGIC[4] = {'C', '8', 'S', 'T'};
+        constexpr uint16_t VERSION = 4;     // 2 added SUPER-CHIP hi-res and the RPL flags, 3 XO-CHIP, 4 quirk profiles
+        constexpr uint16_t HEADER_SIZE = 4 + 2 + 2 + 4 + 8;
+
+        // A zero run shorter than this costs more as a new run header than as literal bytes
+        constexpr size_t MIN_ZERO_RUN = 4;
+
+        // Longest run a u16 count holds, longer ones (64KB of XO-CHIP RAM) are split
+        constexpr size_t MAX_RUN = 0xFFFF;
+
+        // The first `size` bytes of RAM as alternating runs: <zeros> <literal count> <literal bytes>
+        void write_ram(Writer& w, const std::vector<uint8_t>& ram, size_t size) {
+            size_t addr = 0;
+            while (addr < size) {
+                size_t zeros = 0;
+                while (addr + zeros < size && zeros < MAX_RUN && ram[addr + zeros] == 0) zeros++;
+
+                // Literals go on until the next zero run worth its own header
+                const size_t start = addr + zeros;
+                size_t end = start;
+                while (end < size && end - start < MAX_RUN) {
+                    size_t z = end;
+                    while (z < size && ram[z] == 0 && z - end < MIN_ZERO_RUN) z++;
+                    if (z - end >= MIN_ZERO_RUN || z == size) break;
+                    end = std::min((z == end) ? end + 1 : z, start + MAX_RUN);
+                }
+
+                w.u16(static_cast<uint16_t>(zeros));
+                w.u16(static_cast<uint16_t>(end - start));
+                w.out.insert(w.out.end(), ram.begin() + start, ram.begin() + end);
+                addr = end;
+            }
+        }
+
+        void read_ram(Reader& r, std::array<uint8_t, 0x10000>& ram, size_t size) {
+            size_t addr = 0;
+            while (addr < size) {
+                const size_t zeros = r.u16();
+                const size_t literals = r.u16();
+                if (zeros + literals == 0 || addr + zeros + literals > size || r.size - r.pos < literals) {
+                    throw std::runtime_error("Save state RAM is corrupt");
+                }
+
+                std::fill(ram.begin() + addr, ram.begin() + addr + zeros, 0);
+                addr += zeros;
+                std::memcpy(ram.data() + addr, r.data + r.pos, literals);
+                addr += literals;
+                r.pos += literals;
+            }
+        }
+    }
+
+    void snapshot(const Machine& machine, Snapshot& out) {
+        // Only the RAM the machine has, and zeros where a bigger machine's snapshot was before
+        const size_t size = machine.ram_mask + 1u;
+        std::memcpy(out.ram.data(), machine.ram.data(), size);
+        if (out.ram_mask + 1u > size) std::memset(out.ram.data() + size, 0, out.ram_mask + 1u - size);
+        out.ram_mask = machine.ram_mask;
+
+        out.display = machine.display;
+        out.stack = machine.stack;
+        out.V = machine.V;
+        out.flags = machine.flags;
+        out.pattern = machine.pattern;
+        out.cycles = machine.cycles;
+        out.frames = machine.frames;
+        out.rng = machine.rng;
+        out.I = machine.I;
+        out.PC = machine.PC;
+        out.stack_ptr = machine.stack_ptr;
+        out.delay_timer = machine.delay_timer;
+        out.sound_timer = machine.sound_timer;
+        out.hires = machine.hires;
+        out.xochip = machine.xochip;
+        out.quirks = machine.quirks;
+        out.vblank_wait = machine.vblank_wait;
+        out.planes = machine.planes;
+        out.pitch = machine.pitch;
+        out.audio_pattern = machine.audio_pattern;
+        out.state = machine.state;
+
+        out.keypad = 0;
+        for (size_t k = 0; k < machine.keypad.size(); k++) {
+            out.keypad |= static_cast<uint16_t>(machine.keypad[k]) << k;
+        }
+    }
+
+    void restore(Machine& machine, const Snapshot& in) {
+        // Decoded instructions (and JIT blocks built on them) stay valid as long as the bytes
+        // they came from are the same. Compare only the decoded range, usually the ROM's code
+        DecodeCache& cache = machine.decode_cache;
+        if (cache.lo <= cache.hi) {
+            const size_t len = std::min<size_t>(cache.hi + 2u, in.ram.size()) - cache.lo;
+            if (machine.ram_mask != in.ram_mask ||
+                std::memcmp(machine.ram.data() + cache.lo, in.ram.data() + cache.lo, len) != 0) cache.clear();
+        }
+
+        machine.xochip = in.xochip;
+        machine.resize_memory();
+        std::memcpy(machine.ram.data(), in.ram.data(), machine.ram.size());
+        machine.quirks = in.quirks;
+        machine.vblank_wait = in.vblank_wait;
+
+        machine.display = in.display;
+        machine.dirty_rows = ALL_ROWS;  // The frontend's copy of the display is from another point in time
+        machine.stack = in.stack;
+        machine.V = in.V;
+        machine.flags = in.flags;
+        machine.pattern = in.pattern;
+        machine.cycles = in.cycles;
+        machine.frames = in.frames;
+        machine.rng = in.rng;
+        machine.I = in.I;
+        machine.PC = in.PC;
+        machine.stack_ptr = in.stack_ptr;
+        machine.delay_timer = in.delay_timer;
+        machine.sound_timer = in.sound_timer;
+        machine.hires = in.hires;
+        machine.planes = in.planes;
+        machine.pitch = in.pitch;
+        machine.audio_pattern = in.audio_pattern;
+        machine.state = in.state;
+
+        for (size_t k = 0; k < machine.keypad.size(); k++) {
+            machine.keypad[k] = (in.keypad >> k) & 1;
+        }
+    }
+
+    std::vector<uint8_t> serialize_state(const Machine& machine) {
+        std::vector<uint8_t> data;
+        data.reserve(HEADER_SIZE + 512 + machine.ram_mask + 1u);
+
+        Writer w{data};
+        w.magic(MAGIC, VERSION);
+        w.u16(HEADER_SIZE);
+        w.u32(0);   // Payload size and checksum, filled in below
+        w.u64(0);
+
+        // Straight from the machine, a Snapshot would mean clearing 64KB of RAM first just to write 4KB of it
+        uint16_t keypad = 0;
+        for (size_t k = 0; k < machine.keypad.size(); k++) keypad |= static_cast<uint16_t>(machine.keypad[k]) << k;
+
+        for (const uint8_t v : machine.V) w.u8(v);
+        w.u16(machine.I);
+        w.u16(machine.PC);
+        w.u8(machine.stack_ptr);
+        for (const uint16_t entry : machine.stack) w.u16(entry);
+        w.u8(machine.delay_timer);
+        w.u8(machine.sound_timer);
+        w.u16(keypad);
+        w.u32(machine.rng);
+        w.u8(static_cast<uint8_t>(machine.state));
+        w.u64(machine.cycles);
+        w.u64(machine.frames);
+        w.u8(machine.hires);
+        for (const uint8_t flag : machine.flags) w.u8(flag);
+        w.u8(static_cast<uint8_t>(machine.quirks));
+        w.u8(machine.planes);
+        w.u8(machine.pitch);
+        w.u8(machine.audio_pattern);
+        for (const uint8_t bits : machine.pattern) w.u8(bits);
+        w.u8(machine.vblank_wait);
+        for (uint32_t p = 0; p < display_planes(machine.xochip); p++) {
+            for (uint32_t y = 0; y < display_height(machine.hires); y++) {
+                for (uint32_t x = 0; x < display_width(machine.hires); x += 64) w.u64(machine.display[p][y][x / 64]);
+            }
+        }
+        write_ram(w, machine.ram, machine.ram_mask + 1u);
+
+        const size_t payload = data.size() - HEADER_SIZE;
+        const uint64_t checksum = hash_bytes(data.data() + HEADER_SIZE, payload);
+        for (size_t i = 0; i < 4; i++) data[8 + i] = static_cast<uint8_t>(payload >> (8 * i));
+        for (size_t i = 0; i < 8; i++) data[12 + i] = static_cast<uint8_t>(checksum >> (8 * i));
+        return data;
+    }
+
+    void deserialize_state(Machine& machine, const std::vector<uint8_t>& data) {
+        Reader header{data.data(), data.size(), "save state"};
+        const uint16_t version = header.magic(MAGIC, HEADER_SIZE);
+        const uint16_t header_size = header.u16();
+        const uint32_t payload = header.u32();
+        const uint64_t checksum = header.u64();
+
+        // Later versions may add header fields, but a version this build doesn't know can't be read
+        if (version == 0 || version > VERSION) {
+            throw std::runtime_error("Unsupported save state version " + std::to_string(version));
+        }
+        if (header_size < HEADER_SIZE || data.size() - header_size != payload) {
+            throw std::runtime_error("Save state is truncated");
+        }
+        if (hash_bytes(data.data() + header_size, payload) != checksum) {
+            throw std::runtime_error("Save state checksum mismatch");
+        }
+
+        // Read into a snapshot first, so a bad state leaves the machine as it was
+        Reader r{data.data() + header_size, payload, "save state"};
+        Snapshot s;
+        for (uint8_t& v : s.V) v = r.u8();
+        s.I = r.u16();
+        s.PC = r.u16();
+        s.stack_ptr = r.u8();
+        for (uint16_t& entry : s.stack) entry = r.u16();
+        s.delay_timer = r.u8();
+        s.sound_timer = r.u8();
+        s.keypad = r.u16();
+        s.rng = r.u32();
+        const uint8_t state = r.u8();
+        s.cycles = r.u64();
+        s.frames = r.u64();
+        if (version >= 2) {
+            const uint8_t hires = r.u8();
+            if (hires > 1) throw std::runtime_error("Save state has an unknown resolution");
+            s.hires = hires;
+            for (uint8_t& flag : s.flags) flag = r.u8();
+        }
+        if (version >= 3) {
+            const uint8_t quirks = r.u8();
+            if (quirks >= (version >= 4 ? QUIRKS_COUNT : 2)) throw std::runtime_error("Save state has an unknown machine mode");
+            s.quirks = static_cast<Quirks>(quirks);
+            s.xochip = s.quirks == Quirks::XOCHIP;
+            s.ram_mask = s.xochip ? 0xFFFF : 0x0FFF;
+            s.planes = r.u8();
+            s.pitch = r.u8();
+            s.audio_pattern = r.u8() != 0;
+            for (uint8_t& bits : s.pattern) bits = r.u8();
+            if (s.planes > ALL_PLANES) throw std::runtime_error("Save state selects planes that don't exist");
+        }
+        if (version >= 4) {
+            const uint8_t vblank_wait = r.u8();
+            if (vblank_wait > 1) throw std::runtime_error("Save state has an unknown display wait");
+            s.vblank_wait = vblank_wait;
+        }
+        for (uint32_t p = 0; p < display_planes(s.xochip); p++) {
+            for (uint32_t y = 0; y < display_height(s.hires); y++) {
+                for (uint32_t x = 0; x < display_width(s.hires); x += 64) s.display[p][y][x / 64] = r.u64();
+            }
+        }
+        read_ram(r, s.ram, s.ram_mask + 1u);
+
+        if (r.pos != r.size) throw std::runtime_error("Save state has trailing data");
+        if (s.stack_ptr > s.stack.size()) throw std::runtime_error("Save state stack pointer out of range");
+        if (state > static_cast<uint8_t>(EmulatorState::PAUSED)) throw std::runtime_error("Save state has an unknown emulator state");
+        if (s.rng == 0) throw std::runtime_error("Save state random number generator is zero");
+        s.state = static_cast<EmulatorState>(state);
+
+        restore(machine, s);
+    }
+
+    void save_state(const Machine& machine, const std::string& path) {
+        const std::vector<uint8_t> data = serialize_state(machine);
+
+        // Written next to the old state and renamed over it, so a failed save never loses the previous one
+        const std::string temp = path + ".tmp";
+        write_file(temp, data, "save state");
+        std::filesystem::rename(temp, path);
+    }
+
+    void load_state(Machine& machine, const std::string& path) {
+        load_file(path, "save state", [&](const std::vector<uint8_t>& data) { deserialize_state(machine, data); });
+    }
+
+    std::string state_path(std::string_view rom_path) {
+        return std::string(rom_path) + ".state";
+    }
+}
@@ -0,0 +1,45 @@
+#include "Chip8/Scheduler.hpp"
+#include <algorithm>
+
+namespace Chip8 {
+    FrameScheduler::FrameScheduler(double frames_per_second, uint32_t max_catch_up)
+        : fps(frames_per_second), max_catch_up(std::max(1u, max_catch_up)), start(Clock::now()) {}
+
+    void FrameScheduler::restart(Clock::time_point now) {
+        start = now;
+        next = 0;
+    }
+
+    void FrameScheduler::set_rate(double frames_per_second, Clock::time_point now) {
+        if (frames_per_second == fps) return;
+        fps = frames_per_second;
+        restart(now);
+    }
+
+    FrameScheduler::Clock::time_point FrameScheduler::deadline(uint64_t frame) const {
+        const std::chrono::duration<double> offset(static_cast<double>(frame) / fps);
+        return start + std::chrono::duration_cast<Clock::duration>(offset);
+    }
+
+    uint32_t FrameScheduler::due(Clock::time_point now) {
+        if (now < deadline(next)) return 0;
+
+        // Frames that should have started by now: every n with deadline(n) <= now
+        const double elapsed = std::chrono::duration<double>(now - start).count();
+        uint64_t behind = static_cast<uint64_t>(elapsed * fps) + 1;
+        if (behind <= next) behind = next + 1;  // Rounding, deadline(next) <= now says one is due
+
+        uint64_t count = behind - next;
+        if (count > max_catch_up) {
+            // Too far behind to catch up on. The frames run now stand in for frame 0 of a fresh start,
+            // so the next one is due a period from now as if the gap never happened
+            dropped_frames += count - max_catch_up;
+            restart(now);
+            next = 1;
+            return max_catch_up;
+        }
+
+        next = behind;
+        return static_cast<uint32_t>(count);
+    }
+}
@@ -0,0 +1,161 @@
+#include "Input.hpp"
+#include "Chip8/Core.hpp"
+#include <SDL.h>
+#include <iostream>
+
+namespace Chip8 {
+    // Map qwerty keys to Chip8 COSMAC VIP
+    // Chip8 original keypad        QWERTY
+    // 123C                         1234
+    // 456D                         QWER
+    // 789E                         ASDF
+    // A0BF                         ZXCV
+    // Returns -1 for keys that aren't on the keypad
+    static int chip8_key(SDL_Keycode key) {
+        switch (key) {
+            case SDLK_1: return 0x01;
+            case SDLK_2: return 0x02;
+            case SDLK_3: return 0x03;
+            case SDLK_4: return 0x0C;
+
+            case SDLK_q: return 0x04;
+            case SDLK_w: return 0x05;
+            case SDLK_e: return 0x06;
+            case SDLK_r: return 0x0D;
+
+            case SDLK_a: return 0x07;
+            case SDLK_s: return 0x08;
+            case SDLK_d: return 0x09;
+            case SDLK_f: return 0x0E;
+
+            case SDLK_z: return 0x0A;
+            case SDLK_x: return 0x00;
+            case SDLK_c: return 0x0B;
+            case SDLK_v: return 0x0F;
+
+            default: return -1;
+        }
+    }
+
+    // Queue an event for the emulation thread
+    static void send(InputQueue& input, InputEvent::Type type, uint8_t key = 0) {
+        // Only full if the emulation thread stopped draining it, the event is dropped then
+        if (!input.push(InputEvent{type, key})) {
+            std::cerr << "Input queue full, dropping event" << std::endl;
+        }
+    }
+
+    // Handle the input
+    bool handle_input(InputQueue& input, Config& config, bool& redraw) {
+        SDL_Event event;
+
+        while (SDL_PollEvent(&event)) {
+            switch (event.type) {
+                case SDL_QUIT:
+                    // Exit window. End program
+                    std::cout << "=== QUIT ===" << std::endl;
+                    return false;
+
+                case SDL_WINDOWEVENT:
+                    // Uncovered, or back from minimized: the window needs the display drawn again
+                    if (event.window.event == SDL_WINDOWEVENT_EXPOSED) redraw = true;
+                    break;
+
+                case SDL_RENDER_TARGETS_RESET:
+                    // The renderer threw its back buffer away (e.g a Direct3D device lost on resize)
+                    redraw = true;
+                    break;
+
+                case SDL_KEYDOWN:
+                    switch(event.key.keysym.sym) {
+                        case SDLK_ESCAPE:
+                            // Exit window if user presses escape
+                            std::cout << "=== QUIT ===" << std::endl;
+                            return false;
+                    
+                        case SDLK_SPACE:    // Space bar
+                            // Toggle state
+                            send(input, InputEvent::Type::TOGGLE_PAUSE);
+                            break;
+                        
+                        case SDLK_l:
+                            // "l" will reset CHIP8
+                            send(input, InputEvent::Type::RESET);
+                            break;
+                        
+                        case SDLK_F5:
+                            // F5 saves the machine next to the ROM
+                            send(input, InputEvent::Type::SAVE_STATE);
+                            break;
+
+                        case SDLK_F9:
+                            // F9 loads it back
+                            send(input, InputEvent::Type::LOAD_STATE);
+                            break;
+
+                        case SDLK_BACKSPACE:
+                            // Backspace rewinds for as long as it's held
+                            if (event.key.repeat == 0) send(input, InputEvent::Type::REWIND_START);
+                            break;
+
+                        case SDLK_TAB:
+                            // Tab fast-forwards for as long as it's held
+                            if (event.key.repeat == 0) send(input, InputEvent::Type::FAST_FORWARD_START);
+                            break;
+
+                        case SDLK_u:
+                            // "u" switches between normal speed and as fast as the host goes
+                            if (event.key.repeat == 0) send(input, InputEvent::Type::TOGGLE_UNCAPPED);
+                            break;
+
+                        case SDLK_o:
+                            // "o" will decrease volume
+                            if (config.volume > 0) {
+                                std::cout << "\nDECREASE VOLUME to: \n" << std::endl;
+                                config.volume -= 500;
+                                std::cout << config.volume << std::endl;
+                            }
+                            break;
+
+                        case SDLK_p:
+                            // "p" will increase volume
+                            if (config.volume < INT16_MAX) {
+                                std::cout << "\nINCREASE VOLUME to:\n"<< std::endl;
+                                config.volume += 500;
+                                std::cout << config.volume << std::endl;
+                            }
+                            break;
+                        
+                        default: {
+                            // Held keys auto-repeat KEYDOWN, the keypad only needs the first one
+                            const int key = chip8_key(event.key.keysym.sym);
+                            if (key >= 0 && event.key.repeat == 0) {
+                                send(input, InputEvent::Type::KEY_DOWN, static_cast<uint8_t>(key));
+                            }
+                            break;
+                        }
+                    }
+                    break;
+
+                case SDL_KEYUP: {
+                    if (event.key.keysym.sym == SDLK_BACKSPACE) {
+                        send(input, InputEvent::Type::REWIND_STOP);
+                        break;
+                    }
+                    if (event.key.keysym.sym == SDLK_TAB) {
+                        send(input, InputEvent::Type::FAST_FORWARD_STOP);
+                        break;
+                    }
+
+                    const int key = chip8_key(event.key.keysym.sym);
+                    if (key >= 0) {
+                        send(input, InputEvent::Type::KEY_UP, static_cast<uint8_t>(key));
+                    }
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
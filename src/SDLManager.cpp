@@ -1,30 +1,17 @@
 #include "SDLManager.hpp"
+#include "Chip8/Display.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 namespace Chip8 {
     // Fill out stream/audio buffer with data
-    // Audio callback as static member function
-    static void audio_callback(void* userdata, uint8_t* stream, int len) {
-        AudioState* state = static_cast<AudioState*>(userdata);
-
-        const Config& config = *(state->config);
-
-        int16_t* buffer = reinterpret_cast<int16_t*>(stream);
-
-        const int samples = len / sizeof(int16_t);
-
-        const int square_wave_period = config.audio_sample_rate / config.square_wave_freq;
-        const int half_square_wave_period = square_wave_period / 2;
+    void audio_callback(void* userdata, uint8_t* stream, int len) {
+        AudioEngine* audio = static_cast<AudioEngine*>(userdata);
 
         // Filling out 2 bytes at a time(int16_t), len is in bytes, so divide by 2
-        for (int i = 0; i < samples; i++) {
-            if (state->playing_sound) {
-                buffer[i] = ((state->sample_index++ / half_square_wave_period) % 2) ? 
-                             config.volume : -config.volume;
-            } else {
-                buffer[i] = 0; // output silence
-            }
-        }
+        audio->render(reinterpret_cast<int16_t*>(stream), static_cast<size_t>(len) / sizeof(int16_t));
     }
 
     // Custom deleter for SDL_Window using Operator OVERLOADING
@@ -39,6 +26,11 @@ namespace Chip8 {
         if (renderer) SDL_DestroyRenderer(renderer);
     }
 
+    // And SDLTextureDeleter
+    void SDLManager::SDLTextureDeleter::operator()(SDL_Texture* texture) const {
+        if (texture) SDL_DestroyTexture(texture);
+    }
+
     SDLManager::SDLManager(Config& cfg) : config(cfg) {
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) != 0) {
             throw std::runtime_error(SDL_GetError());
@@ -64,12 +56,32 @@ namespace Chip8 {
             SDL_RENDERER_ACCELERATED    // The renderer uses hardware acceleration
         ));
 
+        // No GPU (e.g the dummy video driver the render benchmark runs on), draw in software instead
         if (!renderer) {
+            renderer.reset(SDL_CreateRenderer(window.get(), -1, SDL_RENDERER_SOFTWARE));
+        }
+
+        if (!renderer) {
+            throw std::runtime_error(SDL_GetError());
+        }
+
+        // Streaming texture at CHIP8 resolution, rewritten every frame and stretched over the window
+        // Big enough for SUPER-CHIP hi-res, lo-res frames use its top left 64x32
+        texture.reset(SDL_CreateTexture(
+            renderer.get(),
+            SDL_PIXELFORMAT_RGBA8888,           // Same format as the config colors
+            SDL_TEXTUREACCESS_STREAMING,
+            config.hires_width,
+            config.hires_height));
+
+        if (!texture) {
             throw std::runtime_error(SDL_GetError());
         }
 
-        // Initialize audio state on the heap
-        audio_state = new AudioState{0, &config};
+        // Tone generator for the audio thread, fed sound timer events by the emulation thread
+        audio = std::make_unique<AudioEngine>(config.audio_sample_rate, config.square_wave_freq,
+                                              config.ints_per_second, true, 512);
+        audio->set_volume(config.volume);
 
         SDL_AudioSpec want{};
         want.freq = config.audio_sample_rate;   // 44100hz "CD" quality
@@ -77,16 +89,20 @@ namespace Chip8 {
         want.channels = 1;                      // Mono 1 channel
         want.samples = 512;
         want.callback = audio_callback;
-        want.userdata = audio_state;           // To change volume data or other things, passed to audio callback
-        // Safe as long as config outlives audio_dev
+        want.userdata = audio.get();            // Passed to audio callback
+        // Safe as long as audio outlives audio_dev, which the destructor sees to
 
+        // No allowed changes, SDL converts if the hardware wants something else, so the engine's rate holds
         audio_dev = SDL_OpenAudioDevice(nullptr, 0, &want, nullptr, 0);
 
         if (audio_dev == 0) {
-            delete audio_state;
             // If its not bigger than 0, has an error
             throw std::runtime_error("Failed to open Audio device" + std::string(SDL_GetError()) + "\n");
         }
+
+        // Always playing: silence costs the callback a fill, and the tone starts without the device
+        // having to wake up first
+        SDL_PauseAudioDevice(audio_dev, 0);
     }
 
     // Clear screen / SDL Window to background color
@@ -100,62 +116,179 @@ namespace Chip8 {
         SDL_RenderClear(renderer.get());
     }
 
-    void SDLManager::update_window(const Config config, const Machine machine) {
-        // Initialize rectangle
-        SDL_Rect rect = {.x = 0, 
-            .y = 0, 
-            .w = static_cast<int>(config.scale_factor), 
-            .h = static_cast<int>(config.scale_factor)};
-
-        // Grab color values to draw. Background and foreground rgba
-        const uint8_t bg_r = (config.bg_color >> 24) & 0xFF;
-        const uint8_t bg_g = (config.bg_color >> 16) & 0xFF;
-        const uint8_t bg_b = (config.bg_color >>  8) & 0xFF;
-        const uint8_t bg_a = (config.bg_color >>  0) & 0xFF;
-
-        const uint8_t fg_r = (config.fg_color >> 24) & 0xFF;
-        const uint8_t fg_g = (config.fg_color >> 16) & 0xFF;
-        const uint8_t fg_b = (config.fg_color >>  8) & 0xFF;
-        const uint8_t fg_a = (config.fg_color >>  0) & 0xFF;
-
-        // Loop through all display pixels, draw a rectangle per pixel to the SDL window
-        for (uint32_t i = 0; i < machine.display.size(); i++) {
-            // Translate 1D index i value to 2D X/Y coordinates
-            // (i % config.window_width) -> If window_width is 64, pixels 0–63 are in row 0, 64–127 in row 1, etc.
-            rect.x = (i % config.window_width) * config.scale_factor;   // If i = 70: 70 % 64 = 6 -> column 6.
-            // Get each 64 pixel width row
-            rect.y = (i / config.window_width) * config.scale_factor;   // If i = 70: 70 / 64 = 1 → row 1
-
-            if (machine.display[i]) {
-                // The i pixel in the display is on, draw foreground color
-                SDL_SetRenderDrawColor(renderer.get(), fg_r, fg_g, fg_b, fg_a);
-                SDL_RenderFillRect(renderer.get(), &rect);
-
-                // If user wants pixel outlines
-                if (config.pixel_outlines) {
-                    SDL_SetRenderDrawColor(renderer.get(), bg_r, bg_g, bg_b, bg_a);
-                    SDL_RenderDrawRect(renderer.get(), &rect);
+    // Outline grid the size of the window: transparent inside each CHIP8 pixel, background colored on its border
+    // Blended on top of the display it looks like SDL_RenderDrawRect around every lit pixel
+    // (on unlit pixels it is background on background). Built once and redrawn only if the color
+    // or the resolution changes. Hi-res pixels are half the size, the window stays the same
+    void SDLManager::build_grid(uint32_t color, bool hires) {
+        const uint32_t width = config.window_width * config.scale_factor;
+        const uint32_t height = config.window_height * config.scale_factor;
+        const uint32_t cell = hires ? std::max(1u, config.scale_factor / 2) : config.scale_factor;
+
+        grid.reset(SDL_CreateTexture(renderer.get(), SDL_PIXELFORMAT_RGBA8888,
+                                     SDL_TEXTUREACCESS_STATIC, width, height));
+        if (!grid) {
+            throw std::runtime_error(SDL_GetError());
+        }
+        SDL_SetTextureBlendMode(grid.get(), SDL_BLENDMODE_BLEND);
+
+        std::vector<uint32_t> pixels(width * height, 0);    // 0 is fully transparent
+        for (uint32_t y = 0; y < height; y++) {
+            const bool row_edge = (y % cell == 0) || (y % cell == cell - 1);
+            for (uint32_t x = 0; x < width; x++) {
+                const bool col_edge = (x % cell == 0) || (x % cell == cell - 1);
+                if (row_edge || col_edge) pixels[y * width + x] = color;
+            }
+        }
+
+        SDL_UpdateTexture(grid.get(), nullptr, pixels.data(), width * sizeof(uint32_t));
+        grid_color = color;
+        grid_hires = hires;
+    }
+
+    // Texels for every byte of a packed row, 8 pixels at a time. Copying 32 bytes per 8 pixels makes
+    // a hi-res frame cost about what a lo-res one did when it was expanded a pixel at a time
+    void SDLManager::build_texel_table(uint32_t fg, uint32_t bg) {
+        for (uint32_t byte = 0; byte < texel_table.size(); byte++) {
+            for (uint32_t x = 0; x < 8; x++) {
+                texel_table[byte][x] = ((byte >> (7 - x)) & 1) ? fg : bg;
+            }
+        }
+        texel_fg = fg;
+        texel_bg = bg;
+    }
+
+    // One row with more than plane 0 lit, 8 pixels at a time. Each plane's byte is spread out to a bit
+    // per nibble, so the four of them OR together into eight 4 bit palette indices
+    void SDLManager::draw_planes_row(const Frame& frame, uint32_t y, uint32_t width,
+                                     const std::array<uint32_t, 16>& palette, uint32_t* dst) {
+        static const std::array<uint32_t, 256> spread = [] {
+            std::array<uint32_t, 256> table{};
+            for (uint32_t byte = 0; byte < table.size(); byte++) {
+                for (uint32_t x = 0; x < 8; x++) table[byte] |= ((byte >> (7 - x)) & 1) << (4 * x);
+            }
+            return table;
+        }();
+
+        for (uint32_t word = 0; word < width / 64; word++) {
+            for (uint32_t b = 0; b < 8; b++) {
+                const uint32_t shift = 56 - 8 * b;
+                uint32_t indices = 0;
+                for (uint32_t p = 0; p < frame.plane_count; p++) {
+                    indices |= spread[(frame.planes[p][y][word] >> shift) & 0xFF] << p;
+                }
+                for (uint32_t x = 0; x < 8; x++) *dst++ = palette[(indices >> (4 * x)) & 0xF];
+            }
+        }
+    }
+
+    void SDLManager::update_window(const Frame& frame) {
+        // Nothing published since the last present, what's on screen is still right
+        if (frame.sequence == shown_sequence && !stale) {
+            ++skipped;
+            return;
+        }
+
+        // dirty_rows is relative to the previous frame, if that one was never shown everything is redrawn
+        // A resolution switch always dirties every row, so the new size is drawn in full, and so is a stale window
+        const uint32_t width = display_width(frame.hires);
+        const uint32_t height = display_height(frame.hires);
+        const uint64_t dirty_rows = ((frame.sequence == shown_sequence + 1 && !stale) ? frame.dirty_rows : ALL_ROWS)
+                                    & active_rows(frame.hires);
+
+        // Only the span of rows from the first to the last dirty one goes to the texture
+        // publish() never hands over a frame without a dirty row, but a hand made one could be
+        if (dirty_rows != 0) {
+            uint32_t first = 0;
+            while (!((dirty_rows >> first) & 1)) first++;
+            uint32_t last = height - 1;
+            while (!((dirty_rows >> last) & 1)) last--;
+
+            // Expand the packed framebuffer into the streaming texture, one RGBA8888 texel per CHIP8 pixel
+            const SDL_Rect span = {0, static_cast<int>(first), static_cast<int>(width), static_cast<int>(last - first + 1)};
+            void* texels = nullptr;
+            int pitch = 0;
+            if (SDL_LockTexture(texture.get(), &span, &texels, &pitch) != 0) {
+                throw std::runtime_error(SDL_GetError());
+            }
+
+            if (texel_fg != config.fg_color || texel_bg != config.bg_color) {
+                build_texel_table(config.fg_color, config.bg_color);
+            }
+
+            // XO-CHIP colors: index 0 is the background, 1 the foreground (plane 0 alone) and the
+            // other plane combinations take config.plane_colors
+            std::array<uint32_t, 16> palette{};
+            if (frame.plane_count > 1) {
+                palette[0] = config.bg_color;
+                palette[1] = config.fg_color;
+                std::copy(config.plane_colors.begin(), config.plane_colors.end(), palette.begin() + 2);
+            }
+
+            for (uint32_t y = first; y <= last; y++) {
+                uint8_t* dst = static_cast<uint8_t*>(texels) + (y - first) * pitch;
+
+                // A row only plane 0 has anything on is drawn like a monochrome one below
+                bool colored = false;
+                for (uint32_t p = 1; p < frame.plane_count; p++) {
+                    colored |= (frame.planes[p][y][0] | frame.planes[p][y][1]) != 0;
+                }
+                if (colored) {
+                    draw_planes_row(frame, y, width, palette, reinterpret_cast<uint32_t*>(dst));
+                    continue;
                 }
 
-            } else {
-                // The pixel is off, draw the background color
-                SDL_SetRenderDrawColor(renderer.get(), bg_r, bg_g, bg_b, bg_a);
-                SDL_RenderFillRect(renderer.get(), &rect);
+                // Rows are packed 64 pixels to a uint64_t, column 0 in the top bit. Lo-res uses the first word only
+                // Each byte of a row is 8 texels straight out of the table, top byte first
+                for (uint32_t word = 0; word < width / 64; word++) {
+                    const uint64_t row = frame.planes[0][y][word];
+                    for (uint32_t b = 0; b < 8; b++) {
+                        const auto& texels8 = texel_table[(row >> (56 - 8 * b)) & 0xFF];
+                        std::memcpy(dst, texels8.data(), sizeof(texels8));
+                        dst += sizeof(texels8);
+                    }
+                }
             }
+
+            SDL_UnlockTexture(texture.get());
+        }
+
+        // One copy scales the part in use up to the whole window, nearest neighbour keeps the pixels sharp
+        const SDL_Rect source = {0, 0, static_cast<int>(width), static_cast<int>(height)};
+        SDL_RenderCopy(renderer.get(), texture.get(), &source, nullptr);
+
+        // If user wants pixel outlines
+        if (config.pixel_outlines) {
+            if (!grid || grid_color != config.bg_color || grid_hires != frame.hires) {
+                build_grid(config.bg_color, frame.hires);
+            }
+            SDL_RenderCopy(renderer.get(), grid.get(), nullptr, nullptr);
         }
 
         SDL_RenderPresent(renderer.get());
+        shown_sequence = frame.sequence;
+        stale = false;
+        ++presented;
     }
 
     void SDLManager::handle_audio(const Machine& machine) {
-        if (machine.sound_timer > 0 && !audio_state->playing_sound) {
-            SDL_PauseAudioDevice(audio_dev, 0); // Play
-            audio_state->playing_sound = true;
+        audio->track(machine);
+    }
+
+    void SDLManager::set_volume(int16_t volume) {
+        audio->set_volume(volume);
+    }
 
-        } else if (machine.sound_timer == 0 && audio_state->playing_sound) {
-            SDL_PauseAudioDevice(audio_dev, 1); // Pause
-            audio_state->playing_sound = false;
+    int SDLManager::refresh_rate() const {
+        SDL_DisplayMode mode{};
+        if (SDL_GetWindowDisplayMode(window.get(), &mode) == 0 && mode.refresh_rate > 0) {
+            return mode.refresh_rate;
         }
+        return 60;  // Unknown (0) on some drivers, CHIP8's own 60hz is the best guess
+    }
+
+    void SDLManager::set_title(const std::string& title) {
+        SDL_SetWindowTitle(window.get(), title.c_str());
     }
 
     // Function Destructor
@@ -164,9 +297,14 @@ namespace Chip8 {
         if (audio_dev != 0) {
             SDL_CloseAudioDevice(audio_dev);
         }
-        delete audio_state;
+        audio.reset();
+
+        // Textures and renderer have to go before SDL_Quit, so release them here instead of after the body
+        grid.reset();
+        texture.reset();
+        renderer.reset();
+        window.reset();
 
-        // Cleanup handled automatically by unique_ptr's custom deleter
         SDL_Quit();
     }
 }
\ No newline at end of file
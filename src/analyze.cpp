@@ -0,0 +1,77 @@
+// chip8-analyze: static analysis of a ROM without running it. Prints a summary, optionally writes an
+// assembly listing, and writes the code map the emulator loads to decode and compile ahead of the PC
+// Usage: chip8-analyze [--quirks modern|xochip|vip|schip] [--xochip] [--listing file|-] [--map file] <rom>
+// The map goes next to the ROM (rom.c8map), where chip8 looks for it, unless --map says otherwise
+#include "Chip8/Analyzer.hpp"
+#include "Chip8/Core.hpp"
+#include "Chip8/RomCache.hpp"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    try {
+        bool quirks_set = false;
+        Chip8::Quirks quirks = Chip8::Quirks::MODERN;
+        std::string listing_path;
+        std::string map_path;
+        const char* rom_path = nullptr;
+
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "--quirks" && i + 1 < argc) {
+                if (!Chip8::parse_quirks(argv[++i], quirks)) {
+                    std::cerr << "Unknown quirk profile " << argv[i] << ", expected modern, xochip, vip or schip" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                quirks_set = true;
+            } else if (arg == "--xochip") {
+                quirks = Chip8::Quirks::XOCHIP;
+                quirks_set = true;
+            } else if (arg == "--listing" && i + 1 < argc) {
+                listing_path = argv[++i];
+            } else if (arg == "--map" && i + 1 < argc) {
+                map_path = argv[++i];
+            } else {
+                rom_path = argv[i];
+            }
+        }
+
+        if (rom_path == nullptr) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--quirks modern|xochip|vip|schip] [--xochip] [--listing file|-] [--map file] <rom>" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // Same profile the emulator would pick, so the map matches the machine that loads it
+        if (!quirks_set) quirks = Chip8::rom_quirks(rom_path);
+        if (map_path.empty()) map_path = Chip8::code_map_path(rom_path);
+
+        const auto image = Chip8::rom_cache().load(rom_path, quirks == Chip8::Quirks::XOCHIP);
+        const Chip8::RomAnalysis analysis = Chip8::analyze_rom(*image, quirks);
+
+        if (listing_path == "-") {
+            Chip8::write_listing(std::cout, analysis, *image);
+            std::cout << std::endl;
+        } else if (!listing_path.empty()) {
+            std::ofstream out(listing_path);
+            if (!out) {
+                throw std::runtime_error("Failed to open " + listing_path);
+            }
+            Chip8::write_listing(out, analysis, *image);
+        }
+
+        const Chip8::CodeMap map = Chip8::code_map(analysis);
+        Chip8::save_code_map(map, map_path);
+
+        Chip8::write_summary(std::cout, analysis);
+        if (!listing_path.empty() && listing_path != "-") std::cout << "Listing written to " << listing_path << "\n";
+        std::cout << "Code map (" << map.instructions.size() << " instructions, " << map.blocks.size()
+                  << " blocks) written to " << map_path << std::endl;
+        return EXIT_SUCCESS;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
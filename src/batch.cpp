@@ -0,0 +1,84 @@
+// chip8-batch: run a job list of headless machines across all cores and write a results file
+// Usage: chip8-batch [--threads N] [--output results.tsv] <job_list>
+#include "Chip8/Batch.hpp"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std::chrono;
+
+int main(int argc, char* argv[]) {
+    try {
+        unsigned threads = 0;
+        std::string output = "results.tsv";
+        const char* job_list = nullptr;
+
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "--threads" && i + 1 < argc) {
+                threads = static_cast<unsigned>(std::stoul(argv[++i]));
+            } else if (arg == "--output" && i + 1 < argc) {
+                output = argv[++i];
+            } else {
+                job_list = argv[i];
+            }
+        }
+
+        if (job_list == nullptr) {
+            std::cerr << "Usage: " << argv[0] << " [--threads N] [--output results.tsv] <job_list>" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const std::vector<Chip8::BatchJob> jobs = Chip8::load_job_list(job_list);
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+        const auto start = steady_clock::now();
+        const std::vector<Chip8::BatchResult> results = Chip8::run_batch(jobs, threads);
+        const double elapsed = duration<double>(steady_clock::now() - start).count();
+
+        // Tab separated, one line per job in job list order
+        std::ofstream out(output);
+        if (!out) {
+            throw std::runtime_error("Failed to open " + output);
+        }
+
+        out << "job\trom\tquirks\tips\tseed\tinput\tframes\tcycles\tframebuffer_hash\twall_seconds\terror\n";
+
+        uint64_t total_cycles = 0;
+        double job_seconds = 0.0;
+        size_t failed = 0;
+
+        for (size_t i = 0; i < jobs.size(); i++) {
+            const Chip8::BatchJob& job = jobs[i];
+            const Chip8::BatchResult& result = results[i];
+
+            out << i << '\t' << job.rom_path << '\t' << Chip8::quirks_name(job.quirks) << '\t' << job.config.ints_per_second << '\t' << job.seed << '\t'
+                << (job.input_path.empty() ? "-" : job.input_path) << '\t'
+                << result.frames << '\t' << result.cycles << '\t'
+                << std::hex << std::setw(16) << std::setfill('0') << result.framebuffer_hash
+                << std::dec << std::setfill(' ') << '\t'
+                << std::fixed << std::setprecision(6) << result.wall_seconds << std::defaultfloat << '\t'
+                << (result.error.empty() ? "-" : result.error) << '\n';
+
+            total_cycles += result.cycles;
+            job_seconds += result.wall_seconds;
+            if (!result.error.empty()) failed++;
+        }
+
+        std::cout << "Jobs: " << jobs.size() << " (" << failed << " failed)\n"
+                  << "Threads: " << threads << "\n"
+                  << "Wall time: " << elapsed << " s\n"
+                  << "Speedup over serial: " << (elapsed > 0 ? job_seconds / elapsed : 0.0) << "x\n"
+                  << "MIPS: " << (elapsed > 0 ? total_cycles / elapsed / 1e6 : 0.0) << "\n"
+                  << "Results: " << output << std::endl;
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -1,22 +1,469 @@
 #include "SDLManager.hpp"
+#include "Input.hpp"
 #include "Chip8.hpp"
+#include "Chip8/Analyzer.hpp"
+#include "Chip8/Audio.hpp"
+#include "Chip8/Core.hpp"
+#include "Chip8/Frame.hpp"
+#include "Chip8/Jit.hpp"
+#include "Chip8/Movie.hpp"
+#include "Chip8/Profiler.hpp"
+#include "Chip8/Rewind.hpp"
+#include "Chip8/Scheduler.hpp"
 // std::cout and such
 #include <iostream>
+#include <fstream>
+#include <string>
 #include <time.h>
 #include <chrono> // For precise timing
+#include <algorithm>
+#include <cstdio>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
 
 using namespace std::chrono;
 
+// Decode (and with a JIT, compile) the code in the ROM's code map before the first instruction runs,
+// instead of as the PC first gets to it. An explicit --code-map has to load and match the ROM, the
+// one chip8-analyze leaves next to the ROM is skipped with a warning if it's stale
+static void load_code_map(Chip8::Machine& machine, const std::string& path, bool required, Chip8::Jit* jit) {
+    if (!required && !std::ifstream(path)) return;
+
+    try {
+        auto map = std::make_shared<const Chip8::CodeMap>(Chip8::load_code_map(path));
+        size_t decoded = 0;
+        try {
+            decoded = Chip8::prewarm_decode_cache(machine, *map);
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+        const uint64_t compiled = jit ? jit->precompile(machine, map->blocks) : 0;
+        machine.code_map = std::move(map);  // For resets, see reset_chip8()
+        std::cout << "Code map: " << decoded << " instructions decoded, " << compiled
+                  << " blocks compiled ahead from " << path << std::endl;
+    } catch (const std::runtime_error& e) {
+        if (required) throw;
+        std::cerr << "Code map not used, " << e.what() << std::endl;
+    }
+}
+
+// Run the ROM without a window, audio device or event pump, then print a summary
+static int run_headless(const Config& config, const char* rom_path, Chip8::Quirks quirks, uint64_t cycles, uint32_t seed,
+                        Chip8::Jit* jit, Chip8::Profiler* profiler, const std::string& audio_path,
+                        const std::string& map_path, bool map_required) {
+    Chip8::Machine machine;
+    machine.quirks = quirks;
+    Chip8::load_rom(machine, rom_path);
+    load_code_map(machine, map_path, map_required, jit);
+    machine.profiler = profiler;
+
+    // Seed random number generator
+    Chip8::seed_random(machine, seed);
+
+    // The tone on the emulated timeline, sample exact, for --audio
+    std::unique_ptr<Chip8::AudioEngine> audio;
+    std::vector<int16_t> samples;
+    if (!audio_path.empty()) {
+        audio = std::make_unique<Chip8::AudioEngine>(config.audio_sample_rate, config.square_wave_freq,
+                                                     config.ints_per_second, false);
+        audio->set_volume(config.volume);
+    }
+
+    const auto start = steady_clock::now();
+
+    // Whole 60hz frames keep the timers ticking like they would with a window,
+    // the last frame is cut short so exactly `cycles` instructions are executed
+    while (machine.cycles < cycles && machine.state != Chip8::EmulatorState::QUIT) {
+        const uint64_t left = cycles - machine.cycles;
+        const uint64_t frame = Chip8::frame_cycles(machine, config);
+        Chip8::run_cycles(machine, config, std::min(left, frame), jit);
+        if (audio) audio->track(machine);
+
+        if (left >= frame) {
+            Chip8::tick_timers(machine);
+            if (audio) audio->track(machine);
+        }
+        if (audio) audio->render_until(machine.cycles, samples);
+    }
+
+    const double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    if (audio) {
+        Chip8::write_wav(audio_path, samples, config.audio_sample_rate);
+        std::cout << "Audio: " << samples.size() << " samples written to " << audio_path << "\n";
+    }
+
+    std::cout << "Cycles: " << machine.cycles << "\n"
+              << "Idle cycles skipped: " << machine.idle_cycles << "\n"
+              << "Frames: " << machine.frames << "\n"
+              << "Wall time: " << elapsed << " s\n"
+              << "MIPS: " << (elapsed > 0 ? machine.cycles / elapsed / 1e6 : 0.0) << "\n"
+              << "Framebuffer hash: 0x" << std::hex << Chip8::framebuffer_hash(machine)
+              << std::dec << std::endl;
+    return EXIT_SUCCESS;
+}
+
+// Replay a recorded movie headless, as fast as the host goes, and check it ends where the recording did
+static int run_replay(const Config& config, const char* rom_path, Chip8::Quirks quirks, const std::string& movie_path,
+                      Chip8::Jit* jit, Chip8::Profiler* profiler, const std::string& map_path, bool map_required) {
+    const Chip8::Movie movie = Chip8::load_movie(movie_path);
+
+    Chip8::Machine machine;
+    machine.quirks = quirks;
+    Chip8::load_rom(machine, rom_path);
+    load_code_map(machine, map_path, map_required, jit);
+    machine.profiler = profiler;
+
+    const auto start = steady_clock::now();
+    const bool same = Chip8::replay_movie(machine, config, movie, jit);
+    const double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    std::cout << "Cycles: " << machine.cycles << "\n"
+              << "Idle cycles skipped: " << machine.idle_cycles << "\n"
+              << "Frames: " << machine.frames << "\n"
+              << "Input events: " << movie.events.size() << "\n"
+              << "Wall time: " << elapsed << " s\n"
+              << "MIPS: " << (elapsed > 0 ? machine.cycles / elapsed / 1e6 : 0.0) << "\n"
+              << "Framebuffer hash: 0x" << std::hex << Chip8::framebuffer_hash(machine) << std::dec << "\n"
+              << "Replay: " << (same ? "matches the recording" : "DIFFERS from the recording") << std::endl;
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// How fast the emulation thread runs the machine
+enum class Speed : uint8_t {
+    NORMAL,         // config.ints_per_second on the wall clock
+    FAST_FORWARD,   // config.fast_forward times that, while Tab is held
+    UNCAPPED,       // As fast as the host goes
+};
+
+// Everything the emulation thread and the render thread share
+struct EmulationLink {
+    Chip8::InputQueue input;            // Render thread -> emulation thread
+    Chip8::FrameHandoff frames;         // Emulation thread -> render thread
+    std::atomic<bool> running{true};    // Cleared by the emulation thread when it stops
+    std::exception_ptr error;           // Why it stopped, if it threw. Written before running is cleared
+
+    double refresh_period = 1.0 / 60;   // Seconds per display refresh, frames aren't published faster than this
+    std::atomic<Speed> speed{Speed::NORMAL};    // Emulation thread -> window title
+    std::atomic<double> ips{0.0};               // Emulated instructions per second, over the last second
+};
+
+// Emulation thread: input events, instructions, timers and audio at the configured rate,
+// then a frame for the render thread. Never waits on the renderer
+// With a movie, every key change and timer tick is recorded into it until the run can no longer be
+// replayed from the start (reset, state load, rewind)
+// Runs whole frames, frame_cycles() instructions and then a timer tick, so the timers follow the
+// emulated CPU instead of the wall clock at every speed
+static void emulation_thread(Chip8::Machine& machine, const Config& config, Chip8::Jit* jit,
+                             Chip8::SDLManager& sdl, EmulationLink& link, Chip8::Movie* movie, bool uncapped) {
+    auto stop_recording = [&](const char* why) {
+        if (movie == nullptr) return;
+        Chip8::end_movie(*movie, machine);
+        movie = nullptr;
+        std::cout << "=== RECORDING STOPPED (" << why << ") ===" << std::endl;
+    };
+
+    try {
+        // CHIP-8 timers always tick at 60Hz, because the CRT TV was 60HZ back then
+        // Everything is paced in these frames: frame_cycles() instructions (ints_per_second / 60) as one
+        // batch, then one timer tick, then sleep until the next frame is due
+        const int timer_hz = 60;
+
+        // The last minute of play, a state per 60hz tick. While rewind is held the ticks step
+        // back through it instead of running the machine
+        Chip8::RewindBuffer rewind(60 * timer_hz);
+        bool rewinding = false;
+
+        // A 60hz timer tick, or while rewinding a step back instead
+        // `snapshot` stores the state for rewinding, turbo speeds only keep some of their frames
+        auto timer_tick = [&](bool snapshot) {
+            if (rewinding) {
+                // Back one frame per tick. The keypad stays as the player holds it now
+                const auto keypad = machine.keypad;
+                rewind.rewind(machine);
+                machine.keypad = keypad;
+            } else {
+                // Decrement the delay and sound timers if they're above 0
+                Chip8::tick_timers(machine);
+                if (movie) Chip8::record_tick(*movie, machine);
+
+                // Delta against the last keyframe, usually tens of bytes (see bench/rewind_bench)
+                if (snapshot) rewind.push(machine);
+            }
+
+            // call to play or pause
+            sdl.handle_audio(machine);
+        };
+
+        // One frame: its instructions and then its tick. While rewinding only the tick, which steps back
+        auto emulate_frame = [&](bool snapshot) {
+            if (!rewinding) {
+                Chip8::run_cycles(machine, config, Chip8::frame_cycles(machine, config), jit);
+                // FX18 in this frame, stamped before the tick so even a 1 tick beep is heard
+                sdl.handle_audio(machine);
+            }
+            timer_tick(snapshot);
+        };
+
+        // Normal and fast-forward speed go by the scheduler, 60 or fast_forward * 60 frames a second.
+        // Uncapped runs frames back to back. Rewinding always steps back at 60
+        Chip8::FrameScheduler scheduler(timer_hz);
+        bool fast_forward = false;
+        const std::chrono::duration<double> refresh_period(link.refresh_period);
+        auto next_publish = steady_clock::now();
+
+        auto update_speed = [&]() {
+            const Speed speed = uncapped ? Speed::UNCAPPED : fast_forward ? Speed::FAST_FORWARD : Speed::NORMAL;
+            link.speed.store(speed, std::memory_order_relaxed);
+
+            const bool faster = speed == Speed::FAST_FORWARD && !rewinding;
+            scheduler.set_rate(faster ? timer_hz * config.fast_forward : timer_hz, steady_clock::now());
+        };
+        update_speed();
+
+        // Achieved speed, measured over a second at a time
+        auto mips_start = steady_clock::now();
+        uint64_t mips_cycles = machine.cycles;
+
+        // Main emulator Loop
+        while (true) {
+            // Keys, pause, reset and quit from the render thread
+            Chip8::InputEvent event;
+            while (link.input.pop(event)) {
+                switch (event.type) {
+                    case Chip8::InputEvent::Type::KEY_DOWN:
+                    case Chip8::InputEvent::Type::KEY_UP:
+                        if (movie) Chip8::record_key(*movie, machine, event.key, event.type == Chip8::InputEvent::Type::KEY_DOWN);
+                        break;
+                    case Chip8::InputEvent::Type::RESET:
+                        stop_recording("reset");
+                        break;
+                    case Chip8::InputEvent::Type::LOAD_STATE:
+                        stop_recording("state loaded");
+                        break;
+                    case Chip8::InputEvent::Type::REWIND_START:
+                        stop_recording("rewind");
+                        break;
+                    default:
+                        break;
+                }
+
+                if (event.type == Chip8::InputEvent::Type::REWIND_START) rewinding = true;
+                else if (event.type == Chip8::InputEvent::Type::REWIND_STOP) rewinding = false;
+                else if (event.type == Chip8::InputEvent::Type::FAST_FORWARD_START) fast_forward = true;
+                else if (event.type == Chip8::InputEvent::Type::FAST_FORWARD_STOP) fast_forward = false;
+                else if (event.type == Chip8::InputEvent::Type::TOGGLE_UNCAPPED) uncapped = !uncapped;
+                else Chip8::apply_input(machine, event);
+
+                // The reset prewarmed the decode cache again but dropped the JIT's blocks with it
+                if (event.type == Chip8::InputEvent::Type::RESET && jit && machine.code_map) {
+                    jit->precompile(machine, machine.code_map->blocks);
+                }
+            }
+            update_speed();
+
+            if (machine.state == Chip8::EmulatorState::QUIT) break;
+
+            if (machine.state == Chip8::EmulatorState::PAUSED) {
+                // The tone stops while paused, and picks up again on resume
+                sdl.handle_audio(machine);
+
+                // Sleep a bit to avoid 100% CPU usage
+                std::this_thread::sleep_for(milliseconds(10));
+
+                // Time spent paused isn't owed to the CPU, don't catch up on it after resuming
+                const auto now = steady_clock::now();
+                scheduler.restart(now);
+                mips_start = now;
+                mips_cycles = machine.cycles;
+                continue;
+            }
+
+            const auto now = steady_clock::now();
+            const Speed speed = link.speed.load(std::memory_order_relaxed);
+
+            // Uncapped, a ROM waiting on a key would only spin through its wait loop as fast as the host
+            // goes, so until it stops waiting it runs at the normal pace and the thread sleeps between frames
+            const bool paced = speed != Speed::UNCAPPED || rewinding || machine.idle == Chip8::IdleWait::INPUT;
+
+            bool ran = false;
+            if (!paced) {
+                // Frames back to back for a display refresh, then input and the next frame to show
+                // A frame is only ~12 instructions at 700hz, so the clock is read every few frames and
+                // rewind gets the last frame of the slice: a snapshot per frame would cost more than the frames
+                const auto slice_end = now + refresh_period;
+                do {
+                    for (int i = 0; i < 16; i++) emulate_frame(false);
+                } while (steady_clock::now() < slice_end && machine.idle != Chip8::IdleWait::INPUT);
+                rewind.push(machine);
+                scheduler.restart(steady_clock::now());
+                ran = true;
+            } else {
+                // Fast-forward keeps one of every fast_forward frames for rewind, still 60 a second
+                const uint32_t frames = scheduler.due(now);
+                for (uint32_t f = 0; f < frames; f++) {
+                    const bool snapshot = speed != Speed::FAST_FORWARD || machine.frames % config.fast_forward == 0;
+                    emulate_frame(snapshot);
+                }
+                ran = frames > 0;
+            }
+
+            // Hand the display to the render thread, copies nothing if no row changed
+            // No more often than the display refreshes, frames in between would never be seen
+            if (ran && now >= next_publish) {
+                link.frames.publish(machine);
+                next_publish += std::chrono::duration_cast<steady_clock::duration>(refresh_period);
+                if (next_publish < now) next_publish = now;
+            }
+
+            if (now - mips_start >= seconds(1)) {
+                // Rewinding and state loads move cycles back, that isn't speed
+                const uint64_t instructions = machine.cycles >= mips_cycles ? machine.cycles - mips_cycles : 0;
+                link.ips.store(instructions / duration<double>(now - mips_start).count(), std::memory_order_relaxed);
+                mips_start = now;
+                mips_cycles = machine.cycles;
+            }
+
+            // Nothing to do until the next frame is due, sleep until then instead of polling
+            // Input waits for the next frame too, it couldn't change anything before that frame ran
+            if (paced) {
+                std::this_thread::sleep_until(scheduler.next_deadline());
+            }
+        }
+        stop_recording("quit");
+    } catch (...) {
+        link.error = std::current_exception();
+    }
+
+    link.running.store(false, std::memory_order_release);
+}
+
 int main(int argc, char* argv[]) {
     try {
+        // Get initial config
+        Config config;
+
+        // Parse command line: [--headless] [--cycles N] [--jit] [--seed N] [--record movie] [--replay movie]
+        //                     [--profile report] [--uncapped] [--fast-forward N] [--no-idle-skip]
+        //                     [--audio out.wav] [--quirks modern|xochip|vip|schip] [--xochip] [--code-map file]
+        //                     <rom_path>
+        bool headless = false;
+        bool quirks_set = false;
+        Chip8::Quirks quirks = Chip8::Quirks::MODERN;
+        bool use_jit = false;
+        bool uncapped = false;
+        uint64_t headless_cycles = config.ints_per_second * 60ULL; // Default to one emulated minute
+        uint32_t seed = static_cast<uint32_t>(time(NULL));
+        std::string record_path;
+        std::string replay_path;
+        std::string profile_path;
+        std::string audio_path;
+        std::string map_path;
+        const char* rom_path = nullptr;
+
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "--headless") {
+                headless = true;
+            } else if (arg == "--cycles" && i + 1 < argc) {
+                headless_cycles = std::stoull(argv[++i]);
+            } else if (arg == "--jit") {
+                use_jit = true;
+            } else if (arg == "--seed" && i + 1 < argc) {
+                seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--record" && i + 1 < argc) {
+                record_path = argv[++i];
+            } else if (arg == "--replay" && i + 1 < argc) {
+                replay_path = argv[++i];
+            } else if (arg == "--profile" && i + 1 < argc) {
+                profile_path = argv[++i];
+            } else if (arg == "--uncapped") {
+                uncapped = true;
+            } else if (arg == "--fast-forward" && i + 1 < argc) {
+                config.fast_forward = static_cast<uint32_t>(std::max(1ul, std::stoul(argv[++i])));
+            } else if (arg == "--audio" && i + 1 < argc) {
+                audio_path = argv[++i];
+            } else if (arg == "--no-idle-skip") {
+                config.skip_idle = false;
+            } else if (arg == "--quirks" && i + 1 < argc) {
+                if (!Chip8::parse_quirks(argv[++i], quirks)) {
+                    std::cerr << "Unknown quirk profile " << argv[i] << ", expected modern, xochip, vip or schip" << std::endl;
+                    return EXIT_FAILURE;
+                }
+                quirks_set = true;
+            } else if (arg == "--xochip") {
+                quirks = Chip8::Quirks::XOCHIP;
+                quirks_set = true;
+            } else if (arg == "--code-map" && i + 1 < argc) {
+                map_path = argv[++i];
+            } else {
+                rom_path = argv[i];
+            }
+        }
+
         // Check for ROM argument FIRST before any initialization
-        if (argc < 2) {
-            std::cerr << "Usage: " << argv[0] << " <rom_path>" << std::endl;
+        if (rom_path == nullptr) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--headless] [--cycles N] [--jit] [--seed N] [--record movie] [--replay movie]"
+                      << " [--profile report] [--uncapped] [--fast-forward N] [--no-idle-skip]"
+                      << " [--audio out.wav] [--quirks modern|xochip|vip|schip] [--xochip] [--code-map file]"
+                      << " <rom_path>" << std::endl;
             return EXIT_FAILURE;  // Exit immediately
         }
 
-        // Get initial config
-        Config config;
+        // .xo8 ROMs don't need the flag, they get the XO-CHIP profile unless another one was asked for
+        if (!quirks_set) quirks = Chip8::rom_quirks(rom_path);
+
+        // chip8-analyze's code map for the ROM, when there is one
+        const bool map_required = !map_path.empty();
+        if (!map_required) map_path = Chip8::code_map_path(rom_path);
+
+        // Recompile to native code instead of interpreting, when the host supports it
+        std::unique_ptr<Chip8::Jit> jit;
+        if (use_jit) {
+            if (Chip8::Jit::supported()) {
+                jit = std::make_unique<Chip8::Jit>();
+            } else {
+                std::cerr << "JIT not supported on this host, interpreting" << std::endl;
+            }
+        }
+
+        // Guest profile of the whole run, written out when it ends. The ROM is interpreted while profiling
+        std::unique_ptr<Chip8::Profiler> profiler;
+        if (!profile_path.empty()) {
+            if (!CHIP8_PROFILER) {
+                std::cerr << "Profiler compiled out (PROFILER=0), --profile ignored" << std::endl;
+            } else {
+                profiler = std::make_unique<Chip8::Profiler>();
+            }
+        }
+
+        // Report the profile however the run ended
+        auto save_profile = [&]() {
+            if (!profiler) return;
+            profiler->save(profile_path);
+            std::cout << "Profile (" << profiler->instructions() << " instructions) saved to " << profile_path
+                      << " and " << profile_path << ".folded" << std::endl;
+        };
+
+        if (!replay_path.empty()) {
+            const int result = run_replay(config, rom_path, quirks, replay_path, jit.get(), profiler.get(), map_path, map_required);
+            save_profile();
+            return result;
+        }
+
+        if (!audio_path.empty() && !headless) {
+            std::cerr << "--audio writes the sound of a --headless run, ignored" << std::endl;
+        }
+
+        if (headless) {
+            const int result = run_headless(config, rom_path, quirks, headless_cycles, seed, jit.get(), profiler.get(), audio_path,
+                                            map_path, map_required);
+            save_profile();
+            return result;
+        }
 
         // Initialize SDL with RAII
         Chip8::SDLManager sdl(config);
@@ -24,106 +471,103 @@ int main(int argc, char* argv[]) {
 
         // Initialize chip8
         Chip8::Machine machine;
-        init_chip8(machine, argv[1]);
+        machine.quirks = quirks;
+        init_chip8(machine, rom_path);
+        load_code_map(machine, map_path, map_required, jit.get());
+        machine.profiler = profiler.get();
         
         // Initial screen clear
         sdl.clear_window();
 
         // Seed random number generator
-        srand(time(NULL));
+        Chip8::seed_random(machine, seed);
 
-        // Timing variables (local to main)
-        // CHIP-8 Timers run at 60 Hz, independent of the CPU speed/frame rate
-        // These variables store the last time we updated the timers and ran a CPU instruction
-        // auto last_timer_tick = steady_clock::now();
-        auto last_loop_time = steady_clock::now();
+        // Recording starts before the first instruction, so the movie replays from a fresh load
+        Chip8::Movie movie;
+        if (!record_path.empty()) Chip8::start_movie(movie, machine);
 
-        // How many instructions per second you want to execute (configurable)
-        const int cpu_hz = config.ints_per_second;
+        // The core runs on its own thread so a slow SDL_RenderPresent (vsync, compositor stalls)
+        // can't hold up emulation. This thread keeps SDL events and rendering, which SDL wants on the main thread
+        EmulationLink link;
+        link.refresh_period = 1.0 / sdl.refresh_rate();
+        std::thread emulation(emulation_thread, std::ref(machine), std::cref(config), jit.get(),
+                              std::ref(sdl), std::ref(link), record_path.empty() ? nullptr : &movie, uncapped);
 
-        // CHIP-8 timers always tick at 60Hz, because the CRT TV was 60HZ back then
-        const int timer_hz = 60;
-
-        // How much time (in seconds) should pass between each CPU instruction or timer tick
-        // for 60HZ it is 16.67ms
-        double cpu_period = 1.0 / cpu_hz;       // Seconds per CPU instruction
-        double timer_period = 1.0 / timer_hz;   // Seconds per timer tick (should be ~0.01667)
-
-        // These track the fractional time that has passed, 
-        // so it runs the right number of instructions/timer ticks 
-        // even if the loop timing is not perfectly regular.
-        // Accumulators
-        double cpu_accum = 0.0;
-        double timer_accum = 0.0;
-        
-        // Main emulator Loop
-        // Chip8 has an instruction to conditionally clear the screen
-        while (machine.state != Chip8::EmulatorState::QUIT) {
-            // Time for input
-            handle_input(machine, config);
-
-            if (machine.state == Chip8::EmulatorState::PAUSED){
-                // Sleep a bit to avoid 100% CPU usage
-                SDL_Delay(10);
-                continue;
+        // Ask the emulation thread to QUIT (unless it already stopped) and wait for it
+        auto stop_emulation = [&]() {
+            while (link.running.load(std::memory_order_acquire) &&
+                   !link.input.push(Chip8::InputEvent{Chip8::InputEvent::Type::QUIT, 0})) {
+                SDL_Delay(1);
             }
+            emulation.join();
+        };
 
-            // Calculate elapsed time
-            // Get the current time point (high-resolution, monotonic clock)
-            auto now = steady_clock::now();
-
-            // Calculate how much time (in seconds
-            // (now - last_cpu_tick gives a duration; duration<double> converts it to seconds as a double)
-            // ) has passed since the last loop iteration
-            double elapsed = duration<double>(now - last_loop_time).count();
+        // Achieved speed in the window title, so hosts (and speed modes) can be compared while playing
+        auto next_title = steady_clock::now();
+        auto update_title = [&]() {
+            const auto now = steady_clock::now();
+            if (now < next_title) return;
+            next_title = now + milliseconds(500);
 
-            // Update the reference point for the next loop
-            last_loop_time = now;
+            // Instructions per second at normal speed, where MIPS would read 0.00
+            char speed[32];
+            const double ips = link.ips.load(std::memory_order_relaxed);
+            if (ips < 1e6) snprintf(speed, sizeof(speed), "%.0f IPS", ips);
+            else snprintf(speed, sizeof(speed), "%.1f MIPS", ips / 1e6);
 
-            // Know how much time has passed since last CPU instruction and timer update
-            cpu_accum += elapsed;
-            timer_accum += elapsed;
-
-            // Run CPU instructions at the configured rate
-            while (cpu_accum >= cpu_period) {
-                emulate_instruction(machine, config);
-                cpu_accum -= cpu_period;
+            std::string title = std::string("Chip8 Emulator | ") + speed;
+            switch (link.speed.load(std::memory_order_relaxed)) {
+                case Speed::NORMAL:
+                    break;
+                case Speed::FAST_FORWARD:
+                    title += " | fast-forward " + std::to_string(config.fast_forward) + "x";
+                    break;
+                case Speed::UNCAPPED:
+                    title += " | uncapped";
+                    break;
             }
+            sdl.set_title(title);
+        };
 
-            // Update timers at 60Hz
-            // timer_period is how long (in seconds) should pass between each timer tick 
-            // (for 60Hz, timer_period = 1.0 / 60)
-            // If enough time has passed for a timer tick, decrement the delay and sound timers
-            if (timer_accum >= timer_period) {
-                // Opcode 0xFX15 sets the delay timer as V[X]
-                // Decrement if its above 0
-                if (machine.delay_timer > 0) --machine.delay_timer;
-
-                // Opcode 0xFX18 sets the sound timer as V[X]
-                if (machine.sound_timer > 0) --machine.sound_timer;
+        try {
+            // Render/input loop
+            while (link.running.load(std::memory_order_acquire)) {
+                // Time for input
+                bool redraw = false;
+                if (!handle_input(link.input, config, redraw)) break;
+                if (redraw) sdl.redraw();
+                sdl.set_volume(config.volume);
+                update_title();
 
-                // call to play or pause
-                sdl.handle_audio(machine);
+                // Render the screen
+                // The core publishes a display snapshot only when something was drawn,
+                // and the renderer skips presenting if it has already shown the latest one
+                sdl.update_window(link.frames.latest());
 
-                // Subtract the period from the accumulator so it can handle multiple ticks if the loop is slow
-                timer_accum -= timer_period;
+                // Sleep a little to avoid 100% CPU usage
+                SDL_Delay(1);
             }
+        } catch (...) {
+            stop_emulation();
+            throw;
+        }
 
-            // e.g
-            // If the loop is slow:
-            // If it takes 40ms (0.04s) instead of the ideal 16.67ms (0.01667s)
-            // cpu_accum will be 0.04s, so if the CPU period is 0.001s (1000Hz), itl run 40 instructions to catch up
-            // timer_accum will be 0.04s, so itl decrement the timers 2 times (since 0.04 / 0.01667 ≈ 2.4)
+        stop_emulation();
 
+        // A profile is worth most when the ROM crashed, so it is saved before the error is reported
+        save_profile();
 
-            // Render the screen (can be tied to timer or every frame)
-            sdl.update_window(config, machine);
+        // Errors on the emulation thread (e.g stack overflow) end up here, like they would single threaded
+        if (link.error) std::rethrow_exception(link.error);
 
-            // Sleep a little to avoid 100% CPU usage
-            SDL_Delay(1);
-            
+        if (!record_path.empty()) {
+            Chip8::save_movie(movie, record_path);
+            std::cout << "Movie saved to " << record_path << " (" << movie.events.size() << " events, "
+                      << movie.cycles << " cycles)" << std::endl;
         }
-        
+
+        std::cout << "Frames presented: " << sdl.frames_presented()
+                  << ", skipped (unchanged): " << sdl.frames_skipped() << std::endl;
         std::cout << "Emulator shut down successfully" << std::endl;
         return EXIT_SUCCESS;
         